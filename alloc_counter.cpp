@@ -0,0 +1,98 @@
+#include "alloc_counter.h"
+
+#include <cstdio>
+
+#ifdef SIM_COUNT_ALLOCATIONS
+    #include <cstdlib>
+    #include <new>
+    #include <opencv2/core.hpp>
+#endif
+
+FrameAllocationStats g_tracking_allocations;
+FrameAllocationStats g_preview_allocations;
+
+#ifdef SIM_COUNT_ALLOCATIONS
+
+namespace {
+
+thread_local uint64_t t_allocation_count = 0;
+
+void* CountedMalloc(size_t size) {
+    ++t_allocation_count;
+    void* pointer = std::malloc(size ? size : 1);
+    if (!pointer) throw std::bad_alloc();
+    return pointer;
+}
+
+// Forwards to OpenCV's standard allocator; buffers it returns carry that
+// allocator in UMatData::currAllocator, so release never comes back here.
+class CountingMatAllocator : public cv::MatAllocator {
+public:
+    cv::UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step,
+                           cv::AccessFlag flags, cv::UMatUsageFlags usage_flags) const override {
+        if (!data) ++t_allocation_count; // wrapping user memory is not an allocation
+        return cv::Mat::getStdAllocator()->allocate(dims, sizes, type, data, step, flags, usage_flags);
+    }
+    bool allocate(cv::UMatData* data, cv::AccessFlag access_flags, cv::UMatUsageFlags usage_flags) const override {
+        return cv::Mat::getStdAllocator()->allocate(data, access_flags, usage_flags);
+    }
+    void deallocate(cv::UMatData* data) const override {
+        cv::Mat::getStdAllocator()->deallocate(data);
+    }
+};
+
+} // namespace
+
+void* operator new(size_t size) { return CountedMalloc(size); }
+void* operator new[](size_t size) { return CountedMalloc(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { ++t_allocation_count; return std::malloc(size ? size : 1); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { ++t_allocation_count; return std::malloc(size ? size : 1); }
+void operator delete(void* pointer) noexcept { std::free(pointer); }
+void operator delete[](void* pointer) noexcept { std::free(pointer); }
+void operator delete(void* pointer, size_t) noexcept { std::free(pointer); }
+void operator delete[](void* pointer, size_t) noexcept { std::free(pointer); }
+void operator delete(void* pointer, const std::nothrow_t&) noexcept { std::free(pointer); }
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept { std::free(pointer); }
+
+bool AllocationCountingEnabled() { return true; }
+uint64_t ThreadAllocationCount() { return t_allocation_count; }
+
+void InstallMatAllocationCounter() {
+    static CountingMatAllocator allocator;
+    cv::Mat::setDefaultAllocator(&allocator);
+}
+
+#else
+
+bool AllocationCountingEnabled() { return false; }
+uint64_t ThreadAllocationCount() { return 0; }
+void InstallMatAllocationCounter() {}
+
+#endif
+
+void FrameAllocationStats::Record(uint64_t allocations) {
+    m_last.store(allocations, std::memory_order_relaxed);
+    if (m_frames.fetch_add(1, std::memory_order_relaxed) < WARMUP_FRAMES) return;
+    if (allocations > 0) m_frames_with_allocations.fetch_add(1, std::memory_order_relaxed);
+    uint64_t previous_max = m_max.load(std::memory_order_relaxed);
+    while (allocations > previous_max && !m_max.compare_exchange_weak(previous_max, allocations, std::memory_order_relaxed)) {}
+}
+
+std::string FrameAllocationStats::FormatLine(const char* loop_name) const {
+    uint64_t frames = m_frames.load(std::memory_order_relaxed);
+    uint64_t counted_frames = frames > WARMUP_FRAMES ? frames - WARMUP_FRAMES : 0;
+    char line[128];
+    snprintf(line, sizeof(line), "%-10s allocs/frame last %llu  max %llu  frames with allocs %llu/%llu (after warm-up)", loop_name,
+             static_cast<unsigned long long>(m_last.load(std::memory_order_relaxed)),
+             static_cast<unsigned long long>(m_max.load(std::memory_order_relaxed)),
+             static_cast<unsigned long long>(m_frames_with_allocations.load(std::memory_order_relaxed)),
+             static_cast<unsigned long long>(counted_frames));
+    return line;
+}
+
+void FrameAllocationStats::Reset() {
+    m_frames.store(0, std::memory_order_relaxed);
+    m_frames_with_allocations.store(0, std::memory_order_relaxed);
+    m_last.store(0, std::memory_order_relaxed);
+    m_max.store(0, std::memory_order_relaxed);
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+// Debug heap-allocation counter (configure with -DSIM_COUNT_ALLOCATIONS=ON).
+// When enabled, global operator new and cv::Mat buffer allocations bump a
+// thread-local counter; the frame loops sample it around each iteration and
+// report allocations per frame alongside the latency dump. In normal builds
+// ThreadAllocationCount() is always 0 and nothing is replaced.
+//
+// Not counted: plain malloc (e.g. cv::fastMalloc scratch inside OpenCV
+// kernels) and allocations made by HighGUI/DirectX drivers.
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+bool AllocationCountingEnabled();
+uint64_t ThreadAllocationCount();
+
+// Routes cv::Mat allocations through the counter. Call once at start-up, before
+// any worker thread runs; no-op when counting is disabled.
+void InstallMatAllocationCounter();
+
+class FrameAllocationStats {
+public:
+    static const uint64_t WARMUP_FRAMES = 30; // buffers are sized on the first frames; not counted in max/frames-with-allocs
+
+    void Record(uint64_t allocations);
+
+    // "tracking  allocs/frame last 0  max 3  frames with allocs 2/5400"
+    std::string FormatLine(const char* loop_name) const;
+    void Reset();
+
+private:
+    std::atomic<uint64_t> m_frames{0};
+    std::atomic<uint64_t> m_frames_with_allocations{0};
+    std::atomic<uint64_t> m_last{0};
+    std::atomic<uint64_t> m_max{0};
+};
+
+extern FrameAllocationStats g_tracking_allocations;
+extern FrameAllocationStats g_preview_allocations;
@@ -0,0 +1,115 @@
+#include "benchmark_harness.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+
+#include "frame_source.h"
+
+bool BenchmarkRunner::Enabled(const std::string& name) const {
+    return m_options.filter.empty() || name.find(m_options.filter) != std::string::npos;
+}
+
+void BenchmarkRunner::Run(const std::string& name, const std::function<void()>& body, int ops_per_call) {
+    if (!Enabled(name)) return;
+
+    // Warm up (caches, lazy allocations, OpenCV dispatch) and calibrate calls per sample.
+    body();
+    uint64_t calls_per_sample = 1;
+    const int64_t min_sample_ns = static_cast<int64_t>(m_options.min_sample_ms * 1e6);
+    for (;;) {
+        int64_t start_ns = MonotonicNowNs();
+        for (uint64_t i = 0; i < calls_per_sample; ++i) body();
+        int64_t elapsed_ns = MonotonicNowNs() - start_ns;
+        if (elapsed_ns >= min_sample_ns) break;
+        uint64_t scale = (elapsed_ns > 0) ? static_cast<uint64_t>(min_sample_ns / elapsed_ns) + 1 : 10;
+        calls_per_sample *= std::min<uint64_t>(std::max<uint64_t>(scale, 2), 100);
+    }
+
+    std::vector<double> sample_ns_per_op;
+    sample_ns_per_op.reserve(m_options.samples);
+    for (int sample = 0; sample < m_options.samples; ++sample) {
+        int64_t start_ns = MonotonicNowNs();
+        for (uint64_t i = 0; i < calls_per_sample; ++i) body();
+        int64_t elapsed_ns = MonotonicNowNs() - start_ns;
+        sample_ns_per_op.push_back(static_cast<double>(elapsed_ns) / (static_cast<double>(calls_per_sample) * ops_per_call));
+    }
+    std::sort(sample_ns_per_op.begin(), sample_ns_per_op.end());
+
+    BenchmarkResult result;
+    result.name = name;
+    result.median_ns = sample_ns_per_op[sample_ns_per_op.size() / 2];
+    result.min_ns = sample_ns_per_op.front();
+    result.max_ns = sample_ns_per_op.back();
+    result.iterations = calls_per_sample * static_cast<uint64_t>(ops_per_call) * m_options.samples;
+    m_results.push_back(result);
+
+    std::cout << std::left << std::setw(44) << name << std::right << std::fixed << std::setprecision(1)
+              << std::setw(14) << result.median_ns << " ns/op"
+              << "   (min " << result.min_ns << ", max " << result.max_ns << ")" << std::endl;
+}
+
+bool WriteBenchmarkJson(const std::string& path, const std::vector<BenchmarkResult>& results) {
+    std::ofstream out(path);
+    if (!out) { std::cerr << "Cannot write benchmark results to '" << path << "'." << std::endl; return false; }
+    out << "{\n  \"version\": 1,\n  \"benchmarks\": [\n";
+    out << std::fixed << std::setprecision(2);
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchmarkResult& r = results[i];
+        out << "    {\"name\": \"" << r.name << "\", \"ns_per_op\": " << r.median_ns << ", \"min_ns\": " << r.min_ns
+            << ", \"max_ns\": " << r.max_ns << ", \"iterations\": " << r.iterations << "}"
+            << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+    return static_cast<bool>(out);
+}
+
+bool ReadBenchmarkJson(const std::string& path, std::vector<BenchmarkResult>& results_out) {
+    // Reads files written by WriteBenchmarkJson (one benchmark object per line).
+    std::ifstream in(path);
+    if (!in) { std::cerr << "Cannot read baseline '" << path << "'." << std::endl; return false; }
+    results_out.clear();
+    std::string line;
+    while (std::getline(in, line)) {
+        size_t name_pos = line.find("\"name\": \"");
+        if (name_pos == std::string::npos) continue;
+        name_pos += strlen("\"name\": \"");
+        size_t name_end = line.find('"', name_pos);
+        if (name_end == std::string::npos) continue;
+        BenchmarkResult result;
+        result.name = line.substr(name_pos, name_end - name_pos);
+        size_t value_pos = line.find("\"ns_per_op\": ");
+        if (value_pos == std::string::npos) continue;
+        result.median_ns = std::atof(line.c_str() + value_pos + strlen("\"ns_per_op\": "));
+        results_out.push_back(result);
+    }
+    return true;
+}
+
+int CompareWithBaseline(const std::vector<BenchmarkResult>& current, const std::vector<BenchmarkResult>& baseline,
+                        double threshold_percent) {
+    std::map<std::string, double> baseline_by_name;
+    for (const BenchmarkResult& r : baseline) baseline_by_name[r.name] = r.median_ns;
+
+    int regressions = 0;
+    std::cout << std::endl << "--- Compared with baseline (threshold " << threshold_percent << "%) ---" << std::endl;
+    for (const BenchmarkResult& r : current) {
+        auto it = baseline_by_name.find(r.name);
+        if (it == baseline_by_name.end() || it->second <= 0.0) {
+            std::cout << std::left << std::setw(44) << r.name << "  (no baseline)" << std::endl;
+            continue;
+        }
+        double change_percent = (r.median_ns - it->second) / it->second * 100.0;
+        bool regressed = change_percent > threshold_percent;
+        if (regressed) ++regressions;
+        std::cout << std::left << std::setw(44) << r.name << std::right << std::fixed << std::setprecision(1)
+                  << std::setw(14) << it->second << " -> " << std::setw(14) << r.median_ns << " ns/op  "
+                  << std::showpos << change_percent << "%" << std::noshowpos
+                  << (regressed ? "  REGRESSION" : "") << std::endl;
+    }
+    return regressions;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+// Minimal micro-benchmark harness for SimBenchmarks. Each benchmark is a
+// callable performing 'ops_per_call' operations; the runner calibrates the
+// number of calls per sample to at least min_sample_ms, takes 'samples'
+// samples and reports ns per operation (median, min, max). Results are
+// written as JSON, one benchmark per line, and can be compared against a
+// previous run to catch regressions.
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+struct BenchmarkOptions {
+    double min_sample_ms = 20.0;
+    int samples = 15;
+    std::string filter;             // substring match on the benchmark name; empty = run all
+};
+
+struct BenchmarkResult {
+    std::string name;               // "kernel/variant", e.g. "resize_to_display/1080p"
+    double median_ns = 0.0;         // per operation
+    double min_ns = 0.0;
+    double max_ns = 0.0;
+    uint64_t iterations = 0;        // total operations timed
+};
+
+class BenchmarkRunner {
+public:
+    explicit BenchmarkRunner(const BenchmarkOptions& options) : m_options(options) {}
+
+    bool Enabled(const std::string& name) const;
+    // Times 'body' unless filtered out. 'body' performs ops_per_call operations per invocation.
+    void Run(const std::string& name, const std::function<void()>& body, int ops_per_call = 1);
+
+    const std::vector<BenchmarkResult>& Results() const { return m_results; }
+
+private:
+    BenchmarkOptions m_options;
+    std::vector<BenchmarkResult> m_results;
+};
+
+bool WriteBenchmarkJson(const std::string& path, const std::vector<BenchmarkResult>& results);
+bool ReadBenchmarkJson(const std::string& path, std::vector<BenchmarkResult>& results_out);
+
+// Prints a comparison table; returns the number of benchmarks whose median got
+// slower than the baseline by more than threshold_percent.
+int CompareWithBaseline(const std::vector<BenchmarkResult>& current, const std::vector<BenchmarkResult>& baseline,
+                        double threshold_percent);
+
+// Keeps the optimiser from discarding a computed value.
+template<typename T>
+inline void DoNotOptimize(const T& value) {
+    static volatile const void* sink;
+    sink = &value;
+    (void)sink;
+}
@@ -0,0 +1,275 @@
+#include "control.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+RemoteChannels   g_joystickState;
+RemoteChannels   ai_joystickState;
+std::atomic<int> flag_track{0};
+TrackingOffset   g_current_tracking_offset;
+TargetEstimator  g_target_estimator;
+DronePose        g_current_drone_pose;
+
+// --- PID Controller Parameters and State (示例) ---
+// 您需要为每个轴 (dx, dy) 分别设置这些参数
+// 积分/微分按秒计算 (积分单位 px*s，微分单位 px/s)，与控制频率和帧率无关。
+// 原先按帧调好的增益按 60 FPS 换算：Ki_s = Ki_frame * 60, Kd_s = Kd_frame / 60。
+// 水平方向 (控制 ch1 来修正 dx)
+double pid_kp_dx = 30;  // 比例增益 (Proportional gain) - 需要仔细调整
+double pid_ki_dx = 0.6; // 积分增益 (Integral gain, 1/s) - 需要仔细调整
+double pid_kd_dx = 0.1 / 60.0;  // 微分增益 (Derivative gain, s) - 需要仔细调整
+double pid_integral_dx = 0;
+double pid_previous_error_dx = 0;
+double pid_derivative_dx = 0;
+
+// 垂直方向 (控制 ch3 来修正 dy)
+double pid_kp_dy = 50;  // 比例增益
+double pid_ki_dy = 6.0; // 积分增益 (1/s)
+double pid_kd_dy = 0;  // 微分增益 (s)
+double pid_integral_dy = 0;
+double pid_previous_error_dy = 0;
+double pid_derivative_dy = 0;
+
+int64_t pid_previous_measurement_ns = 0; // capture time of the measurement the derivative was last taken on
+
+PlotHistory pid_ch1_history;
+PlotHistory pid_ch3_history;
+
+bool g_pid_debug_log = false;
+
+// Set by ApplyTrackingMeasurement; the next ControlAircraftWithPID tick logs and plots once per measurement.
+static bool s_pid_new_measurement = false;
+// Latest measurement says the target is lost but re-detection is still searching: keep the PID state.
+static bool s_pid_hold = false;
+
+// 控制线程调用：ch8 开关决定是否跟踪 (跟踪器的重置由跟踪线程完成)
+void is_track_on(void)
+{
+    if(g_joystickState.ch8>-1000)flag_track = 1;
+    else {
+        flag_track = 0;
+    }
+}
+
+// Error the PID works on at tick_ns. With the estimator the derivative comes from its
+// velocity (px/s) instead of the difference of the last two measurements. Only an invalid
+// latest measurement (target lost, tracker stopped) drops control; without new measurements
+// the estimate is held (TargetEstimator::Estimate), like the latched offset without it.
+static bool CurrentTrackingError(int64_t tick_ns, double& error_dx, double& error_dy) {
+    if (!g_current_tracking_offset.is_valid) return false;
+    if (!g_estimator_settings.enabled) {
+        error_dx = static_cast<double>(g_current_tracking_offset.dx);
+        error_dy = static_cast<double>(g_current_tracking_offset.dy);
+        return true;
+    }
+    TargetEstimate estimate;
+    if (!g_target_estimator.Estimate(tick_ns, estimate)) {
+        // Valid offset but no track (its timestamp was out of order): use it as it is.
+        error_dx = static_cast<double>(g_current_tracking_offset.dx);
+        error_dy = static_cast<double>(g_current_tracking_offset.dy);
+        return true;
+    }
+    error_dx = estimate.x;
+    error_dy = estimate.y;
+    pid_derivative_dx = estimate.vx;
+    pid_derivative_dy = estimate.vy;
+    return true;
+}
+
+void ControlAircraftWithPID(double dt_seconds, int64_t tick_ns) {
+    double error_dx = 0.0;
+    double error_dy = 0.0;
+    // 只有最新测量无效 (目标丢失、跟踪停止) 才清零控制；没有新测量时估计器外推最多 max_coast_s，之后保持最后一次测量的滤波位置 (微分为 0)
+    if (!CurrentTrackingError(tick_ns, error_dx, error_dy)) {
+        // ... (保持不变：重置ai_joystickState和PID状态) ...
+        ai_joystickState.ch1 = 0; 
+        ai_joystickState.ch3 = 0;
+        ai_joystickState.ch2 = g_joystickState.ch5; 
+        ai_joystickState.ch4 = 0; 
+        ai_joystickState.ch5 = g_joystickState.ch5; 
+        ai_joystickState.ch6 = 0; 
+        ai_joystickState.ch7 = 0;
+        ai_joystickState.ch8 = 0;
+        ai_joystickState.ch9 = 0;
+        ai_joystickState.ch10 = g_joystickState.ch10;
+        s_pid_new_measurement = false;
+        // 重新检测中：积分和上一次误差保持不变，目标找回后从原状态继续 (不重新积分)
+        if (s_pid_hold) return;
+        pid_integral_dx = 0; pid_previous_error_dx = 0; pid_derivative_dx = 0;
+        pid_integral_dy = 0; pid_previous_error_dy = 0; pid_derivative_dy = 0;
+        pid_previous_measurement_ns = 0;
+        return;
+    }
+
+    // --- PID 计算 for dx (控制 ch1) ---
+    // 每个控制周期按 dt 积分 (误差是估计器外推到本周期的位置；关闭估计器时两次测量之间误差保持不变)
+    // 微分项是估计器的速度；关闭估计器时在新测量到达时按差分计算并保持
+    pid_integral_dx += error_dx * dt_seconds;
+    double pid_output_dx = (pid_kp_dx * error_dx) + (pid_ki_dx * pid_integral_dx) + (pid_kd_dx * pid_derivative_dx);
+    // 假设增大ch1使目标左移。如果error_dx > 0 (目标在右)，需要增大ch1。
+    // 所以，如果Kp为正，这里的符号可能是对的。如果反了，调整Kp符号或在这里取反。
+    ai_joystickState.ch1 = static_cast<long>(pid_output_dx); 
+
+
+    // --- PID 计算 for dy (控制 ch3) ---
+    pid_integral_dy += error_dy * dt_seconds; 
+    // 可选：更精细的积分抗饱和，例如：
+    // const double MAX_INTEGRAL_DY = 5000.0; // 根据经验设定
+    // pid_integral_dy = std::max(-MAX_INTEGRAL_DY, std::min(MAX_INTEGRAL_DY, pid_integral_dy));
+
+    double pid_output_dy_raw = (pid_kp_dy * error_dy) + (pid_ki_dy * pid_integral_dy) + (pid_kd_dy * pid_derivative_dy);
+    const long hover_bias_ch3 = 300; // 示例：您实验得到的值
+    // 控制方向调整：增大ch3使目标框向下。
+    // 如果 error_dy > 0 (目标在下方)，我们需要一个使目标框上移的控制，即减小ch3。
+    // 所以，如果 pid_output_dy_raw 为正，我们需要一个负的控制努力。
+    double control_effort_dy = -pid_output_dy_raw; 
+
+    // 可选：添加前馈/偏置 (如果CH3是油门，可能需要一个基础油门值)
+    // const long hover_bias_ch3 = 0; // 如果希望稳定在0，则为0。如果是悬停油门，设为该值。
+    // ai_joystickState.ch3 = static_cast<long>(control_effort_dy) + hover_bias_ch3;
+    ai_joystickState.ch3 = static_cast<long>(control_effort_dy)+hover_bias_ch3; // 当前不加偏置
+
+
+    // --- 限幅PID输出 ---
+    ai_joystickState.ch1 = std::max(PID_OUTPUT_MIN, std::min(PID_OUTPUT_MAX, ai_joystickState.ch1));
+    ai_joystickState.ch3 = std::max(PID_OUTPUT_MIN, std::min(PID_OUTPUT_MAX, ai_joystickState.ch3));
+
+    // --- 其他通道 ---
+    ai_joystickState.ch2 = g_joystickState.ch2;
+    ai_joystickState.ch4 = 0;
+    ai_joystickState.ch5 = g_joystickState.ch5;  
+    ai_joystickState.ch6 = 0; 
+    ai_joystickState.ch7 = 0;
+    ai_joystickState.ch8 = 0;
+    ai_joystickState.ch9 = 0;
+    ai_joystickState.ch10 = g_joystickState.ch10;
+
+    // --- 更新PID输出历史数据 (每个跟踪测量一个点，与控制频率无关) ---
+    if (!s_pid_new_measurement) return;
+    s_pid_new_measurement = false;
+    pid_ch1_history.push_back(ai_joystickState.ch1); // 满 PLOT_HISTORY_LENGTH 后自动丢弃最旧的点
+    pid_ch3_history.push_back(ai_joystickState.ch3);
+// 在 ControlAircraftWithPID() 的末尾，更新历史数据之前
+if (g_pid_debug_log) { // 只在有效时打印 (无效时上面已经返回)
+    std::cout << "PID_DY: err=" << error_dy
+              << ", integral=" << pid_integral_dy
+              << ", raw_out=" << pid_output_dy_raw
+              << ", effort=" << control_effort_dy
+              << ", CH3_final=" << ai_joystickState.ch3
+              << std::endl;
+}
+
+}
+
+void ApplyTrackingMeasurement(const TrackingOffset& offset, bool tracker_started, int64_t capture_timestamp_ns, bool recovering) {
+    if (tracker_started) {
+        ai_joystickState.ch3 = g_joystickState.ch3;
+        g_target_estimator.Reset(); // 新目标，不沿用上一个目标的速度
+    }
+    g_current_tracking_offset = offset;
+    s_pid_new_measurement = true;
+    s_pid_hold = !offset.is_valid && recovering;
+    if (!offset.is_valid) { // ControlAircraftWithPID 会在下一个周期清零状态
+        if (!recovering) g_target_estimator.Reset();
+        return;
+    }
+    g_target_estimator.Update(offset.dx, offset.dy, std::sqrt(static_cast<double>(offset.width) * offset.height), capture_timestamp_ns);
+
+    // 微分项只在新测量上计算 (以两帧采集时间差为 dt)，在测量之间保持不变
+    double error_dx = static_cast<double>(offset.dx);
+    double error_dy = static_cast<double>(offset.dy);
+    if (pid_previous_measurement_ns > 0 && capture_timestamp_ns > pid_previous_measurement_ns) {
+        double dt_seconds = (capture_timestamp_ns - pid_previous_measurement_ns) / 1e9;
+        pid_derivative_dx = (error_dx - pid_previous_error_dx) / dt_seconds;
+        pid_derivative_dy = (error_dy - pid_previous_error_dy) / dt_seconds;
+    } else {
+        pid_derivative_dx = 0;
+        pid_derivative_dy = 0;
+    }
+    pid_previous_error_dx = error_dx;
+    pid_previous_error_dy = error_dy;
+    pid_previous_measurement_ns = capture_timestamp_ns;
+}
+
+// 将 g_joystickState (或 AI 控制时的 ai_joystickState) 映射为虚拟摇杆报告
+VirtualPadReport BuildVirtualReport() {
+    VirtualPadReport report;
+
+    // 定义缩放函数 (可以放在函数内部，或者作为辅助全局函数/lambda)
+    auto scale_axis = [](long val) -> int16_t {
+        double s = static_cast<double>(val) / 1000.0 * 32767.0;
+        return static_cast<int16_t>(std::max(-32767.0, std::min(32767.0, s)));
+    };
+    auto scale_trigger = [](long val) -> uint8_t {
+        double s = (static_cast<double>(val) + 1000.0) / 2000.0 * 255.0; // Maps -1000..1000 to 0..255
+        return static_cast<uint8_t>(std::max(0.0, std::min(255.0, s)));
+    };
+
+    if (flag_track == 0) {
+        // 当 flag_track 为 0 时，直接将 g_joystickState 的值映射到虚拟摇杆
+        report.sThumbLX = scale_axis(g_joystickState.ch4);      // X-Axis
+        report.sThumbLY = scale_axis(g_joystickState.ch3);  // Y-Axis (XInput Y通常反向)
+        report.sThumbRX = scale_axis(g_joystickState.ch1);      // X-Rotation
+        report.sThumbRY = scale_axis(g_joystickState.ch2);  // Y-Rotation (XInput Y通常反向)
+
+        //report.bLeftTrigger  = scale_trigger(g_joystickState.ch9); // Z-Axis
+        //report.bRightTrigger = scale_trigger(g_joystickState.ch6); // Z-Rotation
+
+        //if (g_joystickState.ch5)  report.wButtons |= XUSB_GAMEPAD_A;             // Button 1
+        //if (g_joystickState.ch10) report.wButtons |= XUSB_GAMEPAD_B;             // Button 2
+        
+        // ch7 和 ch8 (滑块) 映射到肩键 (示例逻辑)
+        //if (g_joystickState.ch7 > 500) report.wButtons |= XUSB_GAMEPAD_LEFT_SHOULDER;
+        //if (g_joystickState.ch8 > 500) report.wButtons |= XUSB_GAMEPAD_RIGHT_SHOULDER;
+
+    } else if (flag_track == 1) {
+        // 当 flag_track 为 1 时，这里是您未来实现AI控制逻辑的地方
+        // 目前，我们可以先做一个占位符，例如：
+        // 1. AI完全接管：AI计算所有轴和按钮的值，然后填充 report
+        // 2. AI辅助：AI修改 g_joystickState 中的某些值，然后再进行标准映射
+        // 3. AI只控制部分：例如，AI控制油门和方向，按钮由物理手柄决定
+
+        // --- 示例：AI占位符 - 让AI控制左摇杆，其他来自物理手柄 ---
+        // (这是一个非常简单的示例，您需要替换为实际的AI逻辑)
+        
+        // 假设AI输出以下值 (这些值应该由您的AI算法计算得出)
+        //long ai_lx = 0;    // AI控制的左摇杆X (范围 -1000 到 1000)
+        //long ai_ly = 500;  // AI控制的左摇杆Y (范围 -1000 到 1000)
+        
+        // 如果您的AI直接输出XInput兼容的值，就不需要scale_axis了
+        // report.sThumbLX = ai_calculated_lx_xinput_value;
+        // report.sThumbLY = ai_calculated_ly_xinput_value;
+        
+        //report.sThumbLX = scale_axis(ai_lx);
+        //report.sThumbLY = scale_axis(ai_ly * -1); // 假设AI输出也需要Y轴反转
+
+        report.sThumbLX = scale_axis(ai_joystickState.ch4);      // X-Axis
+        report.sThumbLY = scale_axis(ai_joystickState.ch3);  // Y-Axis (XInput Y通常反向)
+        report.sThumbRX = scale_axis(ai_joystickState.ch1);      // X-Rotation
+        report.sThumbRY = scale_axis(ai_joystickState.ch2);  // Y-Rotation (XInput Y通常反向)    
+        
+        // 您也可以在这里根据AI的输出来设置按钮
+        // bool ai_button_A_pressed = your_ai_logic_for_button_A();
+        // if (ai_button_A_pressed) report.wButtons |= XUSB_GAMEPAD_A;
+    }
+    // else: 可以处理其他 flag_track 值的情况，如果需要
+
+    return report;
+}
+
+void ResetControlState() {
+    g_joystickState = RemoteChannels();
+    ai_joystickState = RemoteChannels();
+    flag_track = 0;
+    g_current_tracking_offset = TrackingOffset();
+    g_target_estimator.Reset();
+    g_current_drone_pose = DronePose();
+    pid_integral_dx = 0; pid_previous_error_dx = 0; pid_derivative_dx = 0;
+    pid_integral_dy = 0; pid_previous_error_dy = 0; pid_derivative_dy = 0;
+    pid_previous_measurement_ns = 0;
+    s_pid_new_measurement = false;
+    s_pid_hold = false;
+    pid_ch1_history.clear();
+    pid_ch3_history.clear();
+}
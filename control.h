@@ -0,0 +1,93 @@
+#pragma once
+
+// Control side of the pipeline: physical channel state, the tracking switch,
+// the PID that turns tracker offsets into AI stick values, and the mapping of
+// the active channel set onto a virtual pad report. Portable so SimReplay can
+// drive it from a session log; main.cpp owns DirectInput/ViGEm.
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "sim_types.h"
+#include "target_estimator.h"
+
+extern RemoteChannels g_joystickState;        // 物理遥控器 (或回放) 的通道值
+extern RemoteChannels ai_joystickState;       // PID 输出
+extern std::atomic<int> flag_track;           // written by control thread (ch8) and 'T' key, read everywhere
+extern TrackingOffset g_current_tracking_offset; // control thread copy of the latest tracker measurement
+extern TargetEstimator g_target_estimator;       // filtered target state the PID runs on (control thread)
+extern DronePose g_current_drone_pose;
+
+// --- PID Controller Parameters and State ---
+// Gains are per second: Ki multiplies px*s, Kd multiplies px/s.
+extern double pid_kp_dx, pid_ki_dx, pid_kd_dx;
+extern double pid_integral_dx, pid_previous_error_dx, pid_derivative_dx;
+extern double pid_kp_dy, pid_ki_dy, pid_kd_dy;
+extern double pid_integral_dy, pid_previous_error_dy, pid_derivative_dy;
+extern int64_t pid_previous_measurement_ns;
+
+// PID输出限幅 (防止输出过大的控制信号，对应摇杆的 -1000 到 1000)
+const long PID_OUTPUT_MIN = -1000;
+const long PID_OUTPUT_MAX = 1000;
+
+const int PLOT_HISTORY_LENGTH = 200; // 存储多少个历史数据点
+
+// Fixed-capacity ring of the last PLOT_HISTORY_LENGTH PID outputs, oldest first.
+// push_back drops the oldest value once full; copying never touches the heap,
+// so the preview can snapshot it every frame.
+class PlotHistory {
+public:
+    void push_back(long value) {
+        m_values[(m_start + m_count) % PLOT_HISTORY_LENGTH] = value;
+        if (m_count < PLOT_HISTORY_LENGTH) ++m_count;
+        else m_start = (m_start + 1) % PLOT_HISTORY_LENGTH;
+    }
+    void clear() { m_start = 0; m_count = 0; }
+    size_t size() const { return m_count; }
+    bool empty() const { return m_count == 0; }
+    long operator[](size_t index) const { return m_values[(m_start + index) % PLOT_HISTORY_LENGTH]; }
+    bool operator==(const PlotHistory& other) const {
+        if (m_count != other.m_count) return false;
+        for (size_t i = 0; i < m_count; ++i) {
+            if ((*this)[i] != other[i]) return false;
+        }
+        return true;
+    }
+
+private:
+    std::array<long, PLOT_HISTORY_LENGTH> m_values{};
+    size_t m_start = 0;
+    size_t m_count = 0;
+};
+
+extern PlotHistory pid_ch1_history;      // 存储ch1的历史值
+extern PlotHistory pid_ch3_history;      // 存储ch3的历史值
+
+// PID_DY console trace, once per measurement (--pid-trace). Off by default: a flushed console
+// write on the control thread can block for milliseconds and allocates.
+extern bool g_pid_debug_log;
+
+void is_track_on(void);
+// One control tick at tick_ns (MonotonicNowNs()): integrates the error over dt_seconds and
+// updates ai_joystickState. The error and its derivative are g_target_estimator's state
+// extrapolated to tick_ns (at most max_coast_s past the last measurement; after that the
+// last filtered position with a zero derivative), so they move between tracker frames and
+// cover the pipeline latency; with the estimator off it is the latched offset. Gaps without measurements (static screen, skipped unchanged
+// frames) keep control going; only an invalid measurement takes the sticks to neutral.
+void ControlAircraftWithPID(double dt_seconds, int64_t tick_ns);
+
+// Latches a new tracker measurement (seeding ch3 and restarting the estimate when the tracker
+// just started), feeds it to g_target_estimator and updates the finite-difference derivative
+// from the capture-time delta. The PID itself runs on the next tick.
+// An invalid offset zeroes the sticks and the PID state, unless 'recovering' (re-detection
+// is still searching): then the sticks go neutral but the integrals and previous error are
+// kept, so control picks up where it left off once the target is found again.
+void ApplyTrackingMeasurement(const TrackingOffset& offset, bool tracker_started, int64_t capture_timestamp_ns, bool recovering);
+
+// Maps g_joystickState (flag_track == 0) or ai_joystickState (flag_track == 1) onto a pad report.
+VirtualPadReport BuildVirtualReport();
+
+// Zeroes channels, PID state and history; the gains are left alone.
+void ResetControlState();
@@ -0,0 +1,793 @@
+#include "correlation_tracker.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
+// SSE2 is part of x86-64 (and of every x86 build MSVC makes with /arch:SSE2), so
+// unlike the downscale kernels there is nothing to dispatch at runtime.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define SIM_CF_SSE2 1
+    #include <emmintrin.h>
+#else
+    #define SIM_CF_SSE2 0
+#endif
+
+CorrelationTrackerParams g_correlation_tracker_params;
+
+namespace {
+
+const double PI = 3.14159265358979323846;
+const int PSR_EXCLUDE_RADIUS = 5;           // sidelobe = response outside the 11x11 around the peak
+const int PLANE_COUNT = 13;                 // float planes in CorrelationTracker::m_storage
+const int LINE_CACHE = 2 * CorrelationTracker::MAX_PATCH + 2;  // SampleWindow() source row: 2 frame px per patch px
+
+// Radix-2 plan for one patch size, plus the matching 2-D Hann window.
+struct FftPlan {
+    int n = 0;
+    std::vector<int> bit_reverse;
+    std::vector<float> twiddle_re;          // stage with half-length m (1, 2, 4, ...) starts at index m - 1
+    std::vector<float> twiddle_im;
+    std::vector<float> window;              // n * n
+};
+
+FftPlan BuildPlan(int n) {
+    FftPlan plan;
+    plan.n = n;
+    int bits = 0;
+    while ((1 << bits) < n) ++bits;
+    plan.bit_reverse.resize(n);
+    for (int i = 0; i < n; ++i) {
+        int reversed = 0;
+        for (int b = 0; b < bits; ++b) reversed |= ((i >> b) & 1) << (bits - 1 - b);
+        plan.bit_reverse[i] = reversed;
+    }
+    plan.twiddle_re.resize(n - 1);
+    plan.twiddle_im.resize(n - 1);
+    for (int m = 1; m < n; m <<= 1) {
+        for (int j = 0; j < m; ++j) {
+            double angle = -PI * j / m;
+            plan.twiddle_re[m - 1 + j] = static_cast<float>(std::cos(angle));
+            plan.twiddle_im[m - 1 + j] = static_cast<float>(std::sin(angle));
+        }
+    }
+    std::vector<double> hann(n);
+    for (int i = 0; i < n; ++i) hann[i] = 0.5 * (1.0 - std::cos(2.0 * PI * i / (n - 1)));
+    plan.window.resize(static_cast<size_t>(n) * n);
+    for (int y = 0; y < n; ++y) {
+        for (int x = 0; x < n; ++x) plan.window[static_cast<size_t>(y) * n + x] = static_cast<float>(hann[y] * hann[x]);
+    }
+    return plan;
+}
+
+// Built on first use, shared by every tracker.
+const FftPlan& PlanFor(int n) {
+    static const FftPlan plans[3] = { BuildPlan(32), BuildPlan(64), BuildPlan(128) };
+    return plans[n <= 32 ? 0 : n <= 64 ? 1 : 2];
+}
+
+// Radix-2 butterflies between whole rows, vectorised along the row:
+//   (a, b) <- (a + w b, a - w b)
+inline void ButterflyRows(float* a_re, float* a_im, float* b_re, float* b_im, float w_re, float w_im, int n) {
+    int x = 0;
+#if SIM_CF_SSE2
+    const __m128 wr = _mm_set1_ps(w_re), wi = _mm_set1_ps(w_im);
+    for (; x + 4 <= n; x += 4) {
+        __m128 xr = _mm_loadu_ps(b_re + x), xi = _mm_loadu_ps(b_im + x);
+        __m128 tr = _mm_sub_ps(_mm_mul_ps(wr, xr), _mm_mul_ps(wi, xi));
+        __m128 ti = _mm_add_ps(_mm_mul_ps(wr, xi), _mm_mul_ps(wi, xr));
+        __m128 ur = _mm_loadu_ps(a_re + x), ui = _mm_loadu_ps(a_im + x);
+        _mm_storeu_ps(a_re + x, _mm_add_ps(ur, tr));
+        _mm_storeu_ps(a_im + x, _mm_add_ps(ui, ti));
+        _mm_storeu_ps(b_re + x, _mm_sub_ps(ur, tr));
+        _mm_storeu_ps(b_im + x, _mm_sub_ps(ui, ti));
+    }
+#endif
+    for (; x < n; ++x) {
+        float tr = w_re * b_re[x] - w_im * b_im[x];
+        float ti = w_re * b_im[x] + w_im * b_re[x];
+        b_re[x] = a_re[x] - tr;
+        b_im[x] = a_im[x] - ti;
+        a_re[x] += tr;
+        a_im[x] += ti;
+    }
+}
+
+#if SIM_CF_SSE2
+struct ComplexLanes { __m128 re, im; };
+
+inline void Butterfly(ComplexLanes& a, ComplexLanes& b, __m128 w_re, __m128 w_im) {
+    __m128 tr = _mm_sub_ps(_mm_mul_ps(w_re, b.re), _mm_mul_ps(w_im, b.im));
+    __m128 ti = _mm_add_ps(_mm_mul_ps(w_re, b.im), _mm_mul_ps(w_im, b.re));
+    b.re = _mm_sub_ps(a.re, tr);
+    b.im = _mm_sub_ps(a.im, ti);
+    a.re = _mm_add_ps(a.re, tr);
+    a.im = _mm_add_ps(a.im, ti);
+}
+#endif
+
+inline void Butterfly(float& a_re, float& a_im, float& b_re, float& b_im, float w_re, float w_im) {
+    float tr = w_re * b_re - w_im * b_im;
+    float ti = w_re * b_im + w_im * b_re;
+    b_re = a_re - tr;
+    b_im = a_im - ti;
+    a_re += tr;
+    a_im += ti;
+}
+
+// Stages m and 2m in one pass over rows r[0..3] = k + j + {0, m, 2m, 3m}, so each
+// element is loaded and stored once per two stages.
+inline void ButterflyRows2(float* const re[4], float* const im[4], const FftPlan& plan, int m, int j, int n) {
+    const float w1_re = plan.twiddle_re[m - 1 + j], w1_im = plan.twiddle_im[m - 1 + j];                     // stage m
+    const float w2_re = plan.twiddle_re[2 * m - 1 + j], w2_im = plan.twiddle_im[2 * m - 1 + j];             // stage 2m, rows 0/2
+    const float w3_re = plan.twiddle_re[2 * m - 1 + j + m], w3_im = plan.twiddle_im[2 * m - 1 + j + m];     // stage 2m, rows 1/3
+    float* const re0 = re[0]; float* const re1 = re[1]; float* const re2 = re[2]; float* const re3 = re[3];
+    float* const im0 = im[0]; float* const im1 = im[1]; float* const im2 = im[2]; float* const im3 = im[3];
+    int x = 0;
+#if SIM_CF_SSE2
+    const __m128 v1_re = _mm_set1_ps(w1_re), v1_im = _mm_set1_ps(w1_im);
+    const __m128 v2_re = _mm_set1_ps(w2_re), v2_im = _mm_set1_ps(w2_im);
+    const __m128 v3_re = _mm_set1_ps(w3_re), v3_im = _mm_set1_ps(w3_im);
+    for (; x + 4 <= n; x += 4) {
+        ComplexLanes a = { _mm_loadu_ps(re0 + x), _mm_loadu_ps(im0 + x) };
+        ComplexLanes b = { _mm_loadu_ps(re1 + x), _mm_loadu_ps(im1 + x) };
+        ComplexLanes c = { _mm_loadu_ps(re2 + x), _mm_loadu_ps(im2 + x) };
+        ComplexLanes d = { _mm_loadu_ps(re3 + x), _mm_loadu_ps(im3 + x) };
+        Butterfly(a, b, v1_re, v1_im);
+        Butterfly(c, d, v1_re, v1_im);
+        Butterfly(a, c, v2_re, v2_im);
+        Butterfly(b, d, v3_re, v3_im);
+        _mm_storeu_ps(re0 + x, a.re); _mm_storeu_ps(im0 + x, a.im);
+        _mm_storeu_ps(re1 + x, b.re); _mm_storeu_ps(im1 + x, b.im);
+        _mm_storeu_ps(re2 + x, c.re); _mm_storeu_ps(im2 + x, c.im);
+        _mm_storeu_ps(re3 + x, d.re); _mm_storeu_ps(im3 + x, d.im);
+    }
+#endif
+    for (; x < n; ++x) {
+        Butterfly(re0[x], im0[x], re1[x], im1[x], w1_re, w1_im);
+        Butterfly(re2[x], im2[x], re3[x], im3[x], w1_re, w1_im);
+        Butterfly(re0[x], im0[x], re2[x], im2[x], w2_re, w2_im);
+        Butterfly(re1[x], im1[x], re3[x], im3[x], w3_re, w3_im);
+    }
+}
+
+// In-place forward DFT of the first 'lanes' columns (rows n floats apart), all
+// at once (decimation in time). Butterflies combine whole rows under one twiddle,
+// so all of it runs on full SIMD vectors, the first stages included.
+void FftColumns(float* re, float* im, const FftPlan& plan, int lanes) {
+    const int n = plan.n;
+    const size_t row_bytes = sizeof(float) * lanes;
+    float swap_re[CorrelationTracker::MAX_PATCH], swap_im[CorrelationTracker::MAX_PATCH];
+    for (int i = 0; i < n; ++i) {
+        int j = plan.bit_reverse[i];
+        if (j <= i) continue;
+        float* ri = re + static_cast<size_t>(i) * n; float* rj = re + static_cast<size_t>(j) * n;
+        float* ii = im + static_cast<size_t>(i) * n; float* ij = im + static_cast<size_t>(j) * n;
+        std::memcpy(swap_re, ri, row_bytes); std::memcpy(ri, rj, row_bytes); std::memcpy(rj, swap_re, row_bytes);
+        std::memcpy(swap_im, ii, row_bytes); std::memcpy(ii, ij, row_bytes); std::memcpy(ij, swap_im, row_bytes);
+    }
+    int m = 1;
+    for (; 2 * m < n; m <<= 2) {
+        for (int k = 0; k < n; k += 4 * m) {
+            for (int j = 0; j < m; ++j) {
+                float* rows_re[4];
+                float* rows_im[4];
+                for (int r = 0; r < 4; ++r) {
+                    rows_re[r] = re + static_cast<size_t>(k + j + r * m) * n;
+                    rows_im[r] = im + static_cast<size_t>(k + j + r * m) * n;
+                }
+                ButterflyRows2(rows_re, rows_im, plan, m, j, lanes);
+            }
+        }
+    }
+    if (m < n) {
+        // Odd number of stages: the last one alone.
+        for (int j = 0; j < m; ++j) {
+            ButterflyRows(re + static_cast<size_t>(j) * n, im + static_cast<size_t>(j) * n,
+                          re + static_cast<size_t>(j + m) * n, im + static_cast<size_t>(j + m) * n,
+                          plan.twiddle_re[m - 1 + j], plan.twiddle_im[m - 1 + j], lanes);
+        }
+    }
+}
+
+// Inverse DFT of the first 'lanes' columns, unscaled. Swapping the real and
+// imaginary parts on the way in and out turns the forward transform into the
+// inverse, and the swap is free: just pass the planes the other way round.
+inline void InverseFftColumns(float* re, float* im, const FftPlan& plan, int lanes) {
+    FftColumns(im, re, plan, lanes);
+}
+
+void Transpose(float* plane, int n) {
+#if SIM_CF_SSE2
+    // 4x4 tiles, each swapped with its mirror across the diagonal.
+    for (int by = 0; by < n; by += 4) {
+        for (int bx = by; bx < n; bx += 4) {
+            float* a = plane + static_cast<size_t>(by) * n + bx;
+            float* b = plane + static_cast<size_t>(bx) * n + by;
+            __m128 a0 = _mm_loadu_ps(a), a1 = _mm_loadu_ps(a + n), a2 = _mm_loadu_ps(a + 2 * n), a3 = _mm_loadu_ps(a + 3 * n);
+            _MM_TRANSPOSE4_PS(a0, a1, a2, a3);
+            if (bx != by) {
+                __m128 b0 = _mm_loadu_ps(b), b1 = _mm_loadu_ps(b + n), b2 = _mm_loadu_ps(b + 2 * n), b3 = _mm_loadu_ps(b + 3 * n);
+                _MM_TRANSPOSE4_PS(b0, b1, b2, b3);
+                _mm_storeu_ps(a, b0); _mm_storeu_ps(a + n, b1); _mm_storeu_ps(a + 2 * n, b2); _mm_storeu_ps(a + 3 * n, b3);
+            }
+            _mm_storeu_ps(b, a0); _mm_storeu_ps(b + n, a1); _mm_storeu_ps(b + 2 * n, a2); _mm_storeu_ps(b + 3 * n, a3);
+        }
+    }
+#else
+    for (int y = 0; y < n; ++y) {
+        for (int x = y + 1; x < n; ++x) std::swap(plane[static_cast<size_t>(y) * n + x], plane[static_cast<size_t>(x) * n + y]);
+    }
+#endif
+}
+
+// even[k] = src[2k], odd[k] = src[2k + 1]. 'even' may be 'src' (writes trail the reads).
+void Deinterleave(const float* src, float* even, float* odd, int half) {
+    int k = 0;
+#if SIM_CF_SSE2
+    for (; k + 4 <= half; k += 4) {
+        __m128 a = _mm_loadu_ps(src + 2 * k), b = _mm_loadu_ps(src + 2 * k + 4);
+        _mm_storeu_ps(even + k, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+        _mm_storeu_ps(odd + k, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+    }
+#endif
+    for (; k < half; ++k) { float e = src[2 * k], o = src[2 * k + 1]; even[k] = e; odd[k] = o; }
+}
+
+// Undoes Deinterleave(), scaled; 'dst' must not overlap the inputs.
+void Interleave(const float* even, const float* odd, float* dst, int half, float scale) {
+    int k = 0;
+#if SIM_CF_SSE2
+    const __m128 s = _mm_set1_ps(scale);
+    for (; k + 4 <= half; k += 4) {
+        __m128 e = _mm_mul_ps(_mm_loadu_ps(even + k), s), o = _mm_mul_ps(_mm_loadu_ps(odd + k), s);
+        _mm_storeu_ps(dst + 2 * k, _mm_unpacklo_ps(e, o));
+        _mm_storeu_ps(dst + 2 * k + 4, _mm_unpackhi_ps(e, o));
+    }
+#endif
+    for (; k < half; ++k) { dst[2 * k] = even[k] * scale; dst[2 * k + 1] = odd[k] * scale; }
+}
+
+// Splits p = Z(f), q = Z(-f) of a packed transform Z = E + iO into the
+// interleaved row E(f, 0), O(f, 0), E(f, 1), O(f, 1), ...:
+//   E(f) = (Z(f) + conj(Z(-f))) / 2,  O(f) = -i (Z(f) - conj(Z(-f))) / 2
+void SplitPackedSpectrum(const float* p_re, const float* p_im, const float* q_re, const float* q_im,
+                         float* out_re, float* out_im, int half) {
+    int k = 0;
+#if SIM_CF_SSE2
+    const __m128 h = _mm_set1_ps(0.5f);
+    for (; k + 4 <= half; k += 4) {
+        __m128 pr = _mm_loadu_ps(p_re + k), pi = _mm_loadu_ps(p_im + k);
+        __m128 qr = _mm_loadu_ps(q_re + k), qi = _mm_loadu_ps(q_im + k);
+        __m128 e_re = _mm_mul_ps(h, _mm_add_ps(pr, qr)), e_im = _mm_mul_ps(h, _mm_sub_ps(pi, qi));
+        __m128 o_re = _mm_mul_ps(h, _mm_add_ps(pi, qi)), o_im = _mm_mul_ps(h, _mm_sub_ps(qr, pr));
+        _mm_storeu_ps(out_re + 2 * k, _mm_unpacklo_ps(e_re, o_re));
+        _mm_storeu_ps(out_re + 2 * k + 4, _mm_unpackhi_ps(e_re, o_re));
+        _mm_storeu_ps(out_im + 2 * k, _mm_unpacklo_ps(e_im, o_im));
+        _mm_storeu_ps(out_im + 2 * k + 4, _mm_unpackhi_ps(e_im, o_im));
+    }
+#endif
+    for (; k < half; ++k) {
+        out_re[2 * k] = 0.5f * (p_re[k] + q_re[k]);
+        out_im[2 * k] = 0.5f * (p_im[k] - q_im[k]);
+        out_re[2 * k + 1] = 0.5f * (p_im[k] + q_im[k]);
+        out_im[2 * k + 1] = 0.5f * (q_re[k] - p_re[k]);
+    }
+}
+
+// dst[i] = conj(src[n - i]) for i in [first, n).
+void MirrorConjugate(const float* src_re, const float* src_im, float* dst_re, float* dst_im, int first, int n) {
+    int i = first;
+#if SIM_CF_SSE2
+    const __m128 sign = _mm_set1_ps(-0.0f);
+    for (; i + 4 <= n; i += 4) {
+        __m128 r = _mm_loadu_ps(src_re + n - i - 3), m = _mm_loadu_ps(src_im + n - i - 3);
+        _mm_storeu_ps(dst_re + i, _mm_shuffle_ps(r, r, _MM_SHUFFLE(0, 1, 2, 3)));
+        _mm_storeu_ps(dst_im + i, _mm_xor_ps(sign, _mm_shuffle_ps(m, m, _MM_SHUFFLE(0, 1, 2, 3))));
+    }
+#endif
+    for (; i < n; ++i) { dst_re[i] = src_re[n - i]; dst_im[i] = -src_im[n - i]; }
+}
+
+// 2-D DFT of the real plane in 're' ('im' is overwritten), done as half-size
+// complex transforms:
+//   - columns 2k and 2k + 1 go through one complex column FFT as its real and
+//     imaginary parts, then are separated using the Hermitian symmetry of each;
+//   - after the transpose only the frequencies 0..n/2 of the second axis are
+//     transformed; the rest is the conjugate mirror.
+// The spectrum is left transposed, [fx][fy]. Every spectrum goes through this,
+// so element-wise products never notice; InverseRealFft2d() undoes it.
+void RealFft2d(float* re, float* im, const FftPlan& plan) {
+    const int n = plan.n, half = n / 2;
+    for (int y = 0; y < n; ++y) {
+        float* row_re = re + static_cast<size_t>(y) * n;
+        Deinterleave(row_re, row_re, im + static_cast<size_t>(y) * n, half);
+    }
+    FftColumns(re, im, plan, half);
+
+    float f_re[CorrelationTracker::MAX_PATCH / 2], f_im[CorrelationTracker::MAX_PATCH / 2];
+    float g_re[CorrelationTracker::MAX_PATCH / 2], g_im[CorrelationTracker::MAX_PATCH / 2];
+    for (int f = 0; f <= half; ++f) {
+        const int g = (n - f) & (n - 1);
+        float* row_f_re = re + static_cast<size_t>(f) * n; float* row_f_im = im + static_cast<size_t>(f) * n;
+        float* row_g_re = re + static_cast<size_t>(g) * n; float* row_g_im = im + static_cast<size_t>(g) * n;
+        std::memcpy(f_re, row_f_re, sizeof(float) * half); std::memcpy(f_im, row_f_im, sizeof(float) * half);
+        std::memcpy(g_re, row_g_re, sizeof(float) * half); std::memcpy(g_im, row_g_im, sizeof(float) * half);
+        SplitPackedSpectrum(f_re, f_im, g_re, g_im, row_f_re, row_f_im, half);
+        if (g != f) SplitPackedSpectrum(g_re, g_im, f_re, f_im, row_g_re, row_g_im, half);
+    }
+
+    Transpose(re, n);
+    Transpose(im, n);
+    FftColumns(re, im, plan, half + 1);
+    // F(fx, fy) = conj(F(-fx, -fy)) for the rest.
+    for (int fx = 0; fx < n; ++fx) {
+        const size_t mirror = static_cast<size_t>((n - fx) & (n - 1)) * n;
+        MirrorConjugate(re + mirror, im + mirror, re + static_cast<size_t>(fx) * n, im + static_cast<size_t>(fx) * n, half + 1, n);
+    }
+}
+
+// Inverse of RealFft2d() for a spectrum of a real plane (every product of such
+// spectra is one): the plane, scaled by 1 / n^2, in 're' in the normal layout.
+// The same two tricks in reverse, so again half-size transforms.
+void InverseRealFft2d(float* re, float* im, const FftPlan& plan) {
+    const int n = plan.n, half = n / 2;
+    InverseFftColumns(re, im, plan, half + 1);
+    Transpose(re, n);
+    Transpose(im, n);
+
+    // Rows 0..n/2 now hold Y(fy, x), each column Hermitian in fy. Pack columns
+    // 2k, 2k + 1 into Z = Y(., 2k) + i Y(., 2k + 1), whose inverse is x(., 2k) + i x(., 2k + 1).
+    float even_re[CorrelationTracker::MAX_PATCH / 2], odd_re[CorrelationTracker::MAX_PATCH / 2];
+    float even_im[CorrelationTracker::MAX_PATCH / 2], odd_im[CorrelationTracker::MAX_PATCH / 2];
+    for (int f = 0; f <= half; ++f) {
+        const int g = (n - f) & (n - 1);
+        float* row_f_re = re + static_cast<size_t>(f) * n; float* row_f_im = im + static_cast<size_t>(f) * n;
+        float* row_g_re = re + static_cast<size_t>(g) * n; float* row_g_im = im + static_cast<size_t>(g) * n;
+        Deinterleave(row_f_re, even_re, odd_re, half);
+        Deinterleave(row_f_im, even_im, odd_im, half);
+        for (int k = 0; k < half; ++k) {
+            row_f_re[k] = even_re[k] - odd_im[k];
+            row_f_im[k] = even_im[k] + odd_re[k];
+        }
+        if (g == f) continue;
+        for (int k = 0; k < half; ++k) {   // Y(-f, x) = conj(Y(f, x))
+            row_g_re[k] = even_re[k] + odd_im[k];
+            row_g_im[k] = odd_re[k] - even_im[k];
+        }
+    }
+    InverseFftColumns(re, im, plan, half);
+
+    const float scale = 1.0f / (static_cast<float>(n) * n);
+    float row[CorrelationTracker::MAX_PATCH];
+    for (int y = 0; y < n; ++y) {
+        float* dst = re + static_cast<size_t>(y) * n;
+        Interleave(dst, im + static_cast<size_t>(y) * n, row, half, scale);
+        std::memcpy(dst, row, sizeof(float) * n);
+    }
+}
+
+// out = conj(a) * b
+void MulConj(const float* a_re, const float* a_im, const float* b_re, const float* b_im, float* out_re, float* out_im, size_t count) {
+    size_t i = 0;
+#if SIM_CF_SSE2
+    for (; i + 4 <= count; i += 4) {
+        __m128 ar = _mm_loadu_ps(a_re + i), ai = _mm_loadu_ps(a_im + i);
+        __m128 br = _mm_loadu_ps(b_re + i), bi = _mm_loadu_ps(b_im + i);
+        _mm_storeu_ps(out_re + i, _mm_add_ps(_mm_mul_ps(ar, br), _mm_mul_ps(ai, bi)));
+        _mm_storeu_ps(out_im + i, _mm_sub_ps(_mm_mul_ps(ar, bi), _mm_mul_ps(ai, br)));
+    }
+#endif
+    for (; i < count; ++i) {
+        float re = a_re[i] * b_re[i] + a_im[i] * b_im[i];
+        float im = a_re[i] * b_im[i] - a_im[i] * b_re[i];
+        out_re[i] = re;
+        out_im[i] = im;
+    }
+}
+
+// out = a * b
+void Mul(const float* a_re, const float* a_im, const float* b_re, const float* b_im, float* out_re, float* out_im, size_t count) {
+    size_t i = 0;
+#if SIM_CF_SSE2
+    for (; i + 4 <= count; i += 4) {
+        __m128 ar = _mm_loadu_ps(a_re + i), ai = _mm_loadu_ps(a_im + i);
+        __m128 br = _mm_loadu_ps(b_re + i), bi = _mm_loadu_ps(b_im + i);
+        _mm_storeu_ps(out_re + i, _mm_sub_ps(_mm_mul_ps(ar, br), _mm_mul_ps(ai, bi)));
+        _mm_storeu_ps(out_im + i, _mm_add_ps(_mm_mul_ps(ar, bi), _mm_mul_ps(ai, br)));
+    }
+#endif
+    for (; i < count; ++i) {
+        float re = a_re[i] * b_re[i] - a_im[i] * b_im[i];
+        float im = a_re[i] * b_im[i] + a_im[i] * b_re[i];
+        out_re[i] = re;
+        out_im[i] = im;
+    }
+}
+
+// dst += rate * (src - dst)
+void Blend(float* dst, const float* src, float rate, size_t count) {
+    size_t i = 0;
+#if SIM_CF_SSE2
+    const __m128 r = _mm_set1_ps(rate);
+    for (; i + 4 <= count; i += 4) {
+        __m128 d = _mm_loadu_ps(dst + i);
+        _mm_storeu_ps(dst + i, _mm_add_ps(d, _mm_mul_ps(r, _mm_sub_ps(_mm_loadu_ps(src + i), d))));
+    }
+#endif
+    for (; i < count; ++i) dst[i] += rate * (src[i] - dst[i]);
+}
+
+#if SIM_CF_SSE2
+// exp() on four lanes, Cephes-style: 2^n times a degree-5 polynomial on the
+// reduced argument. Relative error ~1e-7 over the clamped range; underflows to
+// a tiny value rather than 0 at the bottom, which the kernel does not mind.
+inline __m128 ExpLanes(__m128 x) {
+    x = _mm_min_ps(_mm_max_ps(x, _mm_set1_ps(-87.0f)), _mm_set1_ps(88.0f));
+    __m128 fx = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(1.44269504088896341f)), _mm_set1_ps(0.5f));
+    __m128i n = _mm_cvttps_epi32(fx);
+    __m128 floor_fx = _mm_cvtepi32_ps(n);
+    __m128 too_big = _mm_cmpgt_ps(floor_fx, fx);                    // truncation rounded a negative value up
+    floor_fx = _mm_sub_ps(floor_fx, _mm_and_ps(too_big, _mm_set1_ps(1.0f)));
+    n = _mm_cvttps_epi32(floor_fx);
+    x = _mm_sub_ps(x, _mm_mul_ps(floor_fx, _mm_set1_ps(0.693359375f)));
+    x = _mm_sub_ps(x, _mm_mul_ps(floor_fx, _mm_set1_ps(-2.12194440e-4f)));
+    __m128 y = _mm_set1_ps(1.9875691500e-4f);
+    y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(1.3981999507e-3f));
+    y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(8.3334519073e-3f));
+    y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(4.1665795894e-2f));
+    y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(1.6666665459e-1f));
+    y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(5.0000001201e-1f));
+    y = _mm_add_ps(_mm_add_ps(_mm_mul_ps(y, _mm_mul_ps(x, x)), x), _mm_set1_ps(1.0f));
+    __m128 pow2n = _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(n, _mm_set1_epi32(127)), 23));
+    return _mm_mul_ps(y, pow2n);
+}
+#endif
+
+// Gaussian kernel from the cross-correlation c (in place):
+//   k = exp(-max(0, (xx + zz - 2c) / count) / sigma^2)
+void GaussianKernel(float* c, float xx, float zz, float inv_count, float inv_sigma_sq, size_t count) {
+    size_t i = 0;
+#if SIM_CF_SSE2
+    const __m128 norms = _mm_set1_ps(xx + zz), two = _mm_set1_ps(2.0f), zero = _mm_setzero_ps();
+    const __m128 to_exponent = _mm_set1_ps(-inv_count * inv_sigma_sq);
+    for (; i + 4 <= count; i += 4) {
+        __m128 distance = _mm_max_ps(zero, _mm_sub_ps(norms, _mm_mul_ps(two, _mm_loadu_ps(c + i))));
+        _mm_storeu_ps(c + i, ExpLanes(_mm_mul_ps(distance, to_exponent)));
+    }
+#endif
+    for (; i < count; ++i) c[i] = std::exp(-std::max(0.0f, (xx + zz - 2.0f * c[i]) * inv_count) * inv_sigma_sq);
+}
+
+inline int ClampIndex(int value, int limit) {
+    return value < 0 ? 0 : (value >= limit ? limit - 1 : value);
+}
+
+// Luma of pixel x of a 1, 3 or 4 channel row: BT.601 in Q16, as cv::COLOR_BGR2GRAY.
+template<int CHANNELS>
+inline int PixelLuma(const uint8_t* row, int x) {
+    if (CHANNELS == 1) return row[x];
+    const uint8_t* pixel = row + static_cast<size_t>(x) * CHANNELS;
+    return (7471 * pixel[0] + 38470 * pixel[1] + 19595 * pixel[2] + 32768) >> 16;
+}
+
+// dst = a + t * (b - a)
+inline void Lerp(const float* a, const float* b, float t, float* dst, int n) {
+    int i = 0;
+#if SIM_CF_SSE2
+    const __m128 tt = _mm_set1_ps(t);
+    for (; i + 4 <= n; i += 4) {
+        __m128 va = _mm_loadu_ps(a + i);
+        _mm_storeu_ps(dst + i, _mm_add_ps(va, _mm_mul_ps(tt, _mm_sub_ps(_mm_loadu_ps(b + i), va))));
+    }
+#endif
+    for (; i < n; ++i) dst[i] = a[i] + t * (b[i] - a[i]);
+}
+
+// Bilinear resample of the n x n window into 'out' as lut[luma]. Pixel i covers
+// [i, i + 1), so positions are shifted by half a pixel onto the centres.
+template<int CHANNELS>
+void SampleWindow(const cv::Mat& frame, const float* lut, double centre_x, double centre_y, double scale, double angle,
+                  int n, float* out) {
+    const double half = n / 2.0;
+    if (angle == 0.0) {
+        // Unrotated (every Update()): the taps are separable, so work them out once per column.
+        int x_a[CorrelationTracker::MAX_PATCH], x_b[CorrelationTracker::MAX_PATCH];
+        float f_x[CorrelationTracker::MAX_PATCH];
+        for (int u = 0; u < n; ++u) {
+            double sx = centre_x + (u - half + 0.5) * scale - 0.5;
+            int x0 = static_cast<int>(std::floor(sx));
+            f_x[u] = static_cast<float>(sx - x0);
+            x_a[u] = ClampIndex(x0, frame.cols);
+            x_b[u] = ClampIndex(x0 + 1, frame.cols);
+        }
+        // Each source row is converted and interpolated along x once, into a line of
+        // n features; consecutive patch rows mostly share their two lines.
+        const int x_first = x_a[0], span = x_b[n - 1] - x_first + 1;
+        auto convert = [&](int y, float* line) {
+            const uint8_t* row = frame.ptr<uint8_t>(y);
+            if (span <= LINE_CACHE) {
+                // Up to 2 frame px per patch px (the usual case): each source pixel once.
+                float source[LINE_CACHE];
+                for (int x = 0; x < span; ++x) source[x] = lut[PixelLuma<CHANNELS>(row, x_first + x)];
+                for (int u = 0; u < n; ++u) {
+                    float left = source[x_a[u] - x_first], right = source[x_b[u] - x_first];
+                    line[u] = left + f_x[u] * (right - left);
+                }
+            } else {
+                for (int u = 0; u < n; ++u) {
+                    float left = lut[PixelLuma<CHANNELS>(row, x_a[u])], right = lut[PixelLuma<CHANNELS>(row, x_b[u])];
+                    line[u] = left + f_x[u] * (right - left);
+                }
+            }
+        };
+        float line_storage[2][CorrelationTracker::MAX_PATCH];
+        float* line_a = line_storage[0];
+        float* line_b = line_storage[1];
+        int line_a_row = -1, line_b_row = -1;
+        for (int v = 0; v < n; ++v) {
+            double sy = centre_y + (v - half + 0.5) * scale - 0.5;
+            int y0 = static_cast<int>(std::floor(sy));
+            const int y_a = ClampIndex(y0, frame.rows), y_b = ClampIndex(y0 + 1, frame.rows);
+            if (y_a != line_a_row) {
+                if (y_a == line_b_row) { std::swap(line_a, line_b); std::swap(line_a_row, line_b_row); }
+                else { convert(y_a, line_a); line_a_row = y_a; }
+            }
+            if (y_b != line_b_row) { convert(y_b, line_b); line_b_row = y_b; }
+            Lerp(line_a, line_b, static_cast<float>(sy - y0), out + static_cast<size_t>(v) * n, n);
+        }
+        return;
+    }
+
+    const double cos_s = std::cos(angle) * scale, sin_s = std::sin(angle) * scale;
+    for (int v = 0; v < n; ++v) {
+        double dv = v - half + 0.5;
+        float* dst = out + static_cast<size_t>(v) * n;
+        for (int u = 0; u < n; ++u) {
+            double du = u - half + 0.5;
+            double sx = centre_x + cos_s * du - sin_s * dv - 0.5;
+            double sy = centre_y + sin_s * du + cos_s * dv - 0.5;
+            int x0 = static_cast<int>(std::floor(sx)), y0 = static_cast<int>(std::floor(sy));
+            float f_x = static_cast<float>(sx - x0), f_y = static_cast<float>(sy - y0);
+            int x_a = ClampIndex(x0, frame.cols), x_b = ClampIndex(x0 + 1, frame.cols);
+            const uint8_t* row_a = frame.ptr<uint8_t>(ClampIndex(y0, frame.rows));
+            const uint8_t* row_b = frame.ptr<uint8_t>(ClampIndex(y0 + 1, frame.rows));
+            float top_l = lut[PixelLuma<CHANNELS>(row_a, x_a)], top_r = lut[PixelLuma<CHANNELS>(row_a, x_b)];
+            float bottom_l = lut[PixelLuma<CHANNELS>(row_b, x_a)], bottom_r = lut[PixelLuma<CHANNELS>(row_b, x_b)];
+            float top = top_l + f_x * (top_r - top_l);
+            float bottom = bottom_l + f_x * (bottom_r - bottom_l);
+            dst[u] = top + f_y * (bottom - top);
+        }
+    }
+}
+
+// Offset of the vertex of the parabola through (-1, left), (0, centre), (1, right), within +-0.5.
+double ParabolicPeakOffset(float left, float centre, float right) {
+    double curvature = static_cast<double>(left) - 2.0 * centre + right;
+    if (curvature >= 0.0) return 0.0; // not a maximum (flat response)
+    return std::min(std::max(0.5 * (left - right) / curvature, -0.5), 0.5);
+}
+
+} // namespace
+
+CorrelationTracker::CorrelationTracker(CorrelationKernel kernel, const CorrelationTrackerParams& params)
+    : m_kernel(kernel), m_params(params) {
+    const size_t plane = static_cast<size_t>(MAX_PATCH) * MAX_PATCH;
+    m_storage.assign(plane * PLANE_COUNT, 0.0f);
+    float* next = m_storage.data();
+    float** planes[PLANE_COUNT] = { &m_patch, &m_g_re, &m_g_im, &m_a_re, &m_a_im, &m_b, &m_model_re, &m_model_im,
+                                    &m_x_re, &m_x_im, &m_w_re, &m_w_im, &m_response };
+    for (float** p : planes) { *p = next; next += plane; }
+    for (int i = 0; i < 256; ++i) m_lut[i] = 0.0f;
+    PlanFor(MAX_PATCH); // builds the plans now rather than on the first Init()
+}
+
+void CorrelationTracker::Sample(const cv::Mat& frame, double centre_x, double centre_y, double scale, double angle) {
+    const int n = m_n;
+    switch (frame.channels()) {
+        case 1:  SampleWindow<1>(frame, m_lut, centre_x, centre_y, scale, angle, n, m_patch); break;
+        case 3:  SampleWindow<3>(frame, m_lut, centre_x, centre_y, scale, angle, n, m_patch); break;
+        default: SampleWindow<4>(frame, m_lut, centre_x, centre_y, scale, angle, n, m_patch); break;
+    }
+
+    const float* window = PlanFor(n).window.data();
+    const size_t count = static_cast<size_t>(n) * n;
+    if (m_kernel == CorrelationKernel::Linear) {
+        // MOSSE: zero mean, unit variance before the window, so lighting changes do not move the filter.
+        double sum = 0.0, sum_sq = 0.0;
+        for (size_t i = 0; i < count; ++i) { sum += m_patch[i]; sum_sq += static_cast<double>(m_patch[i]) * m_patch[i]; }
+        double mean = sum / count;
+        double deviation = std::sqrt(std::max(sum_sq / count - mean * mean, 0.0)) + 1e-5;
+        const float offset = static_cast<float>(mean), gain = static_cast<float>(1.0 / deviation);
+        for (size_t i = 0; i < count; ++i) m_patch[i] = (m_patch[i] - offset) * gain * window[i];
+    } else {
+        for (size_t i = 0; i < count; ++i) m_patch[i] *= window[i];
+    }
+}
+
+float CorrelationTracker::Transform(float* re, float* im) {
+    const size_t count = static_cast<size_t>(m_n) * m_n;
+    float norm = 0.0f;
+    for (size_t i = 0; i < count; ++i) {
+        re[i] = m_patch[i];
+        im[i] = 0.0f;
+        norm += m_patch[i] * m_patch[i];
+    }
+    RealFft2d(re, im, PlanFor(m_n));
+    return norm;
+}
+
+void CorrelationTracker::KernelCorrelation(const float* x_re, const float* x_im, float xx, const float* z_re, const float* z_im, float zz,
+                                           float* out_re, float* out_im) {
+    const FftPlan& plan = PlanFor(m_n);
+    const size_t count = static_cast<size_t>(m_n) * m_n;
+    MulConj(x_re, x_im, z_re, z_im, out_re, out_im, count);
+    InverseRealFft2d(out_re, out_im, plan);     // out_re(t) = sum_s x(s) z(s + t)
+    const float inv_count = 1.0f / static_cast<float>(count);
+    const float inv_sigma_sq = static_cast<float>(1.0 / (m_params.kernel_sigma * m_params.kernel_sigma));
+    GaussianKernel(out_re, xx, zz, inv_count, inv_sigma_sq, count);
+    RealFft2d(out_re, out_im, plan);
+}
+
+void CorrelationTracker::Train(float x_norm, float rate) {
+    const size_t count = static_cast<size_t>(m_n) * m_n;
+    if (m_kernel == CorrelationKernel::Linear) {
+        // A += rate * (G conj(X) - A), B += rate * (|X|^2 - B)
+        MulConj(m_x_re, m_x_im, m_g_re, m_g_im, m_w_re, m_w_im, count);
+        Blend(m_a_re, m_w_re, rate, count);
+        Blend(m_a_im, m_w_im, rate, count);
+        for (size_t i = 0; i < count; ++i) m_w_re[i] = m_x_re[i] * m_x_re[i] + m_x_im[i] * m_x_im[i];
+        Blend(m_b, m_w_re, rate, count);
+        return;
+    }
+    // alpha = G / (K_xx + lambda), then both alpha and the model sample are interpolated.
+    KernelCorrelation(m_x_re, m_x_im, x_norm, m_x_re, m_x_im, x_norm, m_w_re, m_w_im);
+    const float lambda = static_cast<float>(m_params.lambda);
+    for (size_t i = 0; i < count; ++i) {
+        float k_re = m_w_re[i] + lambda, k_im = m_w_im[i];
+        float inv = 1.0f / (k_re * k_re + k_im * k_im);
+        float re = (m_g_re[i] * k_re + m_g_im[i] * k_im) * inv;
+        float im = (m_g_im[i] * k_re - m_g_re[i] * k_im) * inv;
+        m_w_re[i] = re;
+        m_w_im[i] = im;
+    }
+    Blend(m_a_re, m_w_re, rate, count);
+    Blend(m_a_im, m_w_im, rate, count);
+    Blend(m_model_re, m_x_re, rate, count);
+    Blend(m_model_im, m_x_im, rate, count);
+    // Spatial norm of the blended model, by Parseval.
+    double energy = 0.0;
+    for (size_t i = 0; i < count; ++i) energy += static_cast<double>(m_model_re[i]) * m_model_re[i] + static_cast<double>(m_model_im[i]) * m_model_im[i];
+    m_model_norm = static_cast<float>(energy / count);
+}
+
+double CorrelationTracker::Detect(float z_norm, double& peak_x, double& peak_y) {
+    const int n = m_n;
+    const size_t count = static_cast<size_t>(n) * n;
+    if (m_kernel == CorrelationKernel::Linear) {
+        // R = A / (B + lambda) * Z
+        Mul(m_a_re, m_a_im, m_x_re, m_x_im, m_w_re, m_w_im, count);
+        const float lambda = static_cast<float>(m_params.lambda);
+        for (size_t i = 0; i < count; ++i) {
+            float inv = 1.0f / (m_b[i] + lambda);
+            m_w_re[i] *= inv;
+            m_w_im[i] *= inv;
+        }
+    } else {
+        KernelCorrelation(m_model_re, m_model_im, m_model_norm, m_x_re, m_x_im, z_norm, m_w_re, m_w_im);
+        Mul(m_a_re, m_a_im, m_w_re, m_w_im, m_w_re, m_w_im, count);
+    }
+    InverseRealFft2d(m_w_re, m_w_im, PlanFor(n));
+    std::copy(m_w_re, m_w_re + count, m_response);
+
+    size_t peak = 0;
+    float peak_value = m_response[0];
+    double sum = 0.0, sum_sq = 0.0;
+    for (int y = 0; y < n; ++y) {
+        const float* row = m_response + static_cast<size_t>(y) * n;
+        float row_sum = 0.0f, row_sum_sq = 0.0f;
+        for (int x = 0; x < n; ++x) {
+            row_sum += row[x];
+            row_sum_sq += row[x] * row[x];
+            if (row[x] > peak_value) { peak_value = row[x]; peak = static_cast<size_t>(y) * n + x; }
+        }
+        sum += row_sum;
+        sum_sq += row_sum_sq;
+    }
+    const int px = static_cast<int>(peak % n);
+    const int py = static_cast<int>(peak / n);
+    // The response is circular, so the neighbours of an edge peak wrap around.
+    const float* peak_row = m_response + static_cast<size_t>(py) * n;
+    peak_x = px + ParabolicPeakOffset(peak_row[(px + n - 1) % n], peak_value, peak_row[(px + 1) % n]);
+    peak_y = py + ParabolicPeakOffset(m_response[static_cast<size_t>((py + n - 1) % n) * n + px], peak_value,
+                                      m_response[static_cast<size_t>((py + 1) % n) * n + px]);
+
+    // Sidelobe = everything but the window around the peak: take the window back out of the totals.
+    size_t sidelobe = count;
+    for (int y = std::max(0, py - PSR_EXCLUDE_RADIUS); y <= std::min(n - 1, py + PSR_EXCLUDE_RADIUS); ++y) {
+        const float* row = m_response + static_cast<size_t>(y) * n;
+        for (int x = std::max(0, px - PSR_EXCLUDE_RADIUS); x <= std::min(n - 1, px + PSR_EXCLUDE_RADIUS); ++x) {
+            sum -= row[x];
+            sum_sq -= static_cast<double>(row[x]) * row[x];
+            --sidelobe;
+        }
+    }
+    if (sidelobe == 0) return 0.0;
+    double mean = sum / sidelobe;
+    double deviation = std::sqrt(std::max(sum_sq / sidelobe - mean * mean, 0.0));
+    return deviation > 0.0 ? (peak_value - mean) / deviation : 0.0;
+}
+
+bool CorrelationTracker::Init(const cv::Mat& frame, const cv::Rect& box) {
+    if (frame.empty() || frame.depth() != CV_8U || (frame.channels() != 1 && frame.channels() != 3 && frame.channels() != 4)) return false;
+    cv::Rect clipped = box & cv::Rect(0, 0, frame.cols, frame.rows);
+    if (clipped.width < 4 || clipped.height < 4) return false;
+
+    m_box_size = clipped.size();
+    m_centre_x = clipped.x + clipped.width / 2.0;
+    m_centre_y = clipped.y + clipped.height / 2.0;
+    double window_side = m_params.padding * std::max(clipped.width, clipped.height);
+    int n = m_params.patch_size;
+    if (n != 32 && n != 64 && n != 128) n = window_side <= 32.0 ? 32 : 64;
+    m_n = n;
+    m_scale = window_side / n;
+
+    for (int i = 0; i < 256; ++i) {
+        m_lut[i] = m_kernel == CorrelationKernel::Linear ? static_cast<float>(std::log(1.0 + i)) : i / 255.0f - 0.5f;
+    }
+
+    // Desired response: a Gaussian at the patch centre, where the target sits in every training sample.
+    double sigma = std::max(0.5, m_params.output_sigma_factor * std::sqrt(static_cast<double>(clipped.area())) / m_scale);
+    for (int y = 0; y < n; ++y) {
+        for (int x = 0; x < n; ++x) {
+            double dx = x - n / 2, dy = y - n / 2;
+            m_patch[static_cast<size_t>(y) * n + x] = static_cast<float>(std::exp(-(dx * dx + dy * dy) / (2.0 * sigma * sigma)));
+        }
+    }
+    Transform(m_g_re, m_g_im);
+
+    if (m_kernel == CorrelationKernel::Linear) {
+        // MOSSE starts from a few slightly rotated / scaled copies, so the first filter is not fit to one exact view.
+        const double perturbations[][2] = { { 0.0, 1.0 }, { 0.1, 1.0 }, { -0.1, 1.0 }, { 0.0, 0.95 }, { 0.0, 1.05 } };
+        int trained = 0;
+        for (const auto& perturbation : perturbations) {
+            Sample(frame, m_centre_x, m_centre_y, m_scale * perturbation[1], perturbation[0]);
+            float norm = Transform(m_x_re, m_x_im);
+            Train(norm, 1.0f / static_cast<float>(++trained)); // running mean over the samples
+        }
+    } else {
+        Sample(frame, m_centre_x, m_centre_y, m_scale, 0.0);
+        float norm = Transform(m_x_re, m_x_im);
+        Train(norm, 1.0f);
+    }
+    m_last_psr = 0.0;
+    return true;
+}
+
+bool CorrelationTracker::Update(const cv::Mat& frame, cv::Rect& box) {
+    if (m_n == 0 || frame.empty() || frame.depth() != CV_8U) return false;
+    Sample(frame, m_centre_x, m_centre_y, m_scale, 0.0);
+    float norm = Transform(m_x_re, m_x_im);
+    double peak_x = 0.0, peak_y = 0.0;
+    m_last_psr = Detect(norm, peak_x, peak_y);
+    if (m_last_psr < m_params.psr_threshold) return false;
+
+    m_centre_x = std::min(std::max(m_centre_x + (peak_x - m_n / 2) * m_scale, 0.0), static_cast<double>(frame.cols));
+    m_centre_y = std::min(std::max(m_centre_y + (peak_y - m_n / 2) * m_scale, 0.0), static_cast<double>(frame.rows));
+
+    Sample(frame, m_centre_x, m_centre_y, m_scale, 0.0);
+    norm = Transform(m_x_re, m_x_im);
+    Train(norm, static_cast<float>(m_params.learning_rate));
+
+    box = cv::Rect(cvRound(m_centre_x - m_box_size.width / 2.0), cvRound(m_centre_y - m_box_size.height / 2.0),
+                   m_box_size.width, m_box_size.height);
+    return true;
+}
+
+bool CorrelationTracker::SubpixelCentre(cv::Point2d& centre) const {
+    if (m_n == 0) return false;
+    centre = cv::Point2d(m_centre_x, m_centre_y);
+    return true;
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+// In-house correlation-filter tracker: MOSSE (linear) or KCF-style (Gaussian
+// kernel on the grey feature), on a square power-of-two patch around the target.
+// Written for the tracking thread's budget rather than generality:
+//   - patch sizes 32, 64 or 128 only, with the FFT plans (bit reversal, per-stage
+//     twiddles) and the Hann windows built once per size and shared;
+//   - spectra are kept split into real and imaginary planes, so the complex
+//     multiplies and the butterflies (whole rows at a time) run four lanes at a
+//     time (SSE2); every plane transformed is real, so each 2-D FFT is done as
+//     half-size complex ones;
+//   - every buffer is sized for the largest patch when the tracker is created;
+//     Init() and Update() never allocate.
+// The search window is 'padding' times the box's larger side, resampled to the
+// patch (bilinear, BGR converted to luma on the fly), so large targets cost the
+// same as small ones. The peak of the response is interpolated (parabola through
+// it and its neighbours on each axis), so the centre moves in fractions of a patch
+// pixel (SubpixelCentre()). The box keeps its initial size. Update() fails, leaving the
+// box and the model alone, when the peak-to-sidelobe ratio drops below
+// psr_threshold (occlusion, target lost).
+
+#include <cstddef>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "tracker_registry.h"
+
+enum class CorrelationKernel { Linear, Gaussian };
+
+struct CorrelationTrackerParams {
+    int patch_size = 0;                 // 32, 64 or 128; 0 = 32 if the search window fits at 1:1, else 64 (downsampled)
+    double padding = 2.0;               // search window side / larger box side
+    double learning_rate = 0.125;       // model update per successful frame
+    double output_sigma_factor = 0.1;   // desired response sigma / sqrt(box area), in patch pixels
+    double lambda = 1e-4;               // regularisation
+    double kernel_sigma = 0.2;          // Gaussian kernel width (KCF-style only)
+    double psr_threshold = 6.0;         // peak-to-sidelobe ratio below which Update() reports a loss
+};
+
+// Read when a tracker is created (--cf-patch, --cf-padding).
+extern CorrelationTrackerParams g_correlation_tracker_params;
+
+class CorrelationTracker : public TargetTracker {
+public:
+    static const int MAX_PATCH = 128;
+
+    CorrelationTracker(CorrelationKernel kernel, const CorrelationTrackerParams& params);
+
+    bool Init(const cv::Mat& frame, const cv::Rect& box) override;
+    bool Update(const cv::Mat& frame, cv::Rect& box) override;
+    bool SubpixelCentre(cv::Point2d& centre) const override;
+
+    int PatchSize() const { return m_n; }
+    double LastPsr() const { return m_last_psr; }
+
+private:
+    // Resamples the window around (centre_x, centre_y), 'scale' frame px per patch px,
+    // rotated by 'angle' (init perturbations), into m_patch as windowed features.
+    void Sample(const cv::Mat& frame, double centre_x, double centre_y, double scale, double angle);
+    // m_patch -> spectrum (re, im); returns the patch's squared norm (Gaussian kernel).
+    float Transform(float* re, float* im);
+    // Gaussian kernel correlation of two spectra -> spectrum of k in (out_re, out_im).
+    void KernelCorrelation(const float* x_re, const float* x_im, float xx, const float* z_re, const float* z_im, float zz,
+                           float* out_re, float* out_im);
+    // Folds the sample in (m_x_re, m_x_im) into the model: model += rate * (new - model).
+    void Train(float x_norm, float rate);
+    // Response to the sample in (m_x_re, m_x_im) -> m_response; returns the PSR and the peak,
+    // interpolated to a fraction of a patch pixel.
+    double Detect(float z_norm, double& peak_x, double& peak_y);
+
+    CorrelationKernel m_kernel;
+    CorrelationTrackerParams m_params;
+    int m_n = 0;                        // patch side
+    double m_scale = 1.0;               // frame px per patch px
+    double m_centre_x = 0.0, m_centre_y = 0.0;
+    cv::Size m_box_size;
+    float m_lut[256];                   // pixel -> feature (log for MOSSE, centred for KCF)
+    double m_last_psr = 0.0;
+
+    // MAX_PATCH^2 floats each, carved out of one block.
+    std::vector<float> m_storage;
+    float* m_patch;                     // spatial features (windowed)
+    float* m_g_re; float* m_g_im;       // desired response spectrum
+    float* m_a_re; float* m_a_im;       // MOSSE numerator / KCF alpha spectrum
+    float* m_b;                         // MOSSE denominator (real)
+    float* m_model_re; float* m_model_im;   // KCF model sample spectrum
+    float* m_x_re; float* m_x_im;       // current sample spectrum
+    float* m_w_re; float* m_w_im;       // scratch spectrum
+    float* m_response;                  // spatial response
+    float m_model_norm = 0.0f;          // KCF: squared norm of the model sample
+};
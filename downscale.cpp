@@ -0,0 +1,352 @@
+#include "downscale.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "worker_pool.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    #define SIM_DOWNSCALE_X86 1
+    #include <immintrin.h>
+    #if defined(_MSC_VER)
+        #include <intrin.h>
+    #endif
+#else
+    #define SIM_DOWNSCALE_X86 0
+#endif
+
+// GCC/Clang only emit SSE4.1/AVX2 instructions in functions built for them; MSVC
+// accepts the intrinsics anywhere. Either way they only run after the CPUID check.
+#if SIM_DOWNSCALE_X86 && (defined(__GNUC__) || defined(__clang__))
+    #define SIM_TARGET_SSE41 __attribute__((target("sse4.1")))
+    #define SIM_TARGET_AVX2  __attribute__((target("avx2,fma")))
+#else
+    #define SIM_TARGET_SSE41
+    #define SIM_TARGET_AVX2
+#endif
+
+const char* DownscaleFilterName(DownscaleFilter filter) {
+    switch (filter) {
+        case DownscaleFilter::Bilinear: return "bilinear";
+        case DownscaleFilter::Area:     return "area";
+    }
+    return "unknown";
+}
+
+const char* DownscaleIsaName(DownscaleIsa isa) {
+    switch (isa) {
+        case DownscaleIsa::Scalar: return "scalar";
+        case DownscaleIsa::Sse41:  return "sse4.1";
+        case DownscaleIsa::Avx2:   return "avx2";
+    }
+    return "unknown";
+}
+
+bool DownscaleIsaSupported(DownscaleIsa isa) {
+    if (isa == DownscaleIsa::Scalar) return true;
+#if SIM_DOWNSCALE_X86
+    #if defined(_MSC_VER)
+    int regs[4];
+    __cpuid(regs, 1);
+    bool sse41 = (regs[2] & (1 << 19)) != 0;
+    bool fma = (regs[2] & (1 << 12)) != 0;
+    bool os_saves_ymm = (regs[2] & (1 << 27)) != 0 && (regs[2] & (1 << 28)) != 0 && (_xgetbv(0) & 6) == 6;
+    __cpuidex(regs, 7, 0);
+    bool avx2 = (regs[1] & (1 << 5)) != 0;
+    if (isa == DownscaleIsa::Sse41) return sse41;
+    return avx2 && fma && os_saves_ymm;
+    #else
+    __builtin_cpu_init();
+    if (isa == DownscaleIsa::Sse41) return __builtin_cpu_supports("sse4.1");
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    #endif
+#else
+    return false;
+#endif
+}
+
+DownscaleIsa BestDownscaleIsa() {
+    static const DownscaleIsa best = DownscaleIsaSupported(DownscaleIsa::Avx2)  ? DownscaleIsa::Avx2
+                                   : DownscaleIsaSupported(DownscaleIsa::Sse41) ? DownscaleIsa::Sse41
+                                   : DownscaleIsa::Scalar;
+    return best;
+}
+
+namespace {
+
+// Vertical step, over the whole source row: columns[i] = (first ? 0 : columns[i]) + row_weight * row[i].
+typedef void (*VerticalFn)(const uint8_t* row, int count, float row_weight, bool first, float* columns);
+// Horizontal step on the vertically filtered row:
+// out[4*dx + c] = sum_k x_weights[dx*taps + k] * columns[4*(x_start[dx] + k) + c]
+typedef void (*HorizontalFn)(const float* columns, const int* x_start, const float* x_weights, int taps, int width, float* out);
+// Rounds the horizontally filtered BGRA floats into the destination format.
+typedef void (*StoreFn)(const float* acc, int width, int channels, uint8_t* out);
+
+void VerticalScalar(const uint8_t* row, int count, float row_weight, bool first, float* columns) {
+    if (first) {
+        for (int i = 0; i < count; ++i) columns[i] = row_weight * row[i];
+    } else {
+        for (int i = 0; i < count; ++i) columns[i] += row_weight * row[i];
+    }
+}
+
+void HorizontalScalar(const float* columns, const int* x_start, const float* x_weights, int taps, int width, float* out) {
+    for (int dx = 0; dx < width; ++dx, out += 4) {
+        const float* pixel = columns + static_cast<size_t>(x_start[dx]) * 4;
+        const float* weights = x_weights + static_cast<size_t>(dx) * taps;
+        float b = 0.0f, g = 0.0f, r = 0.0f, a = 0.0f;
+        for (int k = 0; k < taps; ++k, pixel += 4) {
+            b += weights[k] * pixel[0];
+            g += weights[k] * pixel[1];
+            r += weights[k] * pixel[2];
+            a += weights[k] * pixel[3];
+        }
+        out[0] = b; out[1] = g; out[2] = r; out[3] = a;
+    }
+}
+
+#if SIM_DOWNSCALE_X86
+
+SIM_TARGET_SSE41 void VerticalSse41(const uint8_t* row, int count, float row_weight, bool first, float* columns) {
+    const __m128 weight = _mm_set1_ps(row_weight);
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+        for (int part = 0; part < 4; ++part) {
+            __m128 values = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(bytes));
+            bytes = _mm_srli_si128(bytes, 4);
+            __m128 weighted = _mm_mul_ps(values, weight);
+            float* out = columns + i + part * 4;
+            _mm_storeu_ps(out, first ? weighted : _mm_add_ps(_mm_loadu_ps(out), weighted));
+        }
+    }
+    VerticalScalar(row + i, count - i, row_weight, first, columns + i);
+}
+
+// One BGRA pixel per tap in the four float lanes.
+SIM_TARGET_SSE41 void HorizontalSse41(const float* columns, const int* x_start, const float* x_weights, int taps, int width, float* out) {
+    for (int dx = 0; dx < width; ++dx, out += 4) {
+        const float* pixel = columns + static_cast<size_t>(x_start[dx]) * 4;
+        const float* weights = x_weights + static_cast<size_t>(dx) * taps;
+        __m128 sum = _mm_mul_ps(_mm_loadu_ps(pixel), _mm_set1_ps(weights[0]));
+        for (int k = 1; k < taps; ++k) sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(pixel + k * 4), _mm_set1_ps(weights[k])));
+        _mm_storeu_ps(out, sum);
+    }
+}
+
+SIM_TARGET_AVX2 void VerticalAvx2(const uint8_t* row, int count, float row_weight, bool first, float* columns) {
+    const __m256 weight = _mm256_set1_ps(row_weight);
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+        __m256 low = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(bytes));
+        __m256 high = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_srli_si128(bytes, 8)));
+        float* out = columns + i;
+        if (first) {
+            _mm256_storeu_ps(out, _mm256_mul_ps(low, weight));
+            _mm256_storeu_ps(out + 8, _mm256_mul_ps(high, weight));
+        } else {
+            _mm256_storeu_ps(out, _mm256_fmadd_ps(low, weight, _mm256_loadu_ps(out)));
+            _mm256_storeu_ps(out + 8, _mm256_fmadd_ps(high, weight, _mm256_loadu_ps(out + 8)));
+        }
+    }
+    VerticalScalar(row + i, count - i, row_weight, first, columns + i);
+}
+
+// Two taps (two adjacent BGRA pixels) per 256-bit FMA; the halves are folded at the end.
+SIM_TARGET_AVX2 void HorizontalAvx2(const float* columns, const int* x_start, const float* x_weights, int taps, int width, float* out) {
+    for (int dx = 0; dx < width; ++dx, out += 4) {
+        const float* pixel = columns + static_cast<size_t>(x_start[dx]) * 4;
+        const float* weights = x_weights + static_cast<size_t>(dx) * taps;
+        __m256 sum2 = _mm256_setzero_ps();
+        int k = 0;
+        for (; k + 1 < taps; k += 2) {
+            __m256 weight2 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_set1_ps(weights[k])), _mm_set1_ps(weights[k + 1]), 1);
+            sum2 = _mm256_fmadd_ps(_mm256_loadu_ps(pixel + k * 4), weight2, sum2);
+        }
+        __m128 sum = _mm_add_ps(_mm256_castps256_ps128(sum2), _mm256_extractf128_ps(sum2, 1));
+        if (k < taps) sum = _mm_fmadd_ps(_mm_loadu_ps(pixel + k * 4), _mm_set1_ps(weights[k]), sum);
+        _mm_storeu_ps(out, sum);
+    }
+}
+
+#endif // SIM_DOWNSCALE_X86
+
+inline uint8_t RoundToByte(float value) {
+    if (value <= 0.0f) return 0;
+    if (value >= 255.0f) return 255;
+    return static_cast<uint8_t>(static_cast<int>(value + 0.5f));
+}
+
+void StoreRow(const float* acc, int width, int channels, uint8_t* out) {
+    switch (channels) {
+        case 4:
+            for (int i = 0; i < width * 4; ++i) out[i] = RoundToByte(acc[i]);
+            break;
+        case 3:
+            for (int dx = 0; dx < width; ++dx, acc += 4, out += 3) {
+                out[0] = RoundToByte(acc[0]);
+                out[1] = RoundToByte(acc[1]);
+                out[2] = RoundToByte(acc[2]);
+            }
+            break;
+        default: // BT.601 luma with the cv::COLOR_BGRA2GRAY weights
+            for (int dx = 0; dx < width; ++dx, acc += 4) {
+                out[dx] = RoundToByte(0.114f * acc[0] + 0.587f * acc[1] + 0.299f * acc[2]);
+            }
+            break;
+    }
+}
+
+#if SIM_DOWNSCALE_X86
+
+// Rounds four BGRA floats to bytes (saturating) and writes BGRA, BGR or luma.
+SIM_TARGET_SSE41 void StoreRowSse41(const float* acc, int width, int channels, uint8_t* out) {
+    if (channels == 1) { StoreRow(acc, width, channels, out); return; }
+    int dx = 0;
+    // BGR writes 4 bytes per pixel and lets the next pixel overwrite the 4th, so the last one is done by StoreRow.
+    int vector_width = (channels == 4) ? width : width - 1;
+    for (; dx < vector_width; ++dx) {
+        __m128i values = _mm_cvtps_epi32(_mm_loadu_ps(acc + static_cast<size_t>(dx) * 4));
+        __m128i bytes = _mm_packus_epi16(_mm_packs_epi32(values, values), values);
+        int32_t packed = _mm_cvtsi128_si32(bytes);
+        memcpy(out + static_cast<size_t>(dx) * channels, &packed, 4);
+    }
+    if (dx < width) StoreRow(acc + static_cast<size_t>(dx) * 4, width - dx, channels, out + static_cast<size_t>(dx) * channels);
+}
+
+#endif // SIM_DOWNSCALE_X86
+
+} // namespace
+
+void FusedDownscaler::BuildTaps(int source_extent, int destination_extent, DownscaleFilter filter, Taps& taps) {
+    const double scale = static_cast<double>(source_extent) / destination_extent;
+    int count = (filter == DownscaleFilter::Bilinear) ? 2 : static_cast<int>(std::ceil(scale)) + 1;
+    taps.count = std::min(count, source_extent);
+    taps.start.assign(destination_extent, 0);
+    taps.weights.assign(static_cast<size_t>(destination_extent) * taps.count, 0.0f);
+
+    for (int d = 0; d < destination_extent; ++d) {
+        // Weights by absolute source index, first..first+n-1.
+        double local[64];
+        int first = 0, n = 0;
+        if (filter == DownscaleFilter::Bilinear) {
+            // Same centre alignment and edge clamping as cv::resize(INTER_LINEAR).
+            double position = (d + 0.5) * scale - 0.5;
+            first = static_cast<int>(std::floor(position));
+            double fraction = position - first;
+            if (first < 0) { first = 0; fraction = 0.0; }
+            if (first >= source_extent - 1) { first = source_extent - 1; fraction = 0.0; }
+            local[0] = 1.0 - fraction;
+            local[1] = fraction;
+            n = (first + 1 < source_extent) ? 2 : 1;
+        } else {
+            double begin = d * scale;
+            double end = std::min((d + 1) * scale, static_cast<double>(source_extent));
+            first = static_cast<int>(std::floor(begin));
+            int last = std::min(source_extent, static_cast<int>(std::ceil(end)));
+            for (int i = first; i < last && n < 64; ++i, ++n) {
+                double overlap = std::min(end, i + 1.0) - std::max(begin, static_cast<double>(i));
+                local[n] = std::max(0.0, overlap) / (end - begin);
+            }
+        }
+
+        // Keep every tap inside the source so the kernels never need bounds checks.
+        int start = std::max(0, std::min(first, source_extent - taps.count));
+        taps.start[d] = start;
+        float* weights = &taps.weights[static_cast<size_t>(d) * taps.count];
+        for (int i = 0; i < n; ++i) {
+            int slot = first + i - start;
+            if (slot >= 0 && slot < taps.count) weights[slot] += static_cast<float>(local[i]);
+        }
+    }
+}
+
+void FusedDownscaler::Configure(cv::Size source_size, cv::Size destination_size, DownscaleFilter filter) {
+    if (m_configured && source_size == m_source_size && destination_size == m_destination_size && filter == m_filter) return;
+    BuildTaps(source_size.width, destination_size.width, filter, m_x);
+    BuildTaps(source_size.height, destination_size.height, filter, m_y);
+    m_column_accumulator.assign(static_cast<size_t>(source_size.width) * 4, 0.0f);
+    m_row_accumulator.assign(static_cast<size_t>(destination_size.width) * 4, 0.0f);
+    m_source_size = source_size;
+    m_destination_size = destination_size;
+    m_filter = filter;
+    m_configured = true;
+}
+
+void FusedDownscaler::Run(const uint8_t* source, size_t source_pitch, cv::Size source_size,
+                          uint8_t* destination, size_t destination_pitch, cv::Size destination_size, int destination_channels,
+                          DownscaleFilter filter) {
+    if (source_size.empty() || destination_size.empty()) return;
+    Configure(source_size, destination_size, filter);
+    RunRows(source, source_pitch, destination, destination_pitch, destination_channels, 0, destination_size.height,
+            m_column_accumulator.data(), m_row_accumulator.data());
+}
+
+int FusedDownscaler::BandRows(cv::Size source_size, cv::Size destination_size, DownscaleFilter filter, int thread_count) {
+    Configure(source_size, destination_size, filter);
+    // Source bytes one output row reads; half of L2 leaves room for the accumulators and the output.
+    size_t row_footprint = static_cast<size_t>(m_y.count) * source_size.width * 4;
+    int rows = static_cast<int>(std::max<size_t>(1, (L2CacheBytes() / 2) / std::max<size_t>(1, row_footprint)));
+    // At least two bands per thread, so the dynamic hand-out can even out a slow core.
+    int max_rows = std::max(1, destination_size.height / std::max(1, 2 * thread_count));
+    return std::min(rows, max_rows);
+}
+
+void FusedDownscaler::Run(const uint8_t* source, size_t source_pitch, cv::Size source_size,
+                          uint8_t* destination, size_t destination_pitch, cv::Size destination_size, int destination_channels,
+                          DownscaleFilter filter, WorkerPool& pool) {
+    if (source_size.empty() || destination_size.empty()) return;
+    const int threads = pool.Size();
+    if (threads <= 1) {
+        Run(source, source_pitch, source_size, destination, destination_pitch, destination_size, destination_channels, filter);
+        return;
+    }
+    const int band_rows = BandRows(source_size, destination_size, filter, threads);
+    if (m_worker_columns.size() < static_cast<size_t>(threads)) {
+        m_worker_columns.resize(threads);
+        m_worker_rows.resize(threads);
+    }
+    for (int worker = 0; worker < threads; ++worker) {
+        m_worker_columns[worker].resize(static_cast<size_t>(source_size.width) * 4);
+        m_worker_rows[worker].resize(static_cast<size_t>(destination_size.width) * 4);
+    }
+
+    const int bands = (destination_size.height + band_rows - 1) / band_rows;
+    auto band = [&](int task, int worker) {
+        int row_begin = task * band_rows;
+        int row_end = std::min(destination_size.height, row_begin + band_rows);
+        RunRows(source, source_pitch, destination, destination_pitch, destination_channels, row_begin, row_end,
+                m_worker_columns[worker].data(), m_worker_rows[worker].data());
+    };
+    pool.ParallelFor(bands, band);
+}
+
+void FusedDownscaler::RunRows(const uint8_t* source, size_t source_pitch, uint8_t* destination, size_t destination_pitch,
+                              int destination_channels, int row_begin, int row_end, float* columns, float* row_out) const {
+    VerticalFn vertical = VerticalScalar;
+    HorizontalFn horizontal = HorizontalScalar;
+    StoreFn store = StoreRow;
+#if SIM_DOWNSCALE_X86
+    if (m_isa == DownscaleIsa::Avx2) { vertical = VerticalAvx2; horizontal = HorizontalAvx2; store = StoreRowSse41; }
+    else if (m_isa == DownscaleIsa::Sse41) { vertical = VerticalSse41; horizontal = HorizontalSse41; store = StoreRowSse41; }
+#endif
+
+    // Per output row: blend its source rows over the full width (one streaming pass over
+    // the rows it needs), then resample that single row horizontally and store it.
+    const int width = m_destination_size.width;
+    const int source_count = m_source_size.width * 4;
+    for (int dy = row_begin; dy < row_end; ++dy) {
+        const float* row_weights = &m_y.weights[static_cast<size_t>(dy) * m_y.count];
+        bool first = true;
+        for (int k = 0; k < m_y.count; ++k) {
+            if (row_weights[k] == 0.0f) continue; // bilinear edges, area padding: row never read
+            const uint8_t* row = source + static_cast<size_t>(m_y.start[dy] + k) * source_pitch;
+            vertical(row, source_count, row_weights[k], first, columns);
+            first = false;
+        }
+        horizontal(columns, m_x.start.data(), m_x.weights.data(), m_x.count, width, row_out);
+        store(row_out, width, destination_channels, destination + static_cast<size_t>(dy) * destination_pitch);
+    }
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+// Fused downscale + channel conversion for BGRA frames. One pass over the
+// source, read straight from a pitched buffer (capture buffer, mapped staging
+// texture), writes a smaller BGRA, BGR or grayscale image; this replaces the
+// cv::resize + cv::cvtColor(BGRA2BGR) chain in front of the tracker.
+//
+// The filter is separable with precomputed weights: every output pixel uses the
+// same number of horizontal and vertical taps. Each output row blends its
+// source rows over the full width first (a straight streaming loop, which is
+// where the SIMD pays off), then resamples that one float row horizontally.
+//   Bilinear - cv::resize(INTER_LINEAR) sampling: 2x2 taps, so only the source
+//              rows that are sampled get read.
+//   Area     - box average over the output pixel's footprint, like
+//              cv::resize(INTER_AREA) when shrinking.
+// Results match the OpenCV chain to within 1 LSB (OpenCV rounds fixed-point
+// weights). Kernels: scalar, SSE4.1 and AVX2+FMA, chosen at runtime from CPUID.
+//
+// With a WorkerPool the output is cut into bands of rows whose source footprint
+// (the rows the band reads) fits in half a core's L2, and the bands are spread
+// over the pool. Every band has its own accumulators, so the result is identical
+// to the single-threaded pass.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+class WorkerPool;
+
+enum class DownscaleFilter { Bilinear, Area };
+enum class DownscaleIsa { Scalar, Sse41, Avx2 };
+
+const char* DownscaleFilterName(DownscaleFilter filter);
+const char* DownscaleIsaName(DownscaleIsa isa);
+bool DownscaleIsaSupported(DownscaleIsa isa);
+DownscaleIsa BestDownscaleIsa();
+
+class FusedDownscaler {
+public:
+    FusedDownscaler() : m_isa(BestDownscaleIsa()) {}
+
+    // 'destination' must already be allocated at the output size as CV_8UC4, CV_8UC3
+    // (BGR, alpha dropped) or CV_8UC1 (BT.601 luma, as cv::COLOR_BGRA2GRAY).
+    void Run(const cv::Mat& bgra, cv::Mat& destination, DownscaleFilter filter) {
+        Run(bgra.data, bgra.step, bgra.size(), destination.data, destination.step, destination.size(), destination.channels(), filter);
+    }
+    void Run(const uint8_t* source, size_t source_pitch, cv::Size source_size,
+             uint8_t* destination, size_t destination_pitch, cv::Size destination_size, int destination_channels,
+             DownscaleFilter filter);
+
+    // Same, with the rows split over 'pool' (the caller runs bands too).
+    void Run(const cv::Mat& bgra, cv::Mat& destination, DownscaleFilter filter, WorkerPool& pool) {
+        Run(bgra.data, bgra.step, bgra.size(), destination.data, destination.step, destination.size(), destination.channels(), filter, pool);
+    }
+    void Run(const uint8_t* source, size_t source_pitch, cv::Size source_size,
+             uint8_t* destination, size_t destination_pitch, cv::Size destination_size, int destination_channels,
+             DownscaleFilter filter, WorkerPool& pool);
+
+    // Output rows per band the parallel path uses for these sizes; benchmarks print it.
+    int BandRows(cv::Size source_size, cv::Size destination_size, DownscaleFilter filter, int thread_count);
+
+    // Benchmarks pin a kernel to compare them; 'isa' must be supported.
+    void SetIsa(DownscaleIsa isa) { m_isa = isa; }
+    DownscaleIsa Isa() const { return m_isa; }
+
+private:
+    struct Taps {
+        int count = 0;                  // taps per output pixel
+        std::vector<int> start;         // first source index per output pixel (start + count <= source extent)
+        std::vector<float> weights;     // count weights per output pixel, summing to 1
+    };
+
+    void Configure(cv::Size source_size, cv::Size destination_size, DownscaleFilter filter);
+    static void BuildTaps(int source_extent, int destination_extent, DownscaleFilter filter, Taps& taps);
+    // Output rows [row_begin, row_end) using the given accumulators (source width * 4, destination width * 4).
+    void RunRows(const uint8_t* source, size_t source_pitch, uint8_t* destination, size_t destination_pitch,
+                 int destination_channels, int row_begin, int row_end, float* columns, float* row_out) const;
+
+    DownscaleIsa m_isa;
+    bool m_configured = false;
+    cv::Size m_source_size;
+    cv::Size m_destination_size;
+    DownscaleFilter m_filter = DownscaleFilter::Bilinear;
+    Taps m_x;
+    Taps m_y;
+    std::vector<float> m_column_accumulator;    // source width * 4: source rows blended vertically
+    std::vector<float> m_row_accumulator;       // destination width * 4 (B, G, R, A)
+    std::vector<std::vector<float>> m_worker_columns;   // parallel path: one pair per pool thread
+    std::vector<std::vector<float>> m_worker_rows;
+};
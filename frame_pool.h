@@ -0,0 +1,54 @@
+#pragma once
+
+// Small ring of reusable cv::Mat buffers for frames that are handed to another
+// thread. A buffer is only reused once every consumer has dropped its reference
+// to it, so the producer never overwrites pixels someone else is still reading.
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include <opencv2/core.hpp>
+
+template <size_t N>
+class FrameBufferPool {
+public:
+    // Returns a buffer of the requested geometry that nobody outside the pool
+    // references. If every buffer is still in use, the oldest slot is replaced by
+    // a fresh allocation (the old pixels stay alive until their last user lets go).
+    //
+    // 'content_tag' points at a per-slot value the caller may use to remember what
+    // the buffer holds (e.g. the frame sequence last written into it). It is reset
+    // to 0 whenever the slot gets new memory, so a non-zero tag always describes
+    // the pixels actually in the buffer.
+    cv::Mat Acquire(int rows, int cols, int type, uint64_t*& content_tag) {
+        for (size_t attempt = 0; attempt < N; ++attempt) {
+            size_t slot = m_next;
+            cv::Mat& candidate = m_buffers[slot];
+            m_next = (m_next + 1) % N;
+            if (IsUnshared(candidate)) {
+                if (candidate.rows != rows || candidate.cols != cols || candidate.type() != type) m_tags[slot] = 0;
+                candidate.create(rows, cols, type);
+                content_tag = &m_tags[slot];
+                return candidate;
+            }
+        }
+        size_t slot = m_next;
+        m_next = (m_next + 1) % N;
+        m_buffers[slot] = cv::Mat(rows, cols, type);
+        m_tags[slot] = 0;
+        content_tag = &m_tags[slot];
+        return m_buffers[slot];
+    }
+
+private:
+    static bool IsUnshared(const cv::Mat& mat) {
+        if (mat.empty() || !mat.u) return true;
+        // Atomic read of OpenCV's reference count: 1 means only the pool holds it.
+        return CV_XADD(&mat.u->refcount, 0) == 1;
+    }
+
+    std::array<cv::Mat, N> m_buffers;
+    std::array<uint64_t, N> m_tags{};
+    size_t m_next = 0;
+};
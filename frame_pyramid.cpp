@@ -0,0 +1,167 @@
+#include "frame_pyramid.h"
+
+#include <cstdlib>
+
+#include <opencv2/imgproc.hpp>
+
+#include "sim_types.h"
+#include "tracking.h"
+#include "worker_pool.h"
+
+const char* PyramidFormatName(PyramidFormat format) {
+    switch (format) {
+        case PyramidFormat::Bgra:  return "bgra";
+        case PyramidFormat::Bgr:   return "bgr";
+        case PyramidFormat::Gray:  return "gray";
+        case PyramidFormat::Count: break;
+    }
+    return "unknown";
+}
+
+int PyramidFormatType(PyramidFormat format) {
+    switch (format) {
+        case PyramidFormat::Bgr:  return CV_8UC3;
+        case PyramidFormat::Gray: return CV_8UC1;
+        default:                  return CV_8UC4;
+    }
+}
+
+PyramidFormat PyramidFormatForChannels(int channels) {
+    if (channels == 1) return PyramidFormat::Gray;
+    if (channels == 3) return PyramidFormat::Bgr;
+    return PyramidFormat::Bgra;
+}
+
+PyramidConfig DefaultPyramidConfig() {
+    PyramidConfig config;
+    config.levels = {
+        { DISPLAY_WIDTH,     DownscaleFilter::Bilinear },
+        { DISPLAY_WIDTH / 2, DownscaleFilter::Area },
+        { DISPLAY_WIDTH / 4, DownscaleFilter::Area },
+    };
+    return config;
+}
+
+FramePyramid::FramePyramid(const PyramidConfig& config) : m_config(config) {
+    m_sizes.resize(m_config.levels.size() + 1);
+    m_levels.resize(m_config.levels.size() + 1);
+}
+
+bool FramePyramid::IsShared(const cv::Mat& mat) {
+    if (mat.empty() || !mat.u) return false;
+    return CV_XADD(&mat.u->refcount, 0) > 1;
+}
+
+void FramePyramid::Reset(const cv::Mat& bgra, const FrameTileMap& tiles, uint64_t sequence) {
+    m_base = bgra;
+    m_tiles = &tiles;
+    m_sequence = sequence;
+    m_pixels_written = 0;
+
+    // Same height rule as ComputeDisplaySize(), so the DISPLAY_WIDTH level is the display frame.
+    m_sizes[0] = bgra.size();
+    double aspect_ratio = bgra.rows > 0 ? static_cast<double>(bgra.cols) / bgra.rows : 1.0;
+    for (size_t i = 0; i < m_config.levels.size(); ++i) {
+        int width = m_config.levels[i].width;
+        int height = static_cast<int>(width / aspect_ratio);
+        m_sizes[i + 1] = cv::Size(width, height > 0 ? height : 1);
+    }
+
+    for (auto& formats : m_levels) {
+        for (LevelImage& level : formats) {
+            level.built = false;
+            if (IsShared(level.image)) {    // someone downstream still reads it: leave it to them
+                level.image = cv::Mat();
+                level.content_sequence = 0;
+            }
+        }
+    }
+}
+
+void FramePyramid::ReleaseBase() {
+    m_base.release();
+    m_tiles = nullptr;
+}
+
+int FramePyramid::LevelClosestToWidth(int width) const {
+    int best = 0;
+    for (int level = 1; level < LevelCount(); ++level) {
+        if (std::abs(m_sizes[level].width - width) < std::abs(m_sizes[best].width - width)) best = level;
+    }
+    return best;
+}
+
+bool FramePyramid::Built(int level, PyramidFormat format) const {
+    if (level < 0 || level >= LevelCount()) return false;
+    if (level == 0 && format == PyramidFormat::Bgra) return !m_base.empty();
+    return m_levels[level][static_cast<int>(format)].built;
+}
+
+bool FramePyramid::InUse() const {
+    for (const auto& formats : m_levels) {
+        for (const LevelImage& level : formats) {
+            if (IsShared(level.image)) return true;
+        }
+    }
+    return false;
+}
+
+const cv::Mat& FramePyramid::Level(int level, PyramidFormat format, FrameWorkspace& workspace) {
+    static const cv::Mat empty;
+    if (level < 0 || level >= LevelCount() || format == PyramidFormat::Count) return empty;
+    if (level == 0 && format == PyramidFormat::Bgra) return m_base;
+    LevelImage& target = Slot(level, format);
+    if (!target.built) {
+        if (!Build(level, format, target, workspace)) return empty;
+        target.built = true;
+    }
+    return target.image;
+}
+
+bool FramePyramid::Build(int level, PyramidFormat format, LevelImage& target, FrameWorkspace& workspace) {
+    const cv::Size size = m_sizes[level];
+    const int type = PyramidFormatType(format);
+    if (target.image.size() != size || target.image.type() != type) target.content_sequence = 0;
+    const int to_format = format == PyramidFormat::Gray ? cv::COLOR_BGRA2GRAY : cv::COLOR_BGRA2BGR;
+
+    if (level == 0) {
+        if (m_base.empty()) return false;
+        cv::cvtColor(m_base, target.image, to_format);
+        target.content_sequence = 0;
+        m_pixels_written += static_cast<size_t>(size.area());
+        return true;
+    }
+
+    // The BGRA level of this width is already there: converting it is a display-sized pass.
+    if (format != PyramidFormat::Bgra && Built(level, PyramidFormat::Bgra)) {
+        cv::cvtColor(Slot(level, PyramidFormat::Bgra).image, target.image, to_format);
+        target.content_sequence = 0;
+        m_pixels_written += static_cast<size_t>(size.area());
+        return true;
+    }
+
+    // A built level of this format at least twice as wide: area-downsample it (nearest one wins).
+    for (int source = level - 1; source >= 1; --source) {
+        if (!Built(source, format) || m_sizes[source].width < 2 * size.width) continue;
+        target.image.create(size, type);
+        cv::resize(Slot(source, format).image, target.image, size, 0, 0, cv::INTER_AREA);
+        target.content_sequence = 0;
+        m_pixels_written += static_cast<size_t>(size.area());
+        return true;
+    }
+
+    if (m_base.empty()) return false;
+    target.image.create(size, type);
+    DownscaleFilter filter = m_config.levels[level - 1].filter;
+    if (format == PyramidFormat::Bgra && filter == DownscaleFilter::Bilinear) {
+        // Only this path leaves the buffer in a state the next frame can update incrementally.
+        m_pixels_written += ResizeToDisplay(m_base, *m_tiles, target.content_sequence, target.image, workspace);
+        target.content_sequence = m_sequence;
+        return true;
+    }
+    if (workspace.downscale_pool) workspace.downscaler.Run(m_base, target.image, filter, *workspace.downscale_pool);
+    else workspace.downscaler.Run(m_base, target.image, filter);
+    target.content_sequence = 0;
+    m_pixels_written += static_cast<size_t>(size.area());
+    return true;
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+// Per-frame image pyramid shared by every stage that needs the capture frame at
+// a smaller size or in another channel format (tracker input, the display frame
+// for preview and recording, re-detection). Stages ask for "the level closest to
+// N px wide" and the pyramid builds it on first request; everyone else asking in
+// the same frame gets the same pixels.
+//
+// Level 0 is the capture frame itself. Levels 1.. are the configured widths
+// (heights keep the capture aspect, as ComputeDisplaySize()), each available as
+// BGRA, BGR or luma:
+//   BGRA, bilinear - ResizeToDisplay() from the capture frame, recomputing only
+//                    blocks whose tiles changed since the frame this pyramid's
+//                    buffer last held (pyramids are pooled, so this is usually a
+//                    partial update)
+//   BGR / luma     - converted from the BGRA level of the same width if that is
+//                    built, else one fused downscale pass from the capture frame
+// Passes over the whole capture frame go through workspace.downscale_pool when
+// one is set.
+// A level at most half as wide as one already built in the same format is area-
+// downsampled from that level instead of read from the capture frame.
+//
+// Level buffers may be kept by other threads (preview, recorder). A pyramid never
+// writes into a buffer that is still referenced elsewhere: Reset() gives such
+// levels fresh memory, the same rule as FrameBufferPool.
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "downscale.h"
+#include "frame_tiles.h"
+#include "frame_workspace.h"
+
+enum class PyramidFormat { Bgra, Bgr, Gray, Count };
+
+const char* PyramidFormatName(PyramidFormat format);
+int PyramidFormatType(PyramidFormat format);            // CV_8UC4 / CV_8UC3 / CV_8UC1
+PyramidFormat PyramidFormatForChannels(int channels);   // 4 / 3 / 1
+
+struct PyramidLevelSpec {
+    int width;
+    DownscaleFilter filter;     // Bilinear matches cv::resize(INTER_LINEAR); Area for heavy reductions
+};
+
+struct PyramidConfig {
+    std::vector<PyramidLevelSpec> levels;   // levels 1.., widest first
+};
+
+// DISPLAY_WIDTH (bilinear, what the tracker and preview have always used), then
+// half and quarter of it (area).
+PyramidConfig DefaultPyramidConfig();
+
+class FramePyramid {
+public:
+    explicit FramePyramid(const PyramidConfig& config = DefaultPyramidConfig());
+
+    // Starts a new frame on a BGRA capture frame. 'tiles' must stay valid until
+    // ReleaseBase(); 'sequence' identifies the frame for incremental updates.
+    void Reset(const cv::Mat& bgra, const FrameTileMap& tiles, uint64_t sequence);
+
+    // Lets go of the capture frame so its buffer can go back to the capture thread.
+    // Levels that are not built yet and need the capture frame come back empty after this.
+    void ReleaseBase();
+
+    int LevelCount() const { return static_cast<int>(m_sizes.size()); }
+    cv::Size LevelSize(int level) const { return m_sizes[level]; }
+    int LevelClosestToWidth(int width) const;
+    bool Built(int level, PyramidFormat format) const;
+    uint64_t Sequence() const { return m_sequence; }
+
+    // The level in 'format', built now if this is its first request in this frame.
+    // Empty on an out-of-range level or when it can no longer be built (see ReleaseBase).
+    // The Mat stays valid (and unmodified) for as long as the caller holds it.
+    const cv::Mat& Level(int level, PyramidFormat format, FrameWorkspace& workspace);
+    const cv::Mat& LevelForWidth(int width, PyramidFormat format, FrameWorkspace& workspace) {
+        return Level(LevelClosestToWidth(width), format, workspace);
+    }
+
+    // Some level buffer is still referenced outside the pyramid (preview, recorder).
+    bool InUse() const;
+
+    // Pixels written building levels since Reset() (benchmarks, stats).
+    size_t PixelsWritten() const { return m_pixels_written; }
+
+private:
+    struct LevelImage {
+        cv::Mat image;
+        uint64_t content_sequence = 0;  // capture frame the buffer's pixels came from (0 = unknown)
+        bool built = false;             // holds this frame's level
+    };
+
+    static bool IsShared(const cv::Mat& mat);
+    LevelImage& Slot(int level, PyramidFormat format) { return m_levels[level][static_cast<int>(format)]; }
+    bool Build(int level, PyramidFormat format, LevelImage& target, FrameWorkspace& workspace);
+
+    PyramidConfig m_config;
+    cv::Mat m_base;
+    const FrameTileMap* m_tiles = nullptr;
+    uint64_t m_sequence = 0;
+    std::vector<cv::Size> m_sizes;
+    std::vector<std::array<LevelImage, static_cast<int>(PyramidFormat::Count)>> m_levels;
+    size_t m_pixels_written = 0;
+};
+
+// Small ring of pyramids, one per frame in flight. Acquire() prefers a pyramid whose
+// level buffers nobody else holds, so its buffers (and their incremental state) are reused.
+template <size_t N>
+class FramePyramidPool {
+public:
+    explicit FramePyramidPool(const PyramidConfig& config = DefaultPyramidConfig()) {
+        for (FramePyramid& pyramid : m_pyramids) pyramid = FramePyramid(config);
+    }
+
+    FramePyramid& Acquire(const cv::Mat& bgra, const FrameTileMap& tiles, uint64_t sequence) {
+        size_t slot = m_next;
+        for (size_t attempt = 0; attempt < N; ++attempt) {
+            size_t candidate = (m_next + attempt) % N;
+            if (!m_pyramids[candidate].InUse()) { slot = candidate; break; }
+        }
+        m_next = (slot + 1) % N;
+        m_pyramids[slot].Reset(bgra, tiles, sequence);
+        return m_pyramids[slot];
+    }
+
+private:
+    std::array<FramePyramid, N> m_pyramids;
+    size_t m_next = 0;
+};
@@ -0,0 +1,303 @@
+#include "frame_source.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+#include <opencv2/imgproc.hpp>
+#include <opencv2/videoio.hpp>
+
+#ifndef M_PI
+    #define M_PI 3.14159265358979323846
+#endif
+
+int64_t MonotonicNowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void CopyPitchedRows(const uint8_t* source, size_t source_pitch, cv::Mat& destination, size_t row_bytes, int rows) {
+    if (source_pitch == row_bytes && destination.isContinuous() && destination.step == row_bytes) {
+        memcpy(destination.data, source, row_bytes * rows); // tightly packed on both sides: one copy
+        return;
+    }
+    for (int y = 0; y < rows; ++y) {
+        memcpy(destination.ptr(y), source + static_cast<size_t>(y) * source_pitch, row_bytes);
+    }
+}
+
+namespace {
+
+// Sleeps until 'deadline_ns' if that is within 'timeout_ms'. Returns false (after
+// sleeping for the timeout) when the deadline is further away than that.
+bool WaitUntil(int64_t deadline_ns, int timeout_ms) {
+    int64_t now_ns = MonotonicNowNs();
+    if (deadline_ns <= now_ns) return true;
+    int64_t timeout_ns = static_cast<int64_t>(timeout_ms) * 1000000;
+    if (deadline_ns - now_ns > timeout_ns) {
+        std::this_thread::sleep_for(std::chrono::nanoseconds(timeout_ns));
+        return false;
+    }
+    std::this_thread::sleep_for(std::chrono::nanoseconds(deadline_ns - now_ns));
+    return true;
+}
+
+// --- cv::VideoCapture file/stream backend ---
+class VideoFrameSource : public FrameSource {
+public:
+    explicit VideoFrameSource(const FrameSourceConfig& config) : m_config(config) {}
+    ~VideoFrameSource() override { Close(); }
+
+    bool Open() override {
+        if (!m_capture.open(m_config.video_path)) {
+            std::cerr << "VideoFrameSource: failed to open '" << m_config.video_path << "'" << std::endl;
+            return false;
+        }
+        m_size = cv::Size(static_cast<int>(m_capture.get(cv::CAP_PROP_FRAME_WIDTH)),
+                          static_cast<int>(m_capture.get(cv::CAP_PROP_FRAME_HEIGHT)));
+        double fps = m_capture.get(cv::CAP_PROP_FPS);
+        m_frame_period_ns = (fps > 0.0) ? static_cast<int64_t>(1e9 / fps) : 0;
+        m_next_frame_ns = MonotonicNowNs();
+        std::cout << "Video frame source opened: " << m_config.video_path << " (" << m_size.width << "x" << m_size.height
+                  << " @ " << fps << " FPS)" << std::endl;
+        return true;
+    }
+
+    void Close() override { m_capture.release(); }
+
+    bool Grab(cv::Mat& destination, FrameInfo& info, int timeout_ms, uint64_t destination_sequence) override {
+        if (!DecodeNext(timeout_ms)) return false;
+
+        // Decoded video has no damage information; diff tile hashes instead (static regions, letterboxing).
+        m_tiles.Reset(m_size);
+        m_tiles.BeginFrame(m_sequence + 1);
+        m_tiles.MarkChangedByHash(m_converted.data, m_converted.step);
+        info.bytes_copied = m_tiles.CopyChanged(m_converted.data, m_converted.step, destination, destination_sequence);
+        info.tiles = m_tiles.Map();
+        FinishFrame(info);
+        return true;
+    }
+
+    bool GrabRegion(cv::Mat& destination, const cv::Rect& region, FrameInfo& info, int timeout_ms) override {
+        if (!DecodeNext(timeout_ms)) return false;
+        cv::Rect clipped = region & cv::Rect(0, 0, m_size.width, m_size.height);
+        if (clipped.area() == 0) return false;
+        // The whole frame is decoded anyway; only the copy into the caller's buffer shrinks.
+        // Tile hashes are left alone: the next Grab() diffs against the last hashed frame.
+        m_converted(clipped).copyTo(destination);
+        info.bytes_copied = static_cast<size_t>(clipped.area()) * 4;
+        info.tiles = FrameTileMap();
+        FinishFrame(info);
+        return true;
+    }
+
+    cv::Size FrameSize() const override { return m_size; }
+    const char* Name() const override { return "video"; }
+
+private:
+    // Paces, decodes and converts the next frame into m_converted (BGRA).
+    bool DecodeNext(int timeout_ms) {
+        if (!m_capture.isOpened()) return false;
+        if (m_config.video_realtime && m_frame_period_ns > 0 && !WaitUntil(m_next_frame_ns, timeout_ms)) return false;
+
+        if (!m_capture.read(m_decoded) || m_decoded.empty()) {
+            if (!m_config.video_loop) return false;
+            m_capture.set(cv::CAP_PROP_POS_FRAMES, 0);
+            if (!m_capture.read(m_decoded) || m_decoded.empty()) return false;
+        }
+
+        if (m_decoded.channels() == 4) m_decoded.copyTo(m_converted);
+        else if (m_decoded.channels() == 3) cv::cvtColor(m_decoded, m_converted, cv::COLOR_BGR2BGRA);
+        else cv::cvtColor(m_decoded, m_converted, cv::COLOR_GRAY2BGRA);
+        m_size = m_converted.size();
+        return true;
+    }
+
+    void FinishFrame(FrameInfo& info) {
+        info.sequence = ++m_sequence;
+        info.generation = info.tiles.Valid() ? m_tiles.Generation() : info.sequence; // region grabs are always new
+        info.timestamp_ns = MonotonicNowNs();
+        m_next_frame_ns = std::max(m_next_frame_ns + m_frame_period_ns, info.timestamp_ns); // no catch-up bursts
+    }
+
+    FrameSourceConfig m_config;
+    cv::VideoCapture m_capture;
+    cv::Mat m_decoded;
+    cv::Mat m_converted;            // BGRA, the tile-diff source
+    TileChangeTracker m_tiles;
+    cv::Size m_size;
+    int64_t m_frame_period_ns = 0;
+    int64_t m_next_frame_ns = 0;
+    uint64_t m_sequence = 0;
+};
+
+// --- Synthetic generator ---
+// Static textured background plus a checkerboard target moving on a Lissajous
+// path around the screen centre. Frame content depends only on the sequence
+// number, so runs are reproducible.
+class SyntheticFrameSource : public FrameSource {
+public:
+    explicit SyntheticFrameSource(const FrameSourceConfig& config) : m_config(config) {}
+
+    bool Open() override {
+        int width = std::max(64, m_config.synthetic_width);
+        int height = std::max(64, m_config.synthetic_height);
+        m_background.create(height, width, CV_8UC4);
+        for (int y = 0; y < height; ++y) {
+            cv::Vec4b* row = m_background.ptr<cv::Vec4b>(y);
+            for (int x = 0; x < width; ++x) {
+                uchar sky = static_cast<uchar>(80 + 120 * y / height);
+                bool grid = (x % 64 == 0) || (y % 64 == 0);
+                row[x] = grid ? cv::Vec4b(60, 60, 60, 255) : cv::Vec4b(sky, static_cast<uchar>(sky / 2 + 40), 40, 255);
+            }
+        }
+        m_target_size = std::max(16, height / 20);
+        m_background.copyTo(m_frame);
+        m_previous_target = cv::Rect();
+        m_tiles.Reset(m_background.size());
+        m_frame_period_ns = (m_config.synthetic_fps > 0.0) ? static_cast<int64_t>(1e9 / m_config.synthetic_fps) : 0;
+        m_next_frame_ns = MonotonicNowNs();
+        std::cout << "Synthetic frame source opened (" << width << "x" << height << " @ "
+                  << m_config.synthetic_fps << " FPS)" << std::endl;
+        return true;
+    }
+
+    void Close() override { m_background.release(); m_frame.release(); }
+
+    bool Grab(cv::Mat& destination, FrameInfo& info, int timeout_ms, uint64_t destination_sequence) override {
+        if (!RenderNext(timeout_ms)) return false;
+        info.bytes_copied = m_tiles.CopyChanged(m_frame.data, m_frame.step, destination, destination_sequence);
+        info.tiles = m_tiles.Map();
+        FinishFrame(info);
+        return true;
+    }
+
+    bool GrabRegion(cv::Mat& destination, const cv::Rect& region, FrameInfo& info, int timeout_ms) override {
+        cv::Rect clipped = region & cv::Rect(0, 0, m_background.cols, m_background.rows);
+        if (clipped.area() == 0 || !RenderNext(timeout_ms)) return false;
+        m_frame(clipped).copyTo(destination);
+        info.bytes_copied = static_cast<size_t>(clipped.area()) * 4;
+        info.tiles = FrameTileMap();
+        FinishFrame(info);
+        return true;
+    }
+
+    cv::Size FrameSize() const override { return m_background.size(); }
+    const char* Name() const override { return "synthetic"; }
+
+private:
+    // Paces and composites frame m_sequence + 1 into m_frame, recording the changed rects.
+    bool RenderNext(int timeout_ms) {
+        if (m_background.empty()) return false;
+        if (m_frame_period_ns > 0 && !WaitUntil(m_next_frame_ns, timeout_ms)) return false;
+
+        // Only the old and new target rects change between frames: restore one, draw the other.
+        m_tiles.BeginFrame(m_sequence + 1);
+        if (m_previous_target.area() > 0) {
+            m_background(m_previous_target).copyTo(m_frame(m_previous_target));
+            m_tiles.MarkChanged(m_previous_target);
+        }
+        cv::Point2d centre = TargetCentre(m_sequence + 1);
+        int half = m_target_size / 2;
+        cv::Rect target(static_cast<int>(centre.x) - half, static_cast<int>(centre.y) - half, m_target_size, m_target_size);
+        target &= cv::Rect(0, 0, m_frame.cols, m_frame.rows);
+        int cell = std::max(2, m_target_size / 4);
+        for (int y = target.y; y < target.y + target.height; ++y) {
+            cv::Vec4b* row = m_frame.ptr<cv::Vec4b>(y);
+            for (int x = target.x; x < target.x + target.width; ++x) {
+                bool dark = (((x - target.x) / cell) + ((y - target.y) / cell)) % 2 == 0;
+                row[x] = dark ? cv::Vec4b(20, 20, 20, 255) : cv::Vec4b(230, 230, 230, 255);
+            }
+        }
+        m_tiles.MarkChanged(target);
+        m_previous_target = target;
+        return true;
+    }
+
+    void FinishFrame(FrameInfo& info) {
+        info.sequence = ++m_sequence;
+        info.generation = info.tiles.Valid() ? m_tiles.Generation() : info.sequence; // region grabs are always new
+        info.timestamp_ns = MonotonicNowNs();
+        m_next_frame_ns = std::max(m_next_frame_ns + m_frame_period_ns, info.timestamp_ns); // no catch-up bursts
+    }
+
+    cv::Point2d TargetCentre(uint64_t sequence) const {
+        double t = static_cast<double>(sequence) / 60.0;
+        double amplitude_x = m_background.cols * 0.15;
+        double amplitude_y = m_background.rows * 0.10;
+        return cv::Point2d(m_background.cols / 2.0 + amplitude_x * std::sin(2.0 * M_PI * 0.13 * t),
+                           m_background.rows / 2.0 + amplitude_y * std::sin(2.0 * M_PI * 0.21 * t + 0.5));
+    }
+
+    FrameSourceConfig m_config;
+    cv::Mat m_background;
+    cv::Mat m_frame;                // current composited frame, updated in place
+    cv::Rect m_previous_target;
+    TileChangeTracker m_tiles;
+    int m_target_size = 32;
+    int64_t m_frame_period_ns = 0;
+    int64_t m_next_frame_ns = 0;
+    uint64_t m_sequence = 0;
+};
+
+} // namespace
+
+std::unique_ptr<FrameSource> CreateVideoFrameSource(const FrameSourceConfig& config) {
+    return std::unique_ptr<FrameSource>(new VideoFrameSource(config));
+}
+
+std::unique_ptr<FrameSource> CreateSyntheticFrameSource(const FrameSourceConfig& config) {
+    return std::unique_ptr<FrameSource>(new SyntheticFrameSource(config));
+}
+
+std::unique_ptr<FrameSource> CreateFrameSource(const FrameSourceConfig& config) {
+    std::unique_ptr<FrameSource> source;
+    switch (config.type) {
+        case FrameSourceType::DXGI:      source = CreateDxgiFrameSource(config); break;
+        case FrameSourceType::X11:       source = CreateX11FrameSource(config); break;
+        case FrameSourceType::VideoFile: source = CreateVideoFrameSource(config); break;
+        case FrameSourceType::Synthetic: source = CreateSyntheticFrameSource(config); break;
+        case FrameSourceType::SharedMemory: source = CreateShmFrameSource(config); break;
+    }
+    if (!source) {
+        std::cerr << "Frame source '" << FrameSourceTypeName(config.type) << "' is not available in this build." << std::endl;
+    }
+    return source;
+}
+
+bool ParseFrameSourceType(const std::string& text, FrameSourceType& type_out) {
+    if (text == "dxgi")      { type_out = FrameSourceType::DXGI; return true; }
+    if (text == "x11")       { type_out = FrameSourceType::X11; return true; }
+    if (text == "video")     { type_out = FrameSourceType::VideoFile; return true; }
+    if (text == "synthetic") { type_out = FrameSourceType::Synthetic; return true; }
+    if (text == "shm")       { type_out = FrameSourceType::SharedMemory; return true; }
+    return false;
+}
+
+bool ParseReadbackMode(const std::string& text, ReadbackMode& mode_out) {
+    if (text == "immediate") { mode_out = ReadbackMode::Immediate; return true; }
+    if (text == "deferred")  { mode_out = ReadbackMode::Deferred; return true; }
+    return false;
+}
+
+const char* ReadbackModeName(ReadbackMode mode) {
+    switch (mode) {
+        case ReadbackMode::Immediate: return "immediate";
+        case ReadbackMode::Deferred:  return "deferred";
+    }
+    return "unknown";
+}
+
+const char* FrameSourceTypeName(FrameSourceType type) {
+    switch (type) {
+        case FrameSourceType::DXGI:      return "dxgi";
+        case FrameSourceType::X11:       return "x11";
+        case FrameSourceType::VideoFile: return "video";
+        case FrameSourceType::Synthetic: return "synthetic";
+        case FrameSourceType::SharedMemory: return "shm";
+    }
+    return "unknown";
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+// Pluggable frame sources. Every backend delivers timestamped BGRA (CV_8UC4)
+// frames into a caller-owned cv::Mat, so the tracking/control pipeline does not
+// care whether pixels come from DXGI desktop duplication, an X11 screen grab, a
+// video file, a simulator's shared-memory frame ring or a synthetic generator.
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include <opencv2/core.hpp>
+
+#include "frame_tiles.h"
+
+enum class FrameSourceType {
+    DXGI,       // Windows desktop duplication (default on Windows)
+    X11,        // X11 MIT-SHM screen grabber (Linux)
+    VideoFile,  // cv::VideoCapture file/stream
+    Synthetic,  // deterministic moving-target generator
+    SharedMemory // named shared-memory frame ring written by the simulator (zero-copy views)
+};
+
+// How a GPU backend reads frames back into system memory.
+enum class ReadbackMode {
+    Immediate,  // map the frame just copied: lowest latency, but the capture thread waits for the GPU copy
+    Deferred    // ring of readback_depth staging buffers: map frame N-(depth-1) while newer copies are in flight
+};
+
+struct FrameSourceConfig {
+    FrameSourceType type = FrameSourceType::DXGI;
+
+    // Readback strategy (DXGI; X11 MIT-SHM, video and synthetic frames are already in
+    // system memory when grabbed, so they have no copy to overlap and ignore it)
+    ReadbackMode readback = ReadbackMode::Immediate;
+    int readback_depth = 2;         // Deferred: staging buffers in the ring (2..8), i.e. depth-1 frames of added latency
+
+    // DXGI
+    unsigned int output_index = 0;
+
+    // Window-targeted capture (DXGI, X11): when either is set, frames are the client
+    // area of the first visible top-level window whose title contains window_title
+    // and whose class is window_class, cropped at copy time and following moves and
+    // resizes (FrameSize() changes with the window). Empty = the whole output.
+    std::string window_title;
+    std::string window_class;
+
+    // X11: display name (empty = $DISPLAY) and capture rate cap
+    std::string x11_display;
+    double x11_max_fps = 60.0;
+
+    // VideoFile
+    std::string video_path;
+    bool video_loop = true;
+    bool video_realtime = true;     // pace frames at the file's FPS; false = as fast as possible
+
+    // SharedMemory: ring name (POSIX shm "/<name>", Win32 mapping "Local\<name>")
+    std::string shm_name = "sim_frames";
+
+    // Synthetic
+    int synthetic_width = 1920;
+    int synthetic_height = 1080;
+    double synthetic_fps = 60.0;    // <= 0 means unpaced
+};
+
+struct FrameInfo {
+    uint64_t sequence = 0;          // increments by one for every delivered frame
+    uint64_t generation = 0;        // sequence of the last frame whose pixels changed: equal generations = identical images
+    int64_t timestamp_ns = 0;       // MonotonicNowNs() when the frame was acquired
+    FrameTileMap tiles;             // which tiles changed in which frame (for incremental downstream work)
+    size_t bytes_copied = 0;        // pixels actually written into 'destination' by this Grab
+};
+
+class FrameSource {
+public:
+    virtual ~FrameSource() = default;
+
+    virtual bool Open() = 0;
+    virtual void Close() = 0;
+
+    // Waits up to timeout_ms for the next frame and copies it into 'destination'
+    // (re-created as CV_8UC4 of FrameSize() if its geometry differs). Returns
+    // false, leaving 'destination' untouched, when no new frame is available.
+    //
+    // destination_sequence is the sequence number of the frame 'destination'
+    // already holds (0 = unknown contents). Only tiles modified since then are
+    // copied, so callers cycling a small buffer pool should pass what each
+    // buffer last received.
+    virtual bool Grab(cv::Mat& destination, FrameInfo& info, int timeout_ms, uint64_t destination_sequence) = 0;
+
+    // Like Grab(), but copies only 'region' (frame pixels, inside FrameSize()) into
+    // 'destination', re-created as CV_8UC4 of region.size() if needed. Used by the
+    // tracker-ROI capture mode; consumes a sequence number like any other frame,
+    // and info.tiles is left without tile information.
+    virtual bool GrabRegion(cv::Mat& destination, const cv::Rect& region, FrameInfo& info, int timeout_ms) = 0;
+
+    // Zero-copy Grab() for sources whose frames already sit in memory we can read
+    // (shared-memory ring): 'view' becomes a read-only CV_8UC4 header over the
+    // source's buffer, which the source will not touch until the last copy of the
+    // header is released. No tile information. Only valid if SupportsViews().
+    virtual bool GrabView(cv::Mat& /*view*/, FrameInfo& /*info*/, int /*timeout_ms*/) { return false; }
+    virtual bool SupportsViews() const { return false; }
+
+    virtual cv::Size FrameSize() const = 0;
+    virtual const char* Name() const = 0;
+};
+
+std::unique_ptr<FrameSource> CreateFrameSource(const FrameSourceConfig& config);
+bool ParseFrameSourceType(const std::string& text, FrameSourceType& type_out);
+const char* FrameSourceTypeName(FrameSourceType type);
+bool ParseReadbackMode(const std::string& text, ReadbackMode& mode_out);
+const char* ReadbackModeName(ReadbackMode mode);
+
+// Monotonic clock shared by all sources and pipeline timestamps.
+int64_t MonotonicNowNs();
+
+// Copies 'rows' rows of 'row_bytes' each from a pitched source (mapped staging
+// texture, XImage) into 'destination', which must already have that geometry.
+void CopyPitchedRows(const uint8_t* source, size_t source_pitch, cv::Mat& destination, size_t row_bytes, int rows);
+
+// Backend factories; return nullptr when the backend is not compiled in.
+std::unique_ptr<FrameSource> CreateDxgiFrameSource(const FrameSourceConfig& config);
+std::unique_ptr<FrameSource> CreateX11FrameSource(const FrameSourceConfig& config);
+std::unique_ptr<FrameSource> CreateVideoFrameSource(const FrameSourceConfig& config);
+std::unique_ptr<FrameSource> CreateSyntheticFrameSource(const FrameSourceConfig& config);
+std::unique_ptr<FrameSource> CreateShmFrameSource(const FrameSourceConfig& config);
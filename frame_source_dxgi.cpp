@@ -0,0 +1,577 @@
+// Windows desktop duplication backend (formerly InitializeDesktopDuplication /
+// CaptureFrameDXGI / CleanupDesktopDuplication in main.cpp).
+//
+// Frames are copied GPU-side into a ring of staging textures. Each texture keeps
+// the frame it last received, so only the tiles changed since then (from the
+// move/dirty rects reported by the duplication API) are copied into it, and only
+// changed tiles are copied out to the caller's buffer. With ReadbackMode::Deferred
+// the ring holds several frames and Map() reads the oldest one while the copies
+// of newer frames are still in flight, instead of stalling on the copy just
+// issued. Region grabs (tracker ROI mode) copy just the window GPU-side and read
+// back only that.
+//
+// With FrameSourceConfig::window_title / window_class set, frames are the target
+// window's client area: dirty rects, GPU copies and readback are all restricted
+// to it, so HUD-free pixels of the simulator are all that reaches the tracker.
+//
+// A lost duplication (mode switch, secure desktop) is re-created on a background
+// thread, on the same device unless that was removed; Grab() keeps returning
+// false meanwhile, and the rest of the pipeline carries on with the last frame.
+
+#include "frame_source.h"
+
+#ifdef _WIN32
+
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <dxgi1_2.h>
+#include <d3d11.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+class DxgiFrameSource : public FrameSource {
+public:
+    explicit DxgiFrameSource(const FrameSourceConfig& config)
+        : m_output_number(config.output_index), m_readback(config.readback),
+          m_ring_size(config.readback == ReadbackMode::Deferred ? std::max(2, std::min(config.readback_depth, MAX_STAGING_SLOTS)) : 1),
+          m_window_title(config.window_title), m_window_class(config.window_class) {}
+    ~DxgiFrameSource() override { Close(); }
+
+    bool Open() override {
+        if (TargetsWindow() && !m_window) {
+            // Client rects must be physical pixels to line up with the duplicated image.
+            SetProcessDPIAware();
+            m_window = FindTargetWindow();
+            if (!m_window) {
+                std::cerr << "No visible window matches title '" << m_window_title << "' / class '" << m_window_class << "'." << std::endl;
+                return false;
+            }
+        }
+        if (!CreateDevice(true)) { Close(); return false; }
+        HRESULT hr = CreateDuplication();
+        if (FAILED(hr)) {
+            std::cerr << "DuplicateOutput failed. HR: " << std::hex << hr << std::dec << std::endl;
+            if (hr == DXGI_ERROR_NOT_CURRENTLY_AVAILABLE) { std::cerr << "Desktop Duplication not currently available." << std::endl; }
+            else if (hr == DXGI_ERROR_UNSUPPORTED) { std::cerr << "Desktop Duplication not supported." << std::endl; }
+            Close(); return false;
+        }
+        m_next_slot = 0;
+        m_pending_count = 0;
+        m_capture_rect = cv::Rect();
+        UpdateCaptureRect();
+
+        std::cout << "Desktop Duplication initialized for output " << m_output_number << " (Full monitor: "
+                  << m_monitor_capture_width << "x" << m_monitor_capture_height << ", readback: "
+                  << ReadbackModeName(m_readback) << ", " << m_ring_size << " staging texture(s))" << std::endl;
+        if (TargetsWindow()) {
+            std::cout << "Capturing the client area of window '" << m_window_title << "' / class '" << m_window_class << "' ("
+                      << m_capture_rect.width << "x" << m_capture_rect.height << " at " << m_capture_rect.x << "," << m_capture_rect.y << ")" << std::endl;
+        }
+        return true;
+    }
+
+    void Close() override {
+        StopRecovery();
+        bool had_resources = m_d3d11_device != nullptr;
+        ReleaseDuplication();
+        ReleaseDevice();
+        if (had_resources) std::cout << "Desktop Duplication cleaned up." << std::endl;
+    }
+
+    bool Grab(cv::Mat& destination, FrameInfo& info, int timeout_ms, uint64_t destination_sequence) override {
+        DXGI_OUTDUPL_FRAME_INFO frame_info;
+        int64_t acquire_time_ns = 0;
+        if (!AcquireFrame(timeout_ms, frame_info, acquire_time_ns)) {
+            // Nothing new on screen: hand out what is still queued in the ring instead of sitting on it.
+            return m_pending_count > 0 && DeliverOldestPending(destination, info, destination_sequence);
+        }
+        if (!UpdateCaptureRect()) return false; // target window minimised, closed or off this output
+
+        RecordFrameChanges(frame_info);
+        StagingSlot& slot = m_staging[m_next_slot];
+        UpdateStagingSlot(slot);
+        slot.sequence = m_sequence;
+        slot.generation = m_tiles.Generation();
+        slot.acquire_time_ns = acquire_time_ns;
+        m_next_slot = (m_next_slot + 1) % m_ring_size;
+        ++m_pending_count;
+
+        // Immediate (ring of one): map the slot just written, waiting for its copy.
+        // Deferred: map the slot written ring_size - 1 frames ago, whose copy has long finished.
+        if (m_pending_count < m_ring_size) return false; // ring still filling up
+        return DeliverOldestPending(destination, info, destination_sequence);
+    }
+
+    bool GrabRegion(cv::Mat& destination, const cv::Rect& region, FrameInfo& info, int timeout_ms) override {
+        DXGI_OUTDUPL_FRAME_INFO frame_info;
+        int64_t acquire_time_ns = 0;
+        if (!AcquireFrame(timeout_ms, frame_info, acquire_time_ns)) return false;
+        if (!UpdateCaptureRect()) return false;
+        cv::Rect clipped = region & cv::Rect(cv::Point(), m_capture_rect.size());
+        if (clipped.area() == 0) return false;
+        cv::Rect source_rect(clipped.tl() + m_capture_rect.tl(), clipped.size()); // output pixels
+
+        // The tracker wants the newest pixels right away: frames still queued in the ring are
+        // dropped (their slots stay valid and catch up through the tile map later).
+        m_pending_count = 0;
+        RecordFrameChanges(frame_info);
+
+        // Only the window reaches this staging texture, so it no longer holds a full frame.
+        StagingSlot& slot = m_staging[m_next_slot];
+        D3D11_BOX box = { static_cast<UINT>(source_rect.x), static_cast<UINT>(source_rect.y), 0,
+                          static_cast<UINT>(source_rect.x + source_rect.width), static_cast<UINT>(source_rect.y + source_rect.height), 1 };
+        m_d3d11_device_context->CopySubresourceRegion(slot.texture, 0, box.left, box.top, 0, m_acquired_desktop_image, 0, &box);
+        slot.sequence = 0;
+        D3D11_MAPPED_SUBRESOURCE mapped_resource;
+        HRESULT hr = m_d3d11_device_context->Map(slot.texture, 0, D3D11_MAP_READ, 0, &mapped_resource);
+        if (FAILED(hr)) return false;
+
+        if (destination.rows != clipped.height || destination.cols != clipped.width || destination.type() != CV_8UC4) {
+            destination.create(clipped.height, clipped.width, CV_8UC4);
+        }
+        const uint8_t* window_pixels = static_cast<const uint8_t*>(mapped_resource.pData)
+                                     + static_cast<size_t>(source_rect.y) * mapped_resource.RowPitch + static_cast<size_t>(source_rect.x) * 4;
+        CopyPitchedRows(window_pixels, mapped_resource.RowPitch, destination, static_cast<size_t>(clipped.width) * 4, clipped.height);
+        m_d3d11_device_context->Unmap(slot.texture, 0);
+
+        info.bytes_copied = static_cast<size_t>(clipped.area()) * 4;
+        info.tiles = FrameTileMap();
+        info.sequence = m_sequence;
+        info.generation = m_sequence;
+        info.timestamp_ns = acquire_time_ns;
+        return true;
+    }
+
+    // The last non-empty capture rect, so buffers keep their size while the target window is minimised.
+    cv::Size FrameSize() const override { return m_frame_size; }
+    const char* Name() const override { return "dxgi"; }
+
+private:
+    static constexpr int MAX_STAGING_SLOTS = 8;
+    // Above this many tile runs a single CopyResource is cheaper than the per-run copies.
+    static constexpr size_t MAX_INCREMENTAL_COPIES = 64;
+    static constexpr int64_t WINDOW_LOOKUP_INTERVAL_NS = 1000000000; // retry finding a closed target window once a second
+    static constexpr int RECOVERY_INITIAL_BACKOFF_MS = 16;
+    static constexpr int RECOVERY_MAX_BACKOFF_MS = 1000;
+
+    struct StagingSlot {
+        ID3D11Texture2D* texture = nullptr;
+        uint64_t sequence = 0;          // frame the texture holds in full (0 = unknown/partial)
+        uint64_t generation = 0;        // that frame's content generation (mouse-only updates keep the previous one)
+        int64_t acquire_time_ns = 0;
+    };
+
+    // Creates the D3D11 device and finds output m_output_number on its adapter (kept in
+    // m_dxgi_output1, so a lost duplication can be re-created without a new device).
+    bool CreateDevice(bool verbose) {
+        HRESULT hr = S_OK;
+        D3D_FEATURE_LEVEL feature_levels[] = { D3D_FEATURE_LEVEL_11_0, D3D_FEATURE_LEVEL_10_1 };
+        hr = D3D11CreateDevice(nullptr, D3D_DRIVER_TYPE_HARDWARE, nullptr, 0, feature_levels, ARRAYSIZE(feature_levels), D3D11_SDK_VERSION, &m_d3d11_device, nullptr, &m_d3d11_device_context);
+        if (FAILED(hr)) { if (verbose) std::cerr << "D3D11CreateDevice failed. HR: " << std::hex << hr << std::dec << std::endl; return false; }
+
+        IDXGIDevice* dxgi_device = nullptr;
+        hr = m_d3d11_device->QueryInterface(__uuidof(IDXGIDevice), reinterpret_cast<void**>(&dxgi_device));
+        if (FAILED(hr)) { if (verbose) std::cerr << "QueryInterface for IDXGIDevice failed. HR: " << std::hex << hr << std::dec << std::endl; return false; }
+
+        IDXGIAdapter* dxgi_adapter = nullptr;
+        hr = dxgi_device->GetParent(__uuidof(IDXGIAdapter), reinterpret_cast<void**>(&dxgi_adapter));
+        dxgi_device->Release();
+        if (FAILED(hr)) { if (verbose) std::cerr << "GetParent for IDXGIAdapter failed. HR: " << std::hex << hr << std::dec << std::endl; return false; }
+
+        IDXGIOutput* dxgi_output = nullptr;
+        hr = dxgi_adapter->EnumOutputs(m_output_number, &dxgi_output);
+        dxgi_adapter->Release();
+        if (FAILED(hr)) { if (verbose) std::cerr << "EnumOutputs failed for output " << m_output_number << ". HR: " << std::hex << hr << std::dec << std::endl; return false; }
+
+        hr = dxgi_output->QueryInterface(__uuidof(IDXGIOutput1), reinterpret_cast<void**>(&m_dxgi_output1));
+        dxgi_output->Release();
+        if (FAILED(hr)) { if (verbose) std::cerr << "QueryInterface for IDXGIOutput1 failed. HR: " << std::hex << hr << std::dec << std::endl; return false; }
+        return true;
+    }
+
+    // Duplicates the output on the existing device. Staging textures are kept unless the
+    // output changed size (a mode switch); either way none of them holds a valid frame now.
+    HRESULT CreateDuplication() {
+        HRESULT hr = m_dxgi_output1->GetDesc(&m_dxgi_output_desc);
+        if (FAILED(hr)) return hr;
+        hr = m_dxgi_output1->DuplicateOutput(m_d3d11_device, &m_dxgi_output_duplication);
+        if (FAILED(hr)) { m_dxgi_output_duplication = nullptr; return hr; }
+
+        int width = m_dxgi_output_desc.DesktopCoordinates.right - m_dxgi_output_desc.DesktopCoordinates.left;
+        int height = m_dxgi_output_desc.DesktopCoordinates.bottom - m_dxgi_output_desc.DesktopCoordinates.top;
+        if (width != m_monitor_capture_width || height != m_monitor_capture_height || !m_staging[0].texture) {
+            ReleaseStaging();
+            m_monitor_capture_width = width;
+            m_monitor_capture_height = height;
+            D3D11_TEXTURE2D_DESC staging_desc; ZeroMemory(&staging_desc, sizeof(staging_desc));
+            staging_desc.Width = m_monitor_capture_width;
+            staging_desc.Height = m_monitor_capture_height;
+            staging_desc.MipLevels = 1;
+            staging_desc.ArraySize = 1; staging_desc.Format = DXGI_FORMAT_B8G8R8A8_UNORM;
+            staging_desc.SampleDesc.Count = 1; staging_desc.Usage = D3D11_USAGE_STAGING;
+            staging_desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+            for (int i = 0; i < m_ring_size; ++i) {
+                hr = m_d3d11_device->CreateTexture2D(&staging_desc, nullptr, &m_staging[i].texture);
+                if (FAILED(hr)) {
+                    std::cerr << "CreateTexture2D for staging failed. HR: " << std::hex << hr << std::dec << std::endl;
+                    ReleaseStaging();
+                    m_dxgi_output_duplication->Release(); m_dxgi_output_duplication = nullptr;
+                    return hr;
+                }
+            }
+        }
+        for (StagingSlot& slot : m_staging) slot.sequence = 0;
+        return S_OK;
+    }
+
+    // Drops the duplication and everything tied to it; the device and staging textures stay.
+    // The capture rect is forgotten so the next frame re-reads it and marks every tile.
+    void ReleaseDuplication() {
+        if (m_frame_held && m_dxgi_output_duplication) m_dxgi_output_duplication->ReleaseFrame();
+        m_frame_held = false;
+        if (m_acquired_desktop_image) { m_acquired_desktop_image->Release(); m_acquired_desktop_image = nullptr; }
+        if (m_dxgi_output_duplication) { m_dxgi_output_duplication->Release(); m_dxgi_output_duplication = nullptr; }
+        for (StagingSlot& slot : m_staging) slot.sequence = 0;
+        m_pending_count = 0;
+        m_capture_rect = cv::Rect();
+    }
+
+    void ReleaseStaging() {
+        for (StagingSlot& slot : m_staging) {
+            if (slot.texture) { slot.texture->Release(); slot.texture = nullptr; }
+            slot.sequence = 0;
+        }
+        m_monitor_capture_width = m_monitor_capture_height = 0;
+    }
+
+    void ReleaseDevice() {
+        ReleaseStaging();
+        if (m_dxgi_output1) { m_dxgi_output1->Release(); m_dxgi_output1 = nullptr; }
+        if (m_d3d11_device_context) { m_d3d11_device_context->Release(); m_d3d11_device_context = nullptr; }
+        if (m_d3d11_device) { m_d3d11_device->Release(); m_d3d11_device = nullptr; }
+    }
+
+    // --- Recovery ---
+    // Losing the duplication (mode switch, full-screen transition, UAC/lock screen) used to
+    // re-create the device inline, stalling the capture thread for hundreds of ms. Now the
+    // D3D objects are handed to a worker that re-duplicates the output on the existing
+    // device (a new device only when it was removed or the output went away), with
+    // exponential backoff. Until it is done Grab() just waits out its timeout and returns
+    // false, so the control loop keeps running on the last good measurement.
+
+    void StartRecovery(bool device_lost) {
+        ReleaseDuplication();
+        if (m_recovery_thread.joinable()) m_recovery_thread.join();
+        {
+            std::lock_guard<std::mutex> lock(m_recovery_mutex);
+            m_recovering = true;
+            m_stop_recovery = false;
+        }
+        std::cout << "Desktop Duplication lost" << (device_lost ? " (device removed)" : "") << ", recovering in the background." << std::endl;
+        m_recovery_thread = std::thread(&DxgiFrameSource::RecoveryLoop, this, device_lost);
+    }
+
+    // Waits up to timeout_ms for a running recovery; true when the capture thread owns the D3D objects.
+    bool WaitForRecovery(int timeout_ms) {
+        std::unique_lock<std::mutex> lock(m_recovery_mutex);
+        m_recovery_cv.wait_for(lock, std::chrono::milliseconds(timeout_ms), [this] { return !m_recovering; });
+        return !m_recovering;
+    }
+
+    void StopRecovery() {
+        {
+            std::lock_guard<std::mutex> lock(m_recovery_mutex);
+            m_stop_recovery = true;
+        }
+        m_recovery_cv.notify_all();
+        if (m_recovery_thread.joinable()) m_recovery_thread.join();
+        m_recovering = false;
+    }
+
+    // Recovery thread: sole owner of the D3D objects until it clears m_recovering.
+    void RecoveryLoop(bool device_lost) {
+        int64_t start_ns = MonotonicNowNs();
+        int attempts = 0;
+        bool device_recreated = false;
+        int backoff_ms = RECOVERY_INITIAL_BACKOFF_MS;
+        while (true) {
+            ++attempts;
+            if (device_lost || !m_d3d11_device || FAILED(m_d3d11_device->GetDeviceRemovedReason())) {
+                ReleaseDevice();
+                device_lost = !CreateDevice(false);
+                device_recreated = true;
+            }
+            if (!device_lost) {
+                HRESULT hr = CreateDuplication();
+                if (SUCCEEDED(hr)) break;
+                // Access denied / not available are transient (secure desktop, mode switch in
+                // progress); anything else may mean the output or adapter changed underneath us.
+                device_lost = !(hr == E_ACCESSDENIED || hr == DXGI_ERROR_NOT_CURRENTLY_AVAILABLE || hr == DXGI_ERROR_SESSION_DISCONNECTED);
+            }
+            std::unique_lock<std::mutex> lock(m_recovery_mutex);
+            if (m_recovery_cv.wait_for(lock, std::chrono::milliseconds(backoff_ms), [this] { return m_stop_recovery; })) return;
+            backoff_ms = std::min(backoff_ms * 2, RECOVERY_MAX_BACKOFF_MS);
+        }
+        std::cout << "Desktop Duplication recovered in " << (MonotonicNowNs() - start_ns) / 1000000 << " ms (" << attempts << " attempt(s), "
+                  << (device_recreated ? "new device" : "device reused") << ", " << m_monitor_capture_width << "x" << m_monitor_capture_height << ")" << std::endl;
+        {
+            std::lock_guard<std::mutex> lock(m_recovery_mutex);
+            m_recovering = false;
+        }
+        m_recovery_cv.notify_all();
+    }
+
+    // Waits for the next desktop frame and holds it in m_acquired_desktop_image until
+    // the next call (Microsoft recommends releasing just before acquiring again, so the
+    // queued copies never race DWM). Hands lost duplications to the recovery thread.
+    bool AcquireFrame(int timeout_ms, DXGI_OUTDUPL_FRAME_INFO& frame_info, int64_t& acquire_time_ns) {
+        if (!WaitForRecovery(timeout_ms)) return false;
+        if (!m_dxgi_output_duplication || !m_d3d11_device_context || !m_staging[0].texture) {
+            StartRecovery(!m_d3d11_device_context);
+            return false;
+        }
+
+        IDXGIResource* desktop_resource = nullptr; HRESULT hr;
+        if (m_frame_held) { m_dxgi_output_duplication->ReleaseFrame(); m_frame_held = false; }
+        if (m_acquired_desktop_image) { m_acquired_desktop_image->Release(); m_acquired_desktop_image = nullptr; }
+
+        hr = m_dxgi_output_duplication->AcquireNextFrame(static_cast<UINT>(timeout_ms), &frame_info, &desktop_resource);
+        if (hr == DXGI_ERROR_WAIT_TIMEOUT) { return false; }
+        if (FAILED(hr)) {
+            if (hr == DXGI_ERROR_ACCESS_LOST) StartRecovery(false);
+            else if (hr == DXGI_ERROR_DEVICE_REMOVED || hr == DXGI_ERROR_DEVICE_RESET) StartRecovery(true);
+            return false;
+        }
+        m_frame_held = true;
+        acquire_time_ns = MonotonicNowNs();
+
+        hr = desktop_resource->QueryInterface(__uuidof(ID3D11Texture2D), reinterpret_cast<void**>(&m_acquired_desktop_image));
+        desktop_resource->Release();
+        return SUCCEEDED(hr);
+    }
+
+    bool TargetsWindow() const { return !m_window_title.empty() || !m_window_class.empty(); }
+
+    struct WindowSearch {
+        const DxgiFrameSource* source;
+        HWND found;
+    };
+
+    static BOOL CALLBACK MatchWindow(HWND window, LPARAM param) {
+        WindowSearch* search = reinterpret_cast<WindowSearch*>(param);
+        if (!IsWindowVisible(window)) return TRUE;
+        char text[256];
+        if (!search->source->m_window_class.empty()
+            && (GetClassNameA(window, text, sizeof(text)) == 0 || search->source->m_window_class != text)) return TRUE;
+        if (!search->source->m_window_title.empty()
+            && (GetWindowTextA(window, text, sizeof(text)) == 0 || strstr(text, search->source->m_window_title.c_str()) == nullptr)) return TRUE;
+        search->found = window;
+        return FALSE;
+    }
+
+    HWND FindTargetWindow() const {
+        WindowSearch search = { this, nullptr };
+        EnumWindows(MatchWindow, reinterpret_cast<LPARAM>(&search));
+        return search.found;
+    }
+
+    // Target window's client area in output pixels, clipped to the output; empty while the
+    // window is minimised, on another output or gone (looked up again once a second).
+    cv::Rect ResolveCaptureRect() {
+        cv::Rect output_rect(0, 0, m_monitor_capture_width, m_monitor_capture_height);
+        if (!TargetsWindow()) return output_rect;
+        if (m_window && !IsWindow(m_window)) {
+            std::cout << "Capture window closed, waiting for it to reappear." << std::endl;
+            m_window = nullptr;
+        }
+        if (!m_window) {
+            int64_t now_ns = MonotonicNowNs();
+            if (now_ns < m_next_window_lookup_ns) return cv::Rect();
+            m_next_window_lookup_ns = now_ns + WINDOW_LOOKUP_INTERVAL_NS;
+            m_window = FindTargetWindow();
+            if (!m_window) return cv::Rect();
+        }
+        RECT client;
+        if (IsIconic(m_window) || !GetClientRect(m_window, &client)) return cv::Rect();
+        POINT origin = { client.left, client.top };
+        if (!ClientToScreen(m_window, &origin)) return cv::Rect();
+        cv::Rect client_rect(origin.x - m_dxgi_output_desc.DesktopCoordinates.left, origin.y - m_dxgi_output_desc.DesktopCoordinates.top,
+                             client.right - client.left, client.bottom - client.top);
+        return client_rect & output_rect;
+    }
+
+    // Follows the target window. When the capture rect moves or changes size, queued frames
+    // are dropped, every staging texture is treated as stale and the next frame marks all
+    // tiles, so both the GPU copy and the copy out start over. Returns false while there is
+    // nothing to capture.
+    bool UpdateCaptureRect() {
+        cv::Rect rect = ResolveCaptureRect();
+        if (rect == m_capture_rect) return rect.area() > 0;
+        m_capture_rect = rect;
+        m_pending_count = 0;
+        for (StagingSlot& slot : m_staging) slot.sequence = 0;
+        if (rect.area() == 0) return false;
+        m_frame_size = rect.size();
+        m_tiles.Reset(m_frame_size);
+        m_capture_rect_changed = true;
+        return true;
+    }
+
+    // Starts frame ++m_sequence in the tile map and marks what the duplication API says
+    // changed: move destinations and dirty rects. Unknown changes mark everything.
+    void RecordFrameChanges(const DXGI_OUTDUPL_FRAME_INFO& frame_info) {
+        m_tiles.BeginFrame(++m_sequence);
+        if (m_capture_rect_changed) {
+            m_tiles.MarkAllChanged();
+            m_capture_rect_changed = false;
+            return;
+        }
+        if (frame_info.LastPresentTime.QuadPart == 0) return; // mouse-only update: desktop image unchanged
+        if (!MarkMetadataRects(frame_info)) m_tiles.MarkAllChanged();
+    }
+
+    bool MarkMetadataRects(const DXGI_OUTDUPL_FRAME_INFO& frame_info) {
+        if (frame_info.TotalMetadataBufferSize == 0) return false;
+        if (m_metadata.size() < frame_info.TotalMetadataBufferSize) m_metadata.resize(frame_info.TotalMetadataBufferSize);
+
+        // Move rects come first in the buffer, dirty rects after them (as in the duplication samples).
+        UINT move_bytes = 0;
+        HRESULT hr = m_dxgi_output_duplication->GetFrameMoveRects(static_cast<UINT>(m_metadata.size()),
+            reinterpret_cast<DXGI_OUTDUPL_MOVE_RECT*>(m_metadata.data()), &move_bytes);
+        if (FAILED(hr)) return false;
+        UINT dirty_bytes = 0;
+        hr = m_dxgi_output_duplication->GetFrameDirtyRects(static_cast<UINT>(m_metadata.size() - move_bytes),
+            reinterpret_cast<RECT*>(m_metadata.data() + move_bytes), &dirty_bytes);
+        if (FAILED(hr)) return false;
+
+        // The acquired image already holds moved content at its destination, so a move
+        // only changes its destination rect.
+        const DXGI_OUTDUPL_MOVE_RECT* move_rects = reinterpret_cast<const DXGI_OUTDUPL_MOVE_RECT*>(m_metadata.data());
+        const RECT* dirty_rects = reinterpret_cast<const RECT*>(m_metadata.data() + move_bytes);
+        for (UINT i = 0; i < move_bytes / sizeof(DXGI_OUTDUPL_MOVE_RECT); ++i) MarkRect(move_rects[i].DestinationRect);
+        for (UINT i = 0; i < dirty_bytes / sizeof(RECT); ++i) MarkRect(dirty_rects[i]);
+        return true;
+    }
+
+    // Output-pixel rect -> capture-rect tiles (MarkChanged clips whatever lies outside).
+    void MarkRect(const RECT& rect) {
+        m_tiles.MarkChanged(cv::Rect(rect.left - m_capture_rect.x, rect.top - m_capture_rect.y, rect.right - rect.left, rect.bottom - rect.top));
+    }
+
+    // Brings a staging texture from the frame it holds up to the acquired one: the tiles
+    // modified since then are copied GPU-side, or the whole capture rect when that is
+    // cheaper (first use, a partial/unknown texture, large changes). Staging textures are
+    // output-sized; only the capture rect of them is ever kept up to date.
+    void UpdateStagingSlot(StagingSlot& slot) {
+        const FrameTileMap& map = m_tiles.Map();
+        bool full_copy = slot.sequence == 0 || !map.Valid() || map.CountChangedSince(slot.sequence) * 2 > map.tiles_x * map.tiles_y;
+        m_copy_boxes.clear();
+        for (int tile_y = 0; !full_copy && tile_y < map.tiles_y; ++tile_y) {
+            int tile_x = 0;
+            while (tile_x < map.tiles_x) {
+                if (!map.TileChangedSince(tile_x, tile_y, slot.sequence)) { ++tile_x; continue; }
+                int run_start = tile_x;
+                while (tile_x < map.tiles_x && map.TileChangedSince(tile_x, tile_y, slot.sequence)) ++tile_x;
+                if (m_copy_boxes.size() == MAX_INCREMENTAL_COPIES) { full_copy = true; break; }
+                D3D11_BOX box;
+                box.left = static_cast<UINT>(m_capture_rect.x + run_start * FRAME_TILE_SIZE);
+                box.top = static_cast<UINT>(m_capture_rect.y + tile_y * FRAME_TILE_SIZE);
+                box.right = static_cast<UINT>(m_capture_rect.x + std::min(tile_x * FRAME_TILE_SIZE, m_capture_rect.width));
+                box.bottom = static_cast<UINT>(m_capture_rect.y + std::min((tile_y + 1) * FRAME_TILE_SIZE, m_capture_rect.height));
+                box.front = 0; box.back = 1;
+                m_copy_boxes.push_back(box);
+            }
+        }
+        if (full_copy && m_capture_rect.size() == cv::Size(m_monitor_capture_width, m_monitor_capture_height)) {
+            m_d3d11_device_context->CopyResource(slot.texture, m_acquired_desktop_image);
+            return;
+        }
+        if (full_copy) {
+            D3D11_BOX box = { static_cast<UINT>(m_capture_rect.x), static_cast<UINT>(m_capture_rect.y), 0,
+                              static_cast<UINT>(m_capture_rect.x + m_capture_rect.width), static_cast<UINT>(m_capture_rect.y + m_capture_rect.height), 1 };
+            m_d3d11_device_context->CopySubresourceRegion(slot.texture, 0, box.left, box.top, 0, m_acquired_desktop_image, 0, &box);
+            return;
+        }
+        for (const D3D11_BOX& box : m_copy_boxes) {
+            m_d3d11_device_context->CopySubresourceRegion(slot.texture, 0, box.left, box.top, 0, m_acquired_desktop_image, 0, &box);
+        }
+    }
+
+    // Maps the oldest queued slot and copies it out. m_tiles may already carry marks of
+    // newer queued frames; copying those tiles as well is harmless (a superset).
+    bool DeliverOldestPending(cv::Mat& destination, FrameInfo& info, uint64_t destination_sequence) {
+        StagingSlot& slot = m_staging[(m_next_slot + m_ring_size - m_pending_count) % m_ring_size];
+        --m_pending_count;
+        D3D11_MAPPED_SUBRESOURCE mapped_resource;
+        HRESULT hr = m_d3d11_device_context->Map(slot.texture, 0, D3D11_MAP_READ, 0, &mapped_resource);
+        if (FAILED(hr)) { slot.sequence = 0; return false; }
+
+        const uint8_t* capture_pixels = static_cast<const uint8_t*>(mapped_resource.pData)
+                                      + static_cast<size_t>(m_capture_rect.y) * mapped_resource.RowPitch + static_cast<size_t>(m_capture_rect.x) * 4;
+        info.bytes_copied = m_tiles.CopyChanged(capture_pixels, mapped_resource.RowPitch, destination, destination_sequence);
+        info.tiles = m_tiles.Map();
+        m_d3d11_device_context->Unmap(slot.texture, 0);
+        info.sequence = slot.sequence;
+        info.generation = slot.generation;
+        info.timestamp_ns = slot.acquire_time_ns;
+        return true;
+    }
+
+    ID3D11Device*           m_d3d11_device = nullptr;
+    ID3D11DeviceContext*    m_d3d11_device_context = nullptr;
+    IDXGIOutput1*           m_dxgi_output1 = nullptr;    // output m_output_number, kept to re-duplicate on the same device
+    IDXGIOutputDuplication* m_dxgi_output_duplication = nullptr;
+    DXGI_OUTPUT_DESC        m_dxgi_output_desc = {};
+    ID3D11Texture2D*        m_acquired_desktop_image = nullptr;
+    bool                    m_frame_held = false;       // AcquireNextFrame succeeded, ReleaseFrame pending
+    std::array<StagingSlot, MAX_STAGING_SLOTS> m_staging;
+    int                     m_next_slot = 0;            // slot the next acquired frame is copied into
+    int                     m_pending_count = 0;        // slots copied but not yet delivered (oldest first)
+    std::vector<uint8_t>    m_metadata;                 // move + dirty rect buffer, grown on demand
+    std::vector<D3D11_BOX>  m_copy_boxes;
+    TileChangeTracker       m_tiles;
+    uint64_t                m_sequence = 0;             // last acquired frame
+    int                     m_monitor_capture_width = 0;
+    int                     m_monitor_capture_height = 0;
+    UINT                    m_output_number = 0;
+    ReadbackMode            m_readback = ReadbackMode::Immediate;
+    int                     m_ring_size = 1;
+    std::string             m_window_title;             // window-targeted capture (empty title and class = whole output)
+    std::string             m_window_class;
+    HWND                    m_window = nullptr;
+    int64_t                 m_next_window_lookup_ns = 0;
+    cv::Rect                m_capture_rect;             // output pixels delivered as frames (whole output, or the window's client area)
+    cv::Size                m_frame_size;               // last non-empty m_capture_rect size
+    bool                    m_capture_rect_changed = false; // mark every tile in the next frame
+    std::thread             m_recovery_thread;
+    std::mutex              m_recovery_mutex;
+    std::condition_variable m_recovery_cv;
+    bool                    m_recovering = false;       // recovery thread owns the D3D objects (guarded by m_recovery_mutex)
+    bool                    m_stop_recovery = false;
+};
+
+} // namespace
+
+std::unique_ptr<FrameSource> CreateDxgiFrameSource(const FrameSourceConfig& config) {
+    return std::unique_ptr<FrameSource>(new DxgiFrameSource(config));
+}
+
+#else
+
+std::unique_ptr<FrameSource> CreateDxgiFrameSource(const FrameSourceConfig&) {
+    return nullptr;
+}
+
+#endif // _WIN32
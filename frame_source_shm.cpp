@@ -0,0 +1,195 @@
+// Shared-memory frame ring backend (see shm_ring.h). The simulator, or
+// SimShmProducer, renders straight into a named ring; this source hands the
+// latest slot to the pipeline either as a zero-copy view (GrabView: a cv::Mat
+// header over the mapped slot that holds a lease on it until the last copy of
+// the header is released) or copied into the caller's buffer like any other
+// backend (Grab, GrabRegion).
+//
+// The ring carries no damage information, so copied frames have no tile map;
+// the producer's content generation is passed through, so a paused simulator
+// still lets the tracker skip unchanged frames. When no frame arrives for a
+// second the ring is re-opened by name, which picks up a restarted producer.
+
+#include "frame_source.h"
+#include "shm_ring.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+namespace {
+
+const int SHM_POLL_INTERVAL_US = 200;
+const int64_t SHM_REATTACH_INTERVAL_NS = 1000000000;
+
+// Lease on one slot, owned by the UMatData of the views wrapping it. Keeps the
+// mapping alive even if the source is closed before the tracker lets go.
+struct ShmSlotLease {
+    std::shared_ptr<ShmRing> ring;
+    int slot = -1;
+};
+
+// Views are plain CV_8UC4 Mats whose UMatData points at the mapped slot; OpenCV's
+// reference counting calls deallocate() when the last header goes away, which is
+// where the lease is handed back to the producer. Never allocates pixels itself.
+class ShmViewAllocator : public cv::MatAllocator {
+public:
+    cv::UMatData* allocate(int, const int*, int, void*, size_t*, cv::AccessFlag, cv::UMatUsageFlags) const override { return nullptr; }
+    bool allocate(cv::UMatData*, cv::AccessFlag, cv::UMatUsageFlags) const override { return false; }
+
+    void deallocate(cv::UMatData* data) const override {
+        if (!data) return;
+        ShmSlotLease* lease = static_cast<ShmSlotLease*>(data->userdata);
+        if (lease) {
+            lease->ring->Release(lease->slot);
+            delete lease;
+        }
+        delete data;
+    }
+
+    cv::Mat Wrap(const std::shared_ptr<ShmRing>& ring, int slot) const {
+        cv::Mat view(ring->Height(), ring->Width(), CV_8UC4, ring->SlotPixels(slot), ring->Pitch());
+        cv::UMatData* data = new cv::UMatData(this);
+        data->data = data->origdata = view.data;
+        data->size = ring->Pitch() * static_cast<size_t>(ring->Height());
+        data->flags |= cv::UMatData::USER_ALLOCATED;
+        data->userdata = new ShmSlotLease{ring, slot};
+        view.u = data;
+        view.allocator = const_cast<ShmViewAllocator*>(this);
+        view.addref();
+        return view;
+    }
+};
+
+const ShmViewAllocator g_shm_view_allocator;
+
+class ShmFrameSource : public FrameSource {
+public:
+    explicit ShmFrameSource(const FrameSourceConfig& config) : m_name(config.shm_name) {}
+    ~ShmFrameSource() override { Close(); }
+
+    bool Open() override {
+        m_ring = ShmRing::Open(m_name);
+        if (!m_ring) {
+            std::cerr << "ShmFrameSource: no frame ring named '" << m_name << "' (start the simulator or SimShmProducer first)." << std::endl;
+            return false;
+        }
+        m_ring->ClearLeases(); // single consumer: anything still leased belonged to a previous one that died
+        m_ring_id = m_ring->RingId();
+        m_last_producer_sequence = 0;
+        m_last_frame_ns = MonotonicNowNs();
+        std::cout << "Shared-memory frame ring '" << m_name << "' attached (" << m_ring->Width() << "x" << m_ring->Height()
+                  << ", " << m_ring->SlotCount() << " slots)" << std::endl;
+        return true;
+    }
+
+    // Outstanding views keep their own reference to the mapping.
+    void Close() override { m_ring.reset(); }
+
+    bool Grab(cv::Mat& destination, FrameInfo& info, int timeout_ms, uint64_t) override {
+        int slot = WaitForSlot(timeout_ms);
+        if (slot < 0) return false;
+        destination.create(m_ring->Height(), m_ring->Width(), CV_8UC4);
+        size_t row_bytes = static_cast<size_t>(m_ring->Width()) * 4;
+        CopyPitchedRows(m_ring->SlotPixels(slot), m_ring->Pitch(), destination, row_bytes, m_ring->Height());
+        info.bytes_copied = row_bytes * m_ring->Height();
+        info.tiles = FrameTileMap();
+        FinishFrame(slot, info, false);
+        m_ring->Release(slot);
+        return true;
+    }
+
+    bool GrabRegion(cv::Mat& destination, const cv::Rect& region, FrameInfo& info, int timeout_ms) override {
+        int slot = WaitForSlot(timeout_ms);
+        if (slot < 0) return false;
+        cv::Rect clipped = region & cv::Rect(0, 0, m_ring->Width(), m_ring->Height());
+        if (clipped.area() == 0) { m_ring->Release(slot); return false; }
+        destination.create(clipped.height, clipped.width, CV_8UC4);
+        const uint8_t* source = m_ring->SlotPixels(slot) + static_cast<size_t>(clipped.y) * m_ring->Pitch() + static_cast<size_t>(clipped.x) * 4;
+        CopyPitchedRows(source, m_ring->Pitch(), destination, static_cast<size_t>(clipped.width) * 4, clipped.height);
+        info.bytes_copied = static_cast<size_t>(clipped.area()) * 4;
+        info.tiles = FrameTileMap();
+        FinishFrame(slot, info, true);
+        m_ring->Release(slot);
+        return true;
+    }
+
+    bool GrabView(cv::Mat& view, FrameInfo& info, int timeout_ms) override {
+        int slot = WaitForSlot(timeout_ms);
+        if (slot < 0) return false;
+        view = g_shm_view_allocator.Wrap(m_ring, slot); // the view owns the lease now
+        info.bytes_copied = 0;
+        info.tiles = FrameTileMap();
+        FinishFrame(slot, info, false);
+        return true;
+    }
+
+    bool SupportsViews() const override { return true; }
+    cv::Size FrameSize() const override { return m_ring ? cv::Size(m_ring->Width(), m_ring->Height()) : cv::Size(); }
+    const char* Name() const override { return "shm"; }
+
+private:
+    // Leases the newest unseen slot, polling until timeout_ms; -1 on timeout.
+    int WaitForSlot(int timeout_ms) {
+        int64_t deadline_ns = MonotonicNowNs() + static_cast<int64_t>(timeout_ms) * 1000000;
+        while (true) {
+            if (m_ring) {
+                int slot = m_ring->AcquireLatest(m_last_producer_sequence);
+                if (slot >= 0) return slot;
+            }
+            int64_t now_ns = MonotonicNowNs();
+            if (now_ns - m_last_frame_ns >= SHM_REATTACH_INTERVAL_NS) Reattach(now_ns);
+            if (now_ns >= deadline_ns) return -1;
+            std::this_thread::sleep_for(std::chrono::microseconds(SHM_POLL_INTERVAL_US));
+        }
+    }
+
+    // A restarted producer creates a new ring under the same name (or, on Windows,
+    // re-initialises the one we still map) with a new ring_id and its sequence starting
+    // over. The id, not the sequence, decides: by the time we look the new producer may
+    // well have published more frames than the old one ever did.
+    void Reattach(int64_t now_ns) {
+        m_last_frame_ns = now_ns;
+        std::shared_ptr<ShmRing> ring = ShmRing::Open(m_name);
+        if (!ring) return;
+        if (m_ring && ring->RingId() == m_ring_id) return; // same producer, just idle
+        std::cout << "Shared-memory frame ring '" << m_name << "' re-attached (" << ring->Width() << "x" << ring->Height() << ")" << std::endl;
+        m_ring = ring;
+        m_ring_id = ring->RingId();
+        m_last_producer_sequence = 0;
+        m_last_producer_generation = 0;
+    }
+
+    void FinishFrame(int slot, FrameInfo& info, bool region) {
+        const ShmRingSlot& source = m_ring->Slot(slot);
+        m_last_producer_sequence = source.sequence.load(std::memory_order_relaxed);
+        m_last_frame_ns = MonotonicNowNs();
+        info.sequence = ++m_sequence;
+
+        uint64_t producer_generation = source.generation.load(std::memory_order_relaxed);
+        if (region || producer_generation == 0 || producer_generation != m_last_producer_generation) m_generation = info.sequence;
+        m_last_producer_generation = region ? 0 : producer_generation;
+        info.generation = m_generation;
+
+        // Same machine, same monotonic clock: the producer's render time makes the latency
+        // stats cover the hand-over too. Fall back to now if it looks wrong.
+        int64_t rendered_ns = source.timestamp_ns.load(std::memory_order_relaxed);
+        info.timestamp_ns = (rendered_ns > 0 && rendered_ns <= m_last_frame_ns) ? rendered_ns : m_last_frame_ns;
+    }
+
+    std::string m_name;
+    std::shared_ptr<ShmRing> m_ring;
+    uint64_t m_ring_id = 0;                     // RingId() of the ring m_ring was attached as
+    uint64_t m_last_producer_sequence = 0;      // producer sequence of the last frame handed out
+    uint64_t m_last_producer_generation = 0;
+    int64_t m_last_frame_ns = 0;
+    uint64_t m_sequence = 0;
+    uint64_t m_generation = 0;
+};
+
+} // namespace
+
+std::unique_ptr<FrameSource> CreateShmFrameSource(const FrameSourceConfig& config) {
+    return std::unique_ptr<FrameSource>(new ShmFrameSource(config));
+}
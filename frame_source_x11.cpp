@@ -0,0 +1,353 @@
+// X11 MIT-SHM screen grabber. The server writes the root window straight into
+// a shared-memory XImage, so a grab costs one server-side blit plus our copy
+// into the caller's buffer. X11 reports no damage here, so changed tiles are
+// found by hashing the image and only those are copied. Region grabs (tracker
+// ROI mode) use a second, window-sized shared image so only the window is read.
+//
+// Window-targeted capture (FrameSourceConfig::window_title / window_class) grabs
+// only the target window: from its XComposite named pixmap when the extension is
+// available (window contents even while covered), otherwise by cropping the root
+// window at the position XGetWindowAttributes/XTranslateCoordinates report.
+// Geometry is re-read every grab, so moves and resizes are followed.
+
+#include "frame_source.h"
+
+#ifdef SIM_HAVE_X11
+
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/extensions/XShm.h>
+#ifdef SIM_HAVE_XCOMPOSITE
+#include <X11/extensions/Xcomposite.h>
+#endif
+#include <sys/ipc.h>
+#include <sys/shm.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+namespace {
+
+// A target window can disappear between any two requests; Xlib's default error
+// handler would exit the process on the resulting BadWindow/BadDrawable.
+int g_x11_error_code = 0;
+
+int RecordX11Error(Display*, XErrorEvent* event) {
+    g_x11_error_code = event->error_code;
+    return 0;
+}
+
+const int64_t WINDOW_LOOKUP_INTERVAL_NS = 1000000000; // retry finding a closed target window once a second
+const int WINDOW_SEARCH_DEPTH = 3;                    // root -> WM frame -> client (-> nested client)
+
+class X11FrameSource : public FrameSource {
+public:
+    explicit X11FrameSource(const FrameSourceConfig& config) : m_config(config) {}
+    ~X11FrameSource() override { Close(); }
+
+    bool Open() override {
+        m_display = XOpenDisplay(m_config.x11_display.empty() ? nullptr : m_config.x11_display.c_str());
+        if (!m_display) { std::cerr << "X11FrameSource: XOpenDisplay failed." << std::endl; return false; }
+        if (!XShmQueryExtension(m_display)) { std::cerr << "X11FrameSource: MIT-SHM extension not available." << std::endl; Close(); return false; }
+
+        int screen = DefaultScreen(m_display);
+        m_root = RootWindow(m_display, screen);
+        m_screen_rect = cv::Rect(0, 0, DisplayWidth(m_display, screen), DisplayHeight(m_display, screen));
+        m_capture_rect = m_screen_rect;
+        m_visual = DefaultVisual(m_display, screen);
+        m_depth = DefaultDepth(m_display, screen);
+
+        if (TargetsWindow()) {
+            XSetErrorHandler(RecordX11Error);
+#ifdef SIM_HAVE_XCOMPOSITE
+            int event_base = 0, error_base = 0;
+            m_use_composite = XCompositeQueryExtension(m_display, &event_base, &error_base);
+#endif
+            m_window = FindTargetWindow(m_root, 0);
+            if (!m_window) {
+                std::cerr << "X11FrameSource: no viewable window matches title '" << m_config.window_title
+                          << "' / class '" << m_config.window_class << "'." << std::endl;
+                Close(); return false;
+            }
+            if (!UpdateCaptureGeometry()) { std::cerr << "X11FrameSource: target window has no capturable area." << std::endl; Close(); return false; }
+        } else if (!CreateShmImage(m_capture_rect.width, m_capture_rect.height, m_full)) {
+            Close(); return false;
+        }
+
+        m_frame_period_ns = (m_config.x11_max_fps > 0.0) ? static_cast<int64_t>(1e9 / m_config.x11_max_fps) : 0;
+        m_next_frame_ns = MonotonicNowNs();
+        m_tiles.Reset(m_capture_rect.size());
+        std::cout << "X11 MIT-SHM frame source opened (" << m_capture_rect.width << "x" << m_capture_rect.height << ")";
+        if (TargetsWindow()) std::cout << ", window 0x" << std::hex << m_window << std::dec << (m_use_composite ? " via XComposite" : " cropped from the root window");
+        std::cout << std::endl;
+        return true;
+    }
+
+    void Close() override {
+        DestroyShmImage(m_region);
+        DestroyShmImage(m_full);
+        ReleaseWindowPixmap();
+        if (m_display) { XCloseDisplay(m_display); m_display = nullptr; }
+        m_window = 0;
+    }
+
+    bool Grab(cv::Mat& destination, FrameInfo& info, int timeout_ms, uint64_t destination_sequence) override {
+        if (!m_display) return false;
+        if (!WaitForNextGrab(timeout_ms)) return false;
+        if (!UpdateCaptureGeometry() || !m_full.image) return false;
+
+        cv::Point offset;
+        Drawable source = CaptureDrawable(offset);
+        if (!XShmGetImage(m_display, source, m_full.image, offset.x, offset.y, AllPlanes)) return false;
+        int64_t acquire_time_ns = MonotonicNowNs();
+
+        // 32bpp TrueColor on little-endian is B,G,R,X in memory - the same layout as DXGI BGRA.
+        const uint8_t* pixels = reinterpret_cast<const uint8_t*>(m_full.image->data);
+        size_t pitch = static_cast<size_t>(m_full.image->bytes_per_line);
+        m_tiles.BeginFrame(m_sequence + 1);
+        m_tiles.MarkChangedByHash(pixels, pitch);
+        info.bytes_copied = m_tiles.CopyChanged(pixels, pitch, destination, destination_sequence);
+        info.tiles = m_tiles.Map();
+        FinishFrame(info, acquire_time_ns);
+        return true;
+    }
+
+    bool GrabRegion(cv::Mat& destination, const cv::Rect& region, FrameInfo& info, int timeout_ms) override {
+        if (!m_display) return false;
+        if (!WaitForNextGrab(timeout_ms)) return false;
+        if (!UpdateCaptureGeometry()) return false;
+        cv::Rect clipped = region & cv::Rect(cv::Point(), m_capture_rect.size());
+        if (clipped.area() == 0) return false;
+        // The window size only changes when the tracked box does, so this is rarely re-created.
+        if (!m_region.image || m_region.image->width != clipped.width || m_region.image->height != clipped.height
+            || m_region.image->depth != m_depth) {
+            DestroyShmImage(m_region);
+            if (!CreateShmImage(clipped.width, clipped.height, m_region)) return false;
+        }
+
+        cv::Point offset;
+        Drawable source = CaptureDrawable(offset);
+        if (!XShmGetImage(m_display, source, m_region.image, offset.x + clipped.x, offset.y + clipped.y, AllPlanes)) return false;
+        int64_t acquire_time_ns = MonotonicNowNs();
+
+        // The full image and its tile hashes are untouched; the next Grab() diffs against them.
+        if (destination.rows != clipped.height || destination.cols != clipped.width || destination.type() != CV_8UC4) {
+            destination.create(clipped.height, clipped.width, CV_8UC4);
+        }
+        CopyPitchedRows(reinterpret_cast<const uint8_t*>(m_region.image->data), static_cast<size_t>(m_region.image->bytes_per_line),
+                        destination, static_cast<size_t>(clipped.width) * 4, clipped.height);
+        info.bytes_copied = static_cast<size_t>(clipped.area()) * 4;
+        info.tiles = FrameTileMap();
+        FinishFrame(info, acquire_time_ns);
+        return true;
+    }
+
+    cv::Size FrameSize() const override { return m_capture_rect.size(); }
+    const char* Name() const override { return "x11"; }
+
+private:
+    struct ShmImage {
+        XImage* image = nullptr;
+        XShmSegmentInfo shm_info = {};
+        bool attached = false;
+    };
+
+    // Image in the capture source's visual (the target window's own, for composite pixmaps).
+    bool CreateShmImage(int width, int height, ShmImage& out) {
+        out.image = XShmCreateImage(m_display, m_visual, static_cast<unsigned int>(m_depth), ZPixmap, nullptr, &out.shm_info, width, height);
+        if (!out.image) { std::cerr << "X11FrameSource: XShmCreateImage failed." << std::endl; return false; }
+        if (out.image->bits_per_pixel != 32) {
+            std::cerr << "X11FrameSource: unsupported pixel format (" << out.image->bits_per_pixel << " bpp), need 32." << std::endl;
+            DestroyShmImage(out); return false;
+        }
+
+        out.shm_info.shmid = shmget(IPC_PRIVATE, static_cast<size_t>(out.image->bytes_per_line) * out.image->height, IPC_CREAT | 0600);
+        if (out.shm_info.shmid < 0) { std::cerr << "X11FrameSource: shmget failed." << std::endl; DestroyShmImage(out); return false; }
+        out.shm_info.shmaddr = out.image->data = static_cast<char*>(shmat(out.shm_info.shmid, nullptr, 0));
+        if (out.shm_info.shmaddr == reinterpret_cast<char*>(-1)) {
+            std::cerr << "X11FrameSource: shmat failed." << std::endl;
+            out.shm_info.shmaddr = out.image->data = nullptr;
+            DestroyShmImage(out); return false;
+        }
+        out.shm_info.readOnly = False;
+        if (!XShmAttach(m_display, &out.shm_info)) { std::cerr << "X11FrameSource: XShmAttach failed." << std::endl; DestroyShmImage(out); return false; }
+        out.attached = true;
+        XSync(m_display, False);
+        shmctl(out.shm_info.shmid, IPC_RMID, nullptr); // segment goes away once both sides detach
+        return true;
+    }
+
+    void DestroyShmImage(ShmImage& shm) {
+        if (m_display && shm.attached) { XShmDetach(m_display, &shm.shm_info); shm.attached = false; }
+        if (shm.image) {
+            shm.image->data = nullptr; // shared segment is not malloc'ed; keep XDestroyImage from freeing it
+            XDestroyImage(shm.image);
+            shm.image = nullptr;
+        }
+        if (shm.shm_info.shmaddr) { shmdt(shm.shm_info.shmaddr); shm.shm_info.shmaddr = nullptr; }
+    }
+
+    bool TargetsWindow() const { return !m_config.window_title.empty() || !m_config.window_class.empty(); }
+
+    bool WindowMatches(Window window) {
+        if (!m_config.window_class.empty()) {
+            XClassHint hint = {};
+            if (!XGetClassHint(m_display, window, &hint)) return false;
+            bool match = (hint.res_class && m_config.window_class == hint.res_class) || (hint.res_name && m_config.window_class == hint.res_name);
+            if (hint.res_name) XFree(hint.res_name);
+            if (hint.res_class) XFree(hint.res_class);
+            if (!match) return false;
+        }
+        if (!m_config.window_title.empty()) {
+            char* name = nullptr;
+            if (!XFetchName(m_display, window, &name) || !name) return false;
+            bool match = strstr(name, m_config.window_title.c_str()) != nullptr;
+            XFree(name);
+            if (!match) return false;
+        }
+        return true;
+    }
+
+    // Depth-first over viewable windows: top-level clients sit below the window
+    // manager's frame windows, so a few levels are searched.
+    Window FindTargetWindow(Window parent, int depth) {
+        Window root_return = 0, parent_return = 0;
+        Window* children = nullptr;
+        unsigned int child_count = 0;
+        if (!XQueryTree(m_display, parent, &root_return, &parent_return, &children, &child_count)) return 0;
+        Window found = 0;
+        for (unsigned int i = child_count; i-- > 0 && !found;) { // topmost first
+            XWindowAttributes attributes;
+            if (!XGetWindowAttributes(m_display, children[i], &attributes) || attributes.map_state != IsViewable) continue;
+            if (WindowMatches(children[i])) found = children[i];
+            else if (depth + 1 < WINDOW_SEARCH_DEPTH) found = FindTargetWindow(children[i], depth + 1);
+        }
+        if (children) XFree(children);
+        return found;
+    }
+
+    // Re-reads the target window's size and position; a closed window is looked up again
+    // once a second. Re-creates the full-frame image (and names a new composite pixmap)
+    // when the size changes. Returns false while there is nothing to capture.
+    bool UpdateCaptureGeometry() {
+        if (!TargetsWindow()) return true;
+        if (!m_window) {
+            int64_t now_ns = MonotonicNowNs();
+            if (now_ns < m_next_window_lookup_ns) return false;
+            m_next_window_lookup_ns = now_ns + WINDOW_LOOKUP_INTERVAL_NS;
+            m_window = FindTargetWindow(m_root, 0);
+            if (!m_window) return false;
+        }
+
+        g_x11_error_code = 0;
+        XWindowAttributes attributes;
+        Window child = 0;
+        int root_x = 0, root_y = 0;
+        bool alive = XGetWindowAttributes(m_display, m_window, &attributes)
+                  && XTranslateCoordinates(m_display, m_window, m_root, 0, 0, &root_x, &root_y, &child) && g_x11_error_code == 0;
+        if (!alive) {
+            std::cout << "X11FrameSource: capture window closed, waiting for it to reappear." << std::endl;
+            ReleaseWindowPixmap();
+            m_window = 0;
+            return false;
+        }
+        if (attributes.map_state != IsViewable) { ReleaseWindowPixmap(); return false; } // minimised / on another desktop
+
+        cv::Rect rect = m_use_composite ? cv::Rect(root_x, root_y, attributes.width, attributes.height)
+                                        : cv::Rect(root_x, root_y, attributes.width, attributes.height) & m_screen_rect;
+        if (rect.area() == 0) return false;
+        Visual* visual = m_use_composite ? attributes.visual : m_visual;
+        int depth = m_use_composite ? attributes.depth : m_depth;
+        bool resized = rect.size() != m_capture_rect.size() || depth != m_depth || !m_full.image;
+        m_capture_rect = rect;
+        if (resized) {
+            m_visual = visual;
+            m_depth = depth;
+            DestroyShmImage(m_full);
+            if (!CreateShmImage(rect.width, rect.height, m_full)) return false;
+            m_tiles.Reset(rect.size());
+            ReleaseWindowPixmap(); // a composite pixmap keeps its old size after a resize
+        }
+#ifdef SIM_HAVE_XCOMPOSITE
+        if (m_use_composite && !m_window_pixmap) {
+            XCompositeRedirectWindow(m_display, m_window, CompositeRedirectAutomatic);
+            m_window_pixmap = XCompositeNameWindowPixmap(m_display, m_window);
+            m_redirected = true;
+        }
+#endif
+        return true;
+    }
+
+    // What XShmGetImage reads for capture pixel (0, 0): the window's own pixmap, or the root at the window's position.
+    Drawable CaptureDrawable(cv::Point& offset) const {
+        if (m_window_pixmap) { offset = cv::Point(); return m_window_pixmap; }
+        offset = m_capture_rect.tl();
+        return m_root;
+    }
+
+    void ReleaseWindowPixmap() {
+#ifdef SIM_HAVE_XCOMPOSITE
+        if (m_display && m_window_pixmap) XFreePixmap(m_display, m_window_pixmap);
+        if (m_display && m_redirected && m_window) XCompositeUnredirectWindow(m_display, m_window, CompositeRedirectAutomatic);
+#endif
+        m_window_pixmap = 0;
+        m_redirected = false;
+    }
+
+    // X11 has no "new frame" notification; cap the grab rate instead.
+    bool WaitForNextGrab(int timeout_ms) {
+        int64_t now_ns = MonotonicNowNs();
+        if (m_frame_period_ns > 0 && m_next_frame_ns > now_ns) {
+            int64_t wait_ns = m_next_frame_ns - now_ns;
+            if (wait_ns > static_cast<int64_t>(timeout_ms) * 1000000) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(timeout_ms));
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::nanoseconds(wait_ns));
+        }
+        return true;
+    }
+
+    void FinishFrame(FrameInfo& info, int64_t acquire_time_ns) {
+        info.sequence = ++m_sequence;
+        info.generation = info.tiles.Valid() ? m_tiles.Generation() : info.sequence; // region grabs are always new
+        info.timestamp_ns = acquire_time_ns;
+        m_next_frame_ns = std::max(m_next_frame_ns + m_frame_period_ns, acquire_time_ns);
+    }
+
+    FrameSourceConfig m_config;
+    Display* m_display = nullptr;
+    Window m_root = 0;
+    ShmImage m_full;                // whole capture rect (root window, or the target window)
+    ShmImage m_region;              // GrabRegion() window, sized on demand
+    TileChangeTracker m_tiles;
+    cv::Rect m_screen_rect;
+    cv::Rect m_capture_rect;        // root coordinates of the captured area
+    Visual* m_visual = nullptr;     // visual/depth of the captured drawable
+    int m_depth = 0;
+    Window m_window = 0;            // window-targeted capture
+    int64_t m_next_window_lookup_ns = 0;
+    bool m_use_composite = false;
+    Pixmap m_window_pixmap = 0;     // XComposite named pixmap of m_window
+    bool m_redirected = false;
+    int64_t m_frame_period_ns = 0;
+    int64_t m_next_frame_ns = 0;
+    uint64_t m_sequence = 0;
+};
+
+} // namespace
+
+std::unique_ptr<FrameSource> CreateX11FrameSource(const FrameSourceConfig& config) {
+    return std::unique_ptr<FrameSource>(new X11FrameSource(config));
+}
+
+#else
+
+std::unique_ptr<FrameSource> CreateX11FrameSource(const FrameSourceConfig&) {
+    return nullptr;
+}
+
+#endif // SIM_HAVE_X11
@@ -0,0 +1,146 @@
+#include "frame_tiles.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "frame_source.h"
+
+bool FrameTileMap::RectChangedSince(const cv::Rect& pixel_rect, uint64_t sequence) const {
+    if (!Valid() || sequence == 0) return true;
+    if (pixel_rect.width <= 0 || pixel_rect.height <= 0) return false;
+    int tile_x0 = std::max(0, pixel_rect.x / FRAME_TILE_SIZE);
+    int tile_y0 = std::max(0, pixel_rect.y / FRAME_TILE_SIZE);
+    int tile_x1 = std::min(tiles_x - 1, (pixel_rect.x + pixel_rect.width - 1) / FRAME_TILE_SIZE);
+    int tile_y1 = std::min(tiles_y - 1, (pixel_rect.y + pixel_rect.height - 1) / FRAME_TILE_SIZE);
+    for (int ty = tile_y0; ty <= tile_y1; ++ty) {
+        for (int tx = tile_x0; tx <= tile_x1; ++tx) {
+            if (TileChangedSince(tx, ty, sequence)) return true;
+        }
+    }
+    return false;
+}
+
+int FrameTileMap::CountChangedSince(uint64_t sequence) const {
+    if (!Valid()) return 0;
+    int changed = 0;
+    for (int ty = 0; ty < tiles_y; ++ty) {
+        for (int tx = 0; tx < tiles_x; ++tx) changed += TileChangedSince(tx, ty, sequence) ? 1 : 0;
+    }
+    return changed;
+}
+
+void TileChangeTracker::Reset(cv::Size frame_size) {
+    if (frame_size == m_frame_size && m_map.Valid()) return;
+    m_frame_size = frame_size;
+    int tiles_x = (frame_size.width + FRAME_TILE_SIZE - 1) / FRAME_TILE_SIZE;
+    int tiles_y = (frame_size.height + FRAME_TILE_SIZE - 1) / FRAME_TILE_SIZE;
+    if (tiles_x * tiles_y > FRAME_MAX_TILES || tiles_x <= 0 || tiles_y <= 0) {
+        m_map.tiles_x = m_map.tiles_y = 0; // too large to track: consumers always copy everything
+    } else {
+        m_map.tiles_x = tiles_x;
+        m_map.tiles_y = tiles_y;
+    }
+    m_hashes_valid = false;
+    m_full_change_pending = true;
+}
+
+void TileChangeTracker::BeginFrame(uint64_t sequence) {
+    m_sequence = sequence;
+    if (m_full_change_pending) {
+        MarkAllChanged();
+        m_full_change_pending = false;
+    }
+}
+
+void TileChangeTracker::MarkChanged(const cv::Rect& pixel_rect) {
+    if (!m_map.Valid()) return;
+    cv::Rect clipped = pixel_rect & cv::Rect(0, 0, m_frame_size.width, m_frame_size.height);
+    if (clipped.width <= 0 || clipped.height <= 0) return;
+    int tile_x1 = (clipped.x + clipped.width - 1) / FRAME_TILE_SIZE;
+    int tile_y1 = (clipped.y + clipped.height - 1) / FRAME_TILE_SIZE;
+    for (int ty = clipped.y / FRAME_TILE_SIZE; ty <= tile_y1; ++ty) {
+        for (int tx = clipped.x / FRAME_TILE_SIZE; tx <= tile_x1; ++tx) MarkTile(tx, ty);
+    }
+}
+
+void TileChangeTracker::MarkAllChanged() {
+    int tile_count = m_map.tiles_x * m_map.tiles_y;
+    std::fill(m_map.modified_sequence.begin(), m_map.modified_sequence.begin() + tile_count, static_cast<uint32_t>(m_sequence));
+    m_generation = m_sequence;
+}
+
+void TileChangeTracker::MarkChangedByHash(const uint8_t* source, size_t source_pitch) {
+    if (!m_map.Valid()) return;
+    const uint64_t PRIME = 0x9E3779B97F4A7C15ull;
+    for (int ty = 0; ty < m_map.tiles_y; ++ty) {
+        int y0 = ty * FRAME_TILE_SIZE;
+        int y1 = std::min(y0 + FRAME_TILE_SIZE, m_frame_size.height);
+        for (int tx = 0; tx < m_map.tiles_x; ++tx) {
+            int x0 = tx * FRAME_TILE_SIZE;
+            size_t tile_bytes = static_cast<size_t>(std::min(FRAME_TILE_SIZE, m_frame_size.width - x0)) * 4;
+            size_t tile_words = tile_bytes / sizeof(uint64_t);
+            size_t tail_bytes = tile_bytes % sizeof(uint64_t);    // odd-width last column: one pixel left over
+            // Four independent multiply-xor lanes so the hash runs at memory speed rather than multiply latency.
+            uint64_t lane[4] = { 1, 2, 3, 4 };
+            for (int y = y0; y < y1; ++y) {
+                const uint8_t* row = source + static_cast<size_t>(y) * source_pitch + static_cast<size_t>(x0) * 4;
+                size_t i = 0;
+                for (; i + 4 <= tile_words; i += 4) {
+                    uint64_t words[4];
+                    memcpy(words, row + i * sizeof(uint64_t), sizeof(words));
+                    for (int l = 0; l < 4; ++l) lane[l] = (lane[l] ^ words[l]) * PRIME;
+                }
+                for (; i < tile_words; ++i) {
+                    uint64_t word;
+                    memcpy(&word, row + i * sizeof(uint64_t), sizeof(word));
+                    lane[0] = (lane[0] ^ word) * PRIME;
+                }
+                if (tail_bytes) {
+                    uint64_t word = 0;
+                    memcpy(&word, row + tile_words * sizeof(uint64_t), tail_bytes);
+                    lane[1] = (lane[1] ^ word) * PRIME;
+                }
+            }
+            uint64_t hash = lane[0] ^ (lane[1] << 1 | lane[1] >> 63) ^ (lane[2] << 2 | lane[2] >> 62) ^ (lane[3] << 3 | lane[3] >> 61);
+            uint64_t& previous = m_tile_hash[ty * m_map.tiles_x + tx];
+            if (!m_hashes_valid || previous != hash) MarkTile(tx, ty);
+            previous = hash;
+        }
+    }
+    m_hashes_valid = true;
+}
+
+size_t TileChangeTracker::CopyChanged(const uint8_t* source, size_t source_pitch, cv::Mat& destination,
+                                      uint64_t destination_sequence) const {
+    const int width = m_frame_size.width;
+    const int height = m_frame_size.height;
+    if (destination.empty() || destination.cols != width || destination.rows != height || destination.type() != CV_8UC4) {
+        destination.create(height, width, CV_8UC4);
+        destination_sequence = 0;
+    }
+    const size_t row_bytes = static_cast<size_t>(width) * 4;
+    if (!m_map.Valid() || destination_sequence == 0) {
+        CopyPitchedRows(source, source_pitch, destination, row_bytes, height);
+        return row_bytes * height;
+    }
+
+    size_t copied = 0;
+    for (int ty = 0; ty < m_map.tiles_y; ++ty) {
+        int y0 = ty * FRAME_TILE_SIZE;
+        int y1 = std::min(y0 + FRAME_TILE_SIZE, height);
+        int tx = 0;
+        while (tx < m_map.tiles_x) {
+            if (!m_map.TileChangedSince(tx, ty, destination_sequence)) { ++tx; continue; }
+            int run_start = tx;
+            while (tx < m_map.tiles_x && m_map.TileChangedSince(tx, ty, destination_sequence)) ++tx;
+            // One memcpy per row for each run of adjacent changed tiles.
+            size_t offset = static_cast<size_t>(run_start) * FRAME_TILE_SIZE * 4;
+            size_t bytes = static_cast<size_t>(std::min(tx * FRAME_TILE_SIZE, width) - run_start * FRAME_TILE_SIZE) * 4;
+            for (int y = y0; y < y1; ++y) {
+                memcpy(destination.ptr(y) + offset, source + static_cast<size_t>(y) * source_pitch + offset, bytes);
+            }
+            copied += bytes * (y1 - y0);
+        }
+    }
+    return copied;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+// Tile-granular change tracking for captured frames. A frame is divided into
+// FRAME_TILE_SIZE x FRAME_TILE_SIZE tiles and every tile remembers the
+// sequence number of the last frame that modified it. A consumer holding a
+// buffer that already contains frame S only has to refresh the tiles modified
+// after S; everything else is still valid. Backends fill the map from whatever
+// they know (DXGI dirty/move rects, a per-tile hash diff, the synthetic
+// generator's own draw rects) and TileChangeTracker::CopyChanged() uses it to
+// copy only changed tiles into the caller's buffer.
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include <opencv2/core.hpp>
+
+const int FRAME_TILE_SIZE = 64;
+const int FRAME_MAX_TILES = 4096;   // 5120x2880 at 64 px; larger frames carry no tile information
+
+struct FrameTileMap {
+    int tiles_x = 0;                // 0 = no tile information: treat every pixel as changed
+    int tiles_y = 0;
+    std::array<uint32_t, FRAME_MAX_TILES> modified_sequence; // low 32 bits of the last modifying frame
+
+    bool Valid() const { return tiles_x > 0 && tiles_y > 0; }
+
+    // True if tile (tile_x, tile_y) was modified after frame 'sequence'. Sequence 0
+    // means "contents unknown", so everything counts as changed.
+    bool TileChangedSince(int tile_x, int tile_y, uint64_t sequence) const {
+        if (!Valid() || sequence == 0) return true;
+        return static_cast<int32_t>(modified_sequence[tile_y * tiles_x + tile_x] - static_cast<uint32_t>(sequence)) > 0;
+    }
+    // Same for any tile overlapping 'pixel_rect' (clipped to the frame).
+    bool RectChangedSince(const cv::Rect& pixel_rect, uint64_t sequence) const;
+    int CountChangedSince(uint64_t sequence) const;
+};
+
+class TileChangeTracker {
+public:
+    // Sets the frame geometry. A new geometry (or the first call) marks every
+    // tile as modified by the next BeginFrame(), so all older buffers get a full copy.
+    void Reset(cv::Size frame_size);
+    cv::Size FrameSize() const { return m_frame_size; }
+
+    // Starts recording changes for frame 'sequence' (call before any Mark*).
+    void BeginFrame(uint64_t sequence);
+    void MarkChanged(const cv::Rect& pixel_rect);
+    void MarkAllChanged();
+    // Hashes every tile of a BGRA source and marks the tiles whose hash differs
+    // from the previous frame's. Costs one read of the frame.
+    void MarkChangedByHash(const uint8_t* source, size_t source_pitch);
+
+    // Copies every tile modified after 'destination_sequence' (all of them if 0
+    // or if 'destination' has a different geometry, which is then re-created).
+    // Returns the number of bytes copied.
+    size_t CopyChanged(const uint8_t* source, size_t source_pitch, cv::Mat& destination, uint64_t destination_sequence) const;
+
+    const FrameTileMap& Map() const { return m_map; }
+
+    // Generation of the current frame: the sequence of the last frame that marked
+    // anything. Two frames with the same generation hold identical pixels. Without
+    // tile information every frame is its own generation.
+    uint64_t Generation() const { return m_map.Valid() ? m_generation : m_sequence; }
+
+private:
+    void MarkTile(int tile_x, int tile_y) {
+        m_map.modified_sequence[tile_y * m_map.tiles_x + tile_x] = static_cast<uint32_t>(m_sequence);
+        m_generation = m_sequence;
+    }
+
+    cv::Size m_frame_size;
+    uint64_t m_sequence = 0;
+    uint64_t m_generation = 0;
+    bool m_full_change_pending = false;
+    bool m_hashes_valid = false;
+    FrameTileMap m_map;
+    std::array<uint64_t, FRAME_MAX_TILES> m_tile_hash;
+};
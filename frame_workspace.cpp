@@ -0,0 +1,25 @@
+#include "frame_workspace.h"
+
+#include <cstdarg>
+#include <cstdio>
+
+void TextBuffer::Format(const char* format, ...) {
+    char buffer[DEFAULT_CAPACITY];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    if (length < 0) length = 0;
+    if (static_cast<size_t>(length) >= sizeof(buffer)) length = static_cast<int>(sizeof(buffer) - 1);
+    m_text.assign(buffer, static_cast<size_t>(length));
+}
+
+void* FrameArena::Allocate(size_t bytes, size_t alignment) {
+    uintptr_t base = reinterpret_cast<uintptr_t>(m_storage.data());
+    uintptr_t aligned = (base + m_used + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1);
+    size_t offset = static_cast<size_t>(aligned - base);
+    if (offset + bytes > m_storage.size()) return nullptr;
+    m_used = offset + bytes;
+    if (m_used > m_high_water) m_high_water = m_used;
+    return m_storage.data() + offset;
+}
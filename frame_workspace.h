@@ -0,0 +1,90 @@
+#pragma once
+
+// Per-thread scratch memory for the steady-state frame loop. Everything a
+// frame needs transiently (colour conversions, blend layers, overlay text,
+// point lists) lives here and is sized on the first frames, so after warm-up
+// the tracking and preview loops reuse memory instead of hitting the heap.
+// One workspace per thread; nothing in here is synchronised.
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "downscale.h"
+
+class WorkerPool;
+
+// Text formatted in place. The string is reserved up front and rewritten with
+// assign(), so formatting never reallocates once the capacity is there (and
+// OpenCV's const String& text APIs take it without building a temporary).
+class TextBuffer {
+public:
+    static const size_t DEFAULT_CAPACITY = 128;
+
+    TextBuffer() { m_text.reserve(DEFAULT_CAPACITY); }
+    TextBuffer(const TextBuffer& other) { m_text.reserve(DEFAULT_CAPACITY); m_text.assign(other.m_text); }
+    TextBuffer& operator=(const TextBuffer& other) { m_text.assign(other.m_text); return *this; }
+
+    // printf-style; output longer than DEFAULT_CAPACITY - 1 is truncated.
+    void Format(const char* format, ...)
+#if defined(__GNUC__)
+        __attribute__((format(printf, 2, 3)))
+#endif
+        ;
+    void Assign(const char* text) { m_text.assign(text); }
+    void Clear() { m_text.clear(); }
+
+    const std::string& Str() const { return m_text; }
+    bool Empty() const { return m_text.empty(); }
+
+private:
+    std::string m_text;
+};
+
+// Bump allocator over a fixed block, reset once per frame. Allocate() returns
+// nullptr when the block is exhausted; callers fall back to drawing less, never
+// to the heap.
+class FrameArena {
+public:
+    explicit FrameArena(size_t capacity_bytes = 64 * 1024) : m_storage(capacity_bytes) {}
+
+    void* Allocate(size_t bytes, size_t alignment = alignof(std::max_align_t));
+    template<typename T>
+    T* AllocateArray(size_t count) { return static_cast<T*>(Allocate(sizeof(T) * count, alignof(T))); }
+
+    void Reset() { m_used = 0; }
+    size_t Used() const { return m_used; }
+    size_t HighWater() const { return m_high_water; }
+    size_t Capacity() const { return m_storage.size(); }
+
+private:
+    std::vector<uint8_t> m_storage;
+    size_t m_used = 0;
+    size_t m_high_water = 0;
+};
+
+struct FrameWorkspace {
+    // Tracking thread
+    cv::Mat tracker_input;          // frame in the tracker's format, BGR or luma (fused downscale, or the BGRA display frame converted)
+    FusedDownscaler downscaler;     // capture -> tracker_input when no display frame is needed
+    WorkerPool* downscale_pool = nullptr;   // --downscale-threads: whole-frame downscales split over it (not owned)
+    cv::Mat resize_scratch;         // display-sized; changed blocks are resized into ROIs of it
+    cv::Mat native_canvas;          // --capture-roi: monitor-sized BGR or luma image the native tracker runs on
+
+    // Preview thread
+    cv::Mat blend_layer;            // frame-sized fill colour for translucent text backgrounds (used through ROIs)
+    cv::Mat patch_resized;          // track patch scaled into the overlay slot
+    cv::Mat patch_converted;        // track patch converted to the canvas channel count
+    cv::Mat waiting_image;          // "Waiting for desktop frame..." placeholder, rendered once
+    TextBuffer fps_text;
+    TextBuffer channels_text;
+    TextBuffer offset_text;
+    TextBuffer acquisition_text;
+    TextBuffer pose_text;
+    TextBuffer pid_title_text;
+
+    FrameArena arena;               // per-frame scratch, Reset() at the top of each frame
+};
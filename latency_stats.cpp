@@ -0,0 +1,132 @@
+#include "latency_stats.h"
+
+#include <cstdio>
+
+LatencyStats g_latency_stats;
+
+const char* LatencyStageName(LatencyStage stage) {
+    switch (stage) {
+        case LatencyStage::Copy:         return "copy";
+        case LatencyStage::CaptureQueue: return "cap->track";
+        case LatencyStage::Resize:       return "resize";
+        case LatencyStage::Track:        return "track";
+        case LatencyStage::ControlQueue: return "track->ctl";
+        case LatencyStage::Pid:          return "pid";
+        case LatencyStage::Submit:       return "submit";
+        case LatencyStage::EndToEnd:     return "end-to-end";
+        case LatencyStage::Count:        break;
+    }
+    return "unknown";
+}
+
+const char* SkipStageName(SkipStage stage) {
+    switch (stage) {
+        case SkipStage::Track:   return "track";
+        case SkipStage::Preview: return "preview";
+        case SkipStage::Submit:  return "submit";
+        case SkipStage::Count:   break;
+    }
+    return "unknown";
+}
+
+int LatencyHistogram::BucketIndex(uint64_t value) {
+    // Values below 2 * SUB_BUCKET_COUNT get one bucket each; above that every
+    // power of two is split into SUB_BUCKET_COUNT equal buckets.
+    int msb = 63;
+    while (msb > 0 && !(value >> msb)) --msb;
+    int shift = msb - SUB_BUCKET_BITS;
+    if (shift < 0) shift = 0;
+    int index = shift * SUB_BUCKET_COUNT + static_cast<int>(value >> shift);
+    return index < BUCKET_COUNT ? index : BUCKET_COUNT - 1;
+}
+
+int64_t LatencyHistogram::BucketUpperBound(int index) {
+    if (index < 2 * SUB_BUCKET_COUNT) return index;
+    int shift = index / SUB_BUCKET_COUNT - 1;
+    int64_t mantissa = index - shift * SUB_BUCKET_COUNT;
+    return ((mantissa + 1) << shift) - 1;
+}
+
+void LatencyHistogram::Record(int64_t value_ns) {
+    if (value_ns < 0) value_ns = 0; // clock reads on different cores; never trust a negative delta
+    m_buckets[BucketIndex(static_cast<uint64_t>(value_ns))].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    int64_t previous_max = m_max.load(std::memory_order_relaxed);
+    while (value_ns > previous_max && !m_max.compare_exchange_weak(previous_max, value_ns, std::memory_order_relaxed)) {}
+}
+
+void LatencyHistogram::Reset() {
+    for (std::atomic<uint64_t>& bucket : m_buckets) bucket.store(0, std::memory_order_relaxed);
+    m_count.store(0, std::memory_order_relaxed);
+    m_max.store(0, std::memory_order_relaxed);
+}
+
+int64_t LatencyHistogram::Percentile(double percentile) const {
+    // Sum the buckets rather than trusting m_count, which a concurrent Record may have bumped already.
+    uint64_t total = 0;
+    for (const std::atomic<uint64_t>& bucket : m_buckets) total += bucket.load(std::memory_order_relaxed);
+    if (total == 0) return 0;
+
+    uint64_t target = static_cast<uint64_t>(percentile / 100.0 * static_cast<double>(total) + 0.5);
+    if (target < 1) target = 1;
+    if (target > total) target = total;
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKET_COUNT; ++i) {
+        seen += m_buckets[i].load(std::memory_order_relaxed);
+        if (seen >= target) {
+            int64_t upper = BucketUpperBound(i);
+            int64_t max_ns = Max();
+            return (max_ns > 0 && upper > max_ns) ? max_ns : upper;
+        }
+    }
+    return Max();
+}
+
+LatencySummary LatencyHistogram::Summary() const {
+    LatencySummary summary;
+    summary.count = Count();
+    summary.p50_ns = Percentile(50.0);
+    summary.p99_ns = Percentile(99.0);
+    summary.max_ns = Max();
+    return summary;
+}
+
+std::string LatencyStats::FormatLine(LatencyStage stage) const {
+    char line[128];
+    FormatLine(stage, line, sizeof(line));
+    return line;
+}
+
+void LatencyStats::FormatLine(LatencyStage stage, char* out, size_t out_size) const {
+    LatencySummary summary = Summary(stage);
+    snprintf(out, out_size, "%-10s p50 %7.2f ms  p99 %7.2f ms  max %7.2f ms  (n=%llu)",
+             LatencyStageName(stage), summary.p50_ns / 1e6, summary.p99_ns / 1e6, summary.max_ns / 1e6,
+             static_cast<unsigned long long>(summary.count));
+}
+
+std::string LatencyStats::FormatSkipLine(SkipStage stage) const {
+    uint64_t total = WorkTotal(stage);
+    uint64_t skipped = WorkSkipped(stage);
+    char line[128];
+    snprintf(line, sizeof(line), "%-10s skipped %8llu / %8llu (%.1f%%)", SkipStageName(stage),
+             static_cast<unsigned long long>(skipped), static_cast<unsigned long long>(total),
+             total > 0 ? 100.0 * static_cast<double>(skipped) / static_cast<double>(total) : 0.0);
+    return line;
+}
+
+void LatencyStats::Dump(std::ostream& out) const {
+    out << "--- Pipeline latency (since start) ---" << std::endl;
+    for (int i = 0; i < static_cast<int>(LatencyStage::Count); ++i) {
+        out << "  " << FormatLine(static_cast<LatencyStage>(i)) << std::endl;
+    }
+    out << "--- Work skipped on unchanged input ---" << std::endl;
+    for (int i = 0; i < static_cast<int>(SkipStage::Count); ++i) {
+        out << "  " << FormatSkipLine(static_cast<SkipStage>(i)) << std::endl;
+    }
+}
+
+void LatencyStats::Reset() {
+    for (LatencyHistogram& histogram : m_histograms) histogram.Reset();
+    for (std::atomic<uint64_t>& counter : m_work_total) counter.store(0, std::memory_order_relaxed);
+    for (std::atomic<uint64_t>& counter : m_work_skipped) counter.store(0, std::memory_order_relaxed);
+}
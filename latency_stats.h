@@ -0,0 +1,103 @@
+#pragma once
+
+// Per-stage pipeline latency, collected into lock-free HDR-style histograms.
+// Every frame is timestamped with MonotonicNowNs() as it moves through the
+// pipeline; each thread records its own stage durations with a relaxed atomic
+// increment, so recording never blocks and readers (overlay, periodic dump)
+// can snapshot at any time.
+//
+// Buckets are log-linear: 32 linear sub-buckets per power of two, i.e. about
+// 3% relative resolution from 1 ns up to ~17 s. Percentiles report the upper
+// edge of their bucket; the maximum is exact.
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+enum class LatencyStage {
+    Copy,           // capture acquire -> frame copied into our buffer
+    CaptureQueue,   // copy done -> picked up by the tracking thread
+    Resize,         // downscale to DISPLAY_WIDTH
+    Track,          // tracker init/update
+    ControlQueue,   // tracker done -> picked up by the control thread
+    Pid,            // measurement latch + PID, every control tick
+    Submit,         // pad report mapping + ViGEm submit
+    EndToEnd,       // capture acquire -> ViGEm submit done, for ticks that consumed a new measurement
+    Count
+};
+
+const char* LatencyStageName(LatencyStage stage);
+
+// Work short-circuited because its input had not changed since the last run.
+enum class SkipStage {
+    Track,          // resize + tracker step on a frame whose generation was already processed (mouse-only / static updates)
+    Preview,        // overlay redraw with neither a new frame nor new overlay state
+    Submit,         // ViGEm update with the same report as the last one submitted
+    Count
+};
+
+const char* SkipStageName(SkipStage stage);
+
+struct LatencySummary {
+    uint64_t count = 0;
+    int64_t p50_ns = 0;
+    int64_t p99_ns = 0;
+    int64_t max_ns = 0;
+};
+
+class LatencyHistogram {
+public:
+    static const int SUB_BUCKET_BITS = 5;
+    static const int SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS;
+    static const int BUCKET_COUNT = 30 * SUB_BUCKET_COUNT; // up to 2^34 ns (~17 s); larger values land in the last bucket
+
+    LatencyHistogram() { Reset(); }
+
+    void Record(int64_t value_ns);
+    void Reset();
+
+    uint64_t Count() const { return m_count.load(std::memory_order_relaxed); }
+    int64_t Max() const { return m_max.load(std::memory_order_relaxed); }
+    int64_t Percentile(double percentile) const; // 0..100
+    LatencySummary Summary() const;
+
+private:
+    static int BucketIndex(uint64_t value);
+    static int64_t BucketUpperBound(int index);
+
+    std::atomic<uint64_t> m_buckets[BUCKET_COUNT];
+    std::atomic<uint64_t> m_count;
+    std::atomic<int64_t>  m_max;
+};
+
+class LatencyStats {
+public:
+    void Record(LatencyStage stage, int64_t duration_ns) {
+        m_histograms[static_cast<int>(stage)].Record(duration_ns);
+    }
+    LatencySummary Summary(LatencyStage stage) const { return m_histograms[static_cast<int>(stage)].Summary(); }
+
+    // One call per opportunity to do the stage's work; 'skipped' when it was short-circuited.
+    void RecordWork(SkipStage stage, bool skipped) {
+        m_work_total[static_cast<int>(stage)].fetch_add(1, std::memory_order_relaxed);
+        if (skipped) m_work_skipped[static_cast<int>(stage)].fetch_add(1, std::memory_order_relaxed);
+    }
+    uint64_t WorkTotal(SkipStage stage) const { return m_work_total[static_cast<int>(stage)].load(std::memory_order_relaxed); }
+    uint64_t WorkSkipped(SkipStage stage) const { return m_work_skipped[static_cast<int>(stage)].load(std::memory_order_relaxed); }
+
+    // One line per stage: "track      p50   1.23 ms  p99   3.40 ms  max   8.02 ms  (n=1234)"
+    std::string FormatLine(LatencyStage stage) const;
+    void FormatLine(LatencyStage stage, char* out, size_t out_size) const; // no allocation (preview loop)
+    // "track      skipped    120 /    600 (20.0%)"
+    std::string FormatSkipLine(SkipStage stage) const;
+    void Dump(std::ostream& out) const;
+    void Reset();
+
+private:
+    LatencyHistogram m_histograms[static_cast<int>(LatencyStage::Count)];
+    std::atomic<uint64_t> m_work_total[static_cast<int>(SkipStage::Count)] = {};
+    std::atomic<uint64_t> m_work_skipped[static_cast<int>(SkipStage::Count)] = {};
+};
+
+extern LatencyStats g_latency_stats;
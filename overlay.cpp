@@ -0,0 +1,272 @@
+#include "overlay.h"
+
+#include <algorithm>
+
+#include <opencv2/imgproc.hpp>
+
+std::chrono::steady_clock::time_point last_fps_time_point;
+int frame_counter_fps = 0;
+double display_fps = 0.0;
+
+void DrawFrameInfo(cv::Mat& frame_to_draw, const OverlayState& overlay, FrameWorkspace& workspace) {
+    if (frame_to_draw.empty() || frame_to_draw.cols <= 0 || frame_to_draw.rows <= 0) { return; }
+    if (frame_to_draw.channels() == 4) {
+        workspace.blend_layer.create(frame_to_draw.size(), CV_8UC4); // no-op once sized; text backgrounds use ROIs of it
+    }
+
+    // --- Font and Color Definitions ---
+    int font_face = cv::FONT_HERSHEY_SIMPLEX;
+    // double font_scale_info = 0.5; // For FPS, Channels, Pose - Defined inside lambda or as needed
+    // double font_scale_offset = 0.5; // For Tracking Offset - Defined inside lambda or as needed
+    int thickness = 1;
+    cv::Scalar text_color_green(0, 255, 0);
+    cv::Scalar text_color_red(0, 0, 255);
+    cv::Scalar text_bg_color(0, 0, 0, 180); // Semi-transparent black
+    int line_type = cv::LINE_AA;
+    int text_padding = 3;
+
+    // Helper lambda to draw text with background
+    auto drawTextWithBackground = 
+        [&](const std::string& text, cv::Point origin_bottom_left, double scale, const cv::Scalar& color, const cv::Scalar& bgColor) {
+        if (text.empty()) return;
+        int baseline = 0;
+        cv::Size text_size = cv::getTextSize(text, font_face, scale, thickness, &baseline);
+        // baseline is distance from text bottom to baseline.
+        // text_size.height is height of text box above baseline.
+
+        // Define background rectangle based on text_size and origin_bottom_left
+        cv::Rect bg_rect(origin_bottom_left.x - text_padding,
+                         origin_bottom_left.y - text_size.height - baseline - text_padding, // Top of text box
+                         text_size.width + 2 * text_padding,
+                         text_size.height + baseline + 2 * text_padding); // Total height of text box
+
+        // Ensure bg_rect is within frame boundaries
+        bg_rect.x = std::max(0, bg_rect.x);
+        bg_rect.y = std::max(0, bg_rect.y);
+        if (bg_rect.x + bg_rect.width > frame_to_draw.cols) {
+            bg_rect.width = frame_to_draw.cols - bg_rect.x;
+        }
+        if (bg_rect.y + bg_rect.height > frame_to_draw.rows) {
+            bg_rect.height = frame_to_draw.rows - bg_rect.y;
+        }
+        
+        if (bg_rect.width <= 0 || bg_rect.height <= 0) return; // Invalid rect after clamping
+
+        if (frame_to_draw.channels() == 4 && bgColor[3] < 255) {
+            cv::Mat roi = frame_to_draw(bg_rect);
+            if(roi.empty() || roi.cols <=0 || roi.rows <=0) return;
+            cv::Mat color_layer = workspace.blend_layer(cv::Rect(0, 0, roi.cols, roi.rows));
+            color_layer.setTo(bgColor);
+            double alpha = static_cast<double>(bgColor[3]) / 255.0;
+            cv::addWeighted(color_layer, alpha, roi, 1.0 - alpha, 0.0, roi);
+        } else {
+            cv::rectangle(frame_to_draw, bg_rect, cv::Scalar(bgColor[0], bgColor[1], bgColor[2]), cv::FILLED);
+        }
+        cv::putText(frame_to_draw, text, origin_bottom_left, font_face, scale, color, thickness, line_type);
+    };
+
+    double font_scale_info = 0.5; // Common scale for info texts
+
+    // --- FPS Calculation and Display ---
+    frame_counter_fps++;
+    auto current_time = std::chrono::steady_clock::now();
+    double elapsed_seconds = std::chrono::duration_cast<std::chrono::duration<double>>(current_time - last_fps_time_point).count();
+    if (elapsed_seconds >= 1.0) {
+        display_fps = static_cast<double>(frame_counter_fps) / elapsed_seconds;
+        frame_counter_fps = 0; last_fps_time_point = current_time;
+    }
+    workspace.fps_text.Format("FPS: %.1f", display_fps);
+    const std::string& fps_text = workspace.fps_text.Str();
+    cv::Size text_size_fps = cv::getTextSize(fps_text, font_face, font_scale_info, thickness, nullptr);
+    cv::Point fps_origin(frame_to_draw.cols - text_size_fps.width - 10, frame_to_draw.rows - 10);
+    drawTextWithBackground(fps_text, fps_origin, font_scale_info, text_color_green, text_bg_color);
+
+    // --- Per-stage latency (p50/p99/max), stacked upwards above the FPS counter ---
+    double font_scale_latency = 0.35;
+    int latency_line_height = cv::getTextSize("Ag", font_face, font_scale_latency, thickness, nullptr).height + 2 * text_padding + 2;
+    int latency_y = fps_origin.y - text_size_fps.height - 2 * text_padding - 4;
+    for (auto it = overlay.latency_lines.rbegin(); it != overlay.latency_lines.rend(); ++it) {
+        cv::Size text_size_latency = cv::getTextSize(it->Str(), font_face, font_scale_latency, thickness, nullptr);
+        cv::Point latency_origin(frame_to_draw.cols - text_size_latency.width - 10, latency_y);
+        drawTextWithBackground(it->Str(), latency_origin, font_scale_latency, text_color_green, text_bg_color);
+        latency_y -= latency_line_height;
+    }
+
+    // --- Channel Data Display ---
+    workspace.channels_text.Format("CH1:%ld CH2:%ld CH3:%ld CH4:%ld CH8:%ld", overlay.channels.ch1, overlay.channels.ch2,
+                                   overlay.channels.ch3, overlay.channels.ch4, overlay.channels.ch8);
+    const std::string& channels_text = workspace.channels_text.Str();
+    // cv::Size text_size_channels = cv::getTextSize(channels_text, font_face, font_scale_info, thickness, nullptr); // Not strictly needed here if only used for positioning
+    cv::Point channels_origin(10, frame_to_draw.rows - 10);
+    drawTextWithBackground(channels_text, channels_origin, font_scale_info, text_color_green, text_bg_color);
+
+    // --- Overlay track_frame ---
+    if (flag_track == 1 && !overlay.track_patch.empty()) {
+        // ... (您的 track_frame 叠加逻辑，确保它不会与新文本重叠太多) ...
+        // (这段代码与您之前提供的版本相同，我将省略以保持简洁，但您应该保留它)
+        int track_width = overlay.track_patch.cols; int track_height = overlay.track_patch.rows;
+        if (track_width <= frame_to_draw.cols && track_height <= frame_to_draw.rows) {
+            cv::Rect roi_top_right(frame_to_draw.cols - track_width - 5, 5, track_width, track_height);
+            if (roi_top_right.x < 0) roi_top_right.x = 0; if (roi_top_right.y < 0) roi_top_right.y = 0;
+            if (roi_top_right.x + roi_top_right.width > frame_to_draw.cols) roi_top_right.width = frame_to_draw.cols - roi_top_right.x;
+            if (roi_top_right.y + roi_top_right.height > frame_to_draw.rows) roi_top_right.height = frame_to_draw.rows - roi_top_right.y;
+
+            if (roi_top_right.width > 0 && roi_top_right.height > 0) {
+                cv::Mat destination_roi = frame_to_draw(roi_top_right);
+                cv::Mat track_frame_to_copy;
+                if (overlay.track_patch.cols != roi_top_right.width || overlay.track_patch.rows != roi_top_right.height) {
+                    cv::resize(overlay.track_patch, workspace.patch_resized, cv::Size(roi_top_right.width, roi_top_right.height));
+                    track_frame_to_copy = workspace.patch_resized;
+                } else { track_frame_to_copy = overlay.track_patch; }
+                
+                if (track_frame_to_copy.type() == destination_roi.type()) { track_frame_to_copy.copyTo(destination_roi); }
+                else if (track_frame_to_copy.type() == CV_8UC4 && destination_roi.type() == CV_8UC3) { cv::cvtColor(track_frame_to_copy, workspace.patch_converted, cv::COLOR_BGRA2BGR); workspace.patch_converted.copyTo(destination_roi); }
+                else if (track_frame_to_copy.type() == CV_8UC3 && destination_roi.type() == CV_8UC4) { cv::cvtColor(track_frame_to_copy, workspace.patch_converted, cv::COLOR_BGR2BGRA); workspace.patch_converted.copyTo(destination_roi); }
+                else if (track_frame_to_copy.type() == CV_8UC1 && destination_roi.type() == CV_8UC4) { cv::cvtColor(track_frame_to_copy, workspace.patch_converted, cv::COLOR_GRAY2BGRA); workspace.patch_converted.copyTo(destination_roi); } // 亮度跟踪的模板
+                else if (track_frame_to_copy.type() == CV_8UC1 && destination_roi.type() == CV_8UC3) { cv::cvtColor(track_frame_to_copy, workspace.patch_converted, cv::COLOR_GRAY2BGR); workspace.patch_converted.copyTo(destination_roi); }
+                else { /* std::cerr << "Warning: track_frame type mismatch." << std::endl; */ }
+                cv::rectangle(frame_to_draw, roi_top_right, cv::Scalar(255, 0, 0), 1); 
+            }
+        } else { /* std::cerr << "Warning: track_frame too large." << std::endl; */ }
+    }
+
+    // --- Tracker bounding box / failure status (moved here from the tracking thread) ---
+    if (overlay.tracker_active) {
+        if (overlay.offset.is_valid) {
+            cv::rectangle(frame_to_draw, overlay.tracked_bbox, cv::Scalar(0, 0, 255), 2, 1);
+        } else {
+            static const std::string tracking_failure_text("Tracking Failure"); // 避免每帧构造临时 std::string
+            static const std::string recovering_text("Tracking Failure - searching");
+            cv::putText(frame_to_draw, overlay.recovering ? recovering_text : tracking_failure_text, cv::Point(100, 80),
+                        cv::FONT_HERSHEY_SIMPLEX, 0.75, cv::Scalar(0, 0, 255), 2);
+        }
+    }
+
+    // --- Seed box chosen by target acquisition, for a moment after the tracker starts ---
+    if (overlay.tracker_active && !overlay.acquired_bbox.empty()) {
+        cv::rectangle(frame_to_draw, overlay.acquired_bbox, cv::Scalar(0, 255, 255), 1);
+        if (overlay.acquisition_score > 0.0f) workspace.acquisition_text.Format("Acquired %dx%d score %.2f", overlay.acquired_bbox.width, overlay.acquired_bbox.height, overlay.acquisition_score);
+        else workspace.acquisition_text.Format("Acquired %dx%d (centre)", overlay.acquired_bbox.width, overlay.acquired_bbox.height);
+        cv::Point acquisition_origin(overlay.acquired_bbox.x, std::max(12, overlay.acquired_bbox.y - 4));
+        cv::putText(frame_to_draw, workspace.acquisition_text.Str(), acquisition_origin, cv::FONT_HERSHEY_SIMPLEX, 0.4, cv::Scalar(0, 255, 255), 1);
+    }
+
+    // --- Draw a red crosshair in the center ---
+    int crosshair_size = 40; int line_length = crosshair_size / 2; int crosshair_thickness = 1; 
+    cv::Point center_point(frame_to_draw.cols / 2, frame_to_draw.rows / 2);
+    cv::line(frame_to_draw, cv::Point(center_point.x - line_length, center_point.y), cv::Point(center_point.x + line_length, center_point.y), text_color_red, crosshair_thickness, line_type);
+    cv::line(frame_to_draw, cv::Point(center_point.x, center_point.y - line_length), cv::Point(center_point.x, center_point.y + line_length), text_color_red, crosshair_thickness, line_type);
+    
+    // --- Display Tracking Offset at the top ---
+    double font_scale_offset = 0.5; // Scale for offset text
+    if (overlay.offset.is_valid) { 
+        workspace.offset_text.Format("Offset DX: %.1f DY: %.1f", overlay.offset.dx, overlay.offset.dy);
+        cv::Point offset_origin(10, 20 + text_padding); // Adjusted y for putText anchor
+        drawTextWithBackground(workspace.offset_text.Str(), offset_origin, font_scale_offset, text_color_red, text_bg_color);
+    }
+    
+    // --- Display PID Curves ---
+    if (flag_track == 1) { 
+        DrawPIDCurves(frame_to_draw, overlay, workspace); 
+    }
+
+    // --- Display Drone Pose Data ---
+    static const float RAD_TO_DEG_INFO = 180.0f / static_cast<float>(M_PI); 
+    workspace.pose_text.Format("Pose P: %.1f R: %.1f Y: %.1f", overlay.pose.pitch * RAD_TO_DEG_INFO,
+                               overlay.pose.roll * RAD_TO_DEG_INFO, overlay.pose.yaw * RAD_TO_DEG_INFO);
+    const std::string& pose_text = workspace.pose_text.Str();
+
+    int baseline_pose = 0;
+    cv::Size text_size_pose = cv::getTextSize(pose_text, font_face, font_scale_info, thickness, &baseline_pose);
+    
+    int estimated_line_height_pose = text_size_pose.height + baseline_pose; 
+    cv::Point pose_origin(10, frame_to_draw.rows - estimated_line_height_pose - 10 + baseline_pose); // Adjusted for putText anchor
+
+    // Simple check to prevent overlap with channel data (which is at frame_to_draw.rows - 10)
+    cv::Size text_size_channels_check = cv::getTextSize(channels_text, font_face, font_scale_info, thickness, nullptr);
+    int channels_text_top_y = frame_to_draw.rows - 10 - text_size_channels_check.height;
+
+    if (pose_origin.y - text_size_pose.height < channels_text_top_y + 5 && // Check if top of pose_text overlaps bottom of channels_text
+        pose_origin.x < channels_origin.x + text_size_channels_check.width) { // And if they are horizontally aligned
+         pose_origin.y = channels_text_top_y - 5; // Place it above channel data
+    }
+    if (pose_origin.y - text_size_pose.height < 10) pose_origin.y = 10 + text_size_pose.height; // Ensure it's not off the top
+
+    drawTextWithBackground(pose_text, pose_origin, font_scale_info, text_color_green, text_bg_color);
+}
+
+// 把一条 PID 历史曲线画进 plot_origin 处的绘图区域；点列表来自每帧重置的 arena
+static void DrawHistoryCurve(cv::Mat& frame_to_draw_on, const PlotHistory& history, cv::Point plot_origin,
+                             const cv::Scalar& color, FrameArena& arena) {
+    cv::Point* points = arena.AllocateArray<cv::Point>(history.size());
+    if (!points) return; // arena exhausted: skip the curve rather than allocate
+    for (size_t i = 0; i < history.size(); ++i) {
+        double normalized_val = static_cast<double>(history[i] - PID_OUTPUT_MIN) / (PID_OUTPUT_MAX - PID_OUTPUT_MIN);
+        int y_pixel = static_cast<int>((1.0 - normalized_val) * (PLOT_AREA_HEIGHT - 1));
+        points[i] = cv::Point(plot_origin.x + static_cast<int>(i), plot_origin.y + y_pixel);
+    }
+    // cv::line per segment: cv::polylines copies the points into a std::vector internally
+    for (size_t i = 1; i < history.size(); ++i) {
+        cv::line(frame_to_draw_on, points[i - 1], points[i], color, 1, cv::LINE_AA);
+    }
+}
+
+// --- Function to Draw PID Curves ---
+void DrawPIDCurves(cv::Mat& frame_to_draw_on, const OverlayState& overlay, FrameWorkspace& workspace) {
+    if (frame_to_draw_on.empty() || frame_to_draw_on.cols <= (2 * PLOT_MARGIN + PLOT_AREA_WIDTH)) {
+        return;
+    }
+
+    int font_face = cv::FONT_HERSHEY_SIMPLEX;
+    double param_font_scale = 0.35; // 稍小一点的字体用于显示参数
+    int param_thickness = 1;
+    cv::Scalar param_text_color(200, 200, 200); // 浅灰色用于参数
+
+    // --- 准备绘制区域1 (for ch1) ---
+    int plot1_start_x = PLOT_MARGIN;
+    int plot1_start_y = PLOT_MARGIN + 30; 
+    if (plot1_start_y + PLOT_AREA_HEIGHT > frame_to_draw_on.rows - PLOT_MARGIN) {
+        plot1_start_y = frame_to_draw_on.rows - PLOT_MARGIN - PLOT_AREA_HEIGHT;
+    }
+    if (plot1_start_y < PLOT_MARGIN) plot1_start_y = PLOT_MARGIN;
+
+    cv::Rect plot_area1_rect(plot1_start_x, plot1_start_y, PLOT_AREA_WIDTH, PLOT_AREA_HEIGHT);
+    cv::rectangle(frame_to_draw_on, plot_area1_rect, cv::Scalar(50, 50, 50), cv::FILLED); 
+    cv::rectangle(frame_to_draw_on, plot_area1_rect, cv::Scalar(200, 200, 200), 1);    
+    
+    // 显示 CH1 标题和PID参数
+    workspace.pid_title_text.Format("CH1 PID: P=%.3f I=%.3f D=%.3f", pid_kp_dx, pid_ki_dx, pid_kd_dx);
+    cv::putText(frame_to_draw_on, workspace.pid_title_text.Str(), cv::Point(plot1_start_x, plot1_start_y - 5), 
+                font_face, param_font_scale, param_text_color, param_thickness, cv::LINE_AA);
+
+
+    // 绘制ch1历史数据
+    if (!overlay.ch1_history.empty()) {
+        DrawHistoryCurve(frame_to_draw_on, overlay.ch1_history, cv::Point(plot1_start_x, plot1_start_y), cv::Scalar(0, 255, 255), workspace.arena);
+        int zero_line_y1 = plot1_start_y + static_cast<int>((1.0 - (0.0 - PID_OUTPUT_MIN) / (PID_OUTPUT_MAX - PID_OUTPUT_MIN)) * (PLOT_AREA_HEIGHT - 1));
+        cv::line(frame_to_draw_on, cv::Point(plot1_start_x, zero_line_y1), cv::Point(plot1_start_x + PLOT_AREA_WIDTH -1 , zero_line_y1), cv::Scalar(128,128,128), 1);
+    }
+
+    // --- 准备绘制区域2 (for ch3) ---
+    int plot2_start_y = plot1_start_y + PLOT_AREA_HEIGHT + PLOT_MARGIN; 
+    if (plot2_start_y + PLOT_AREA_HEIGHT > frame_to_draw_on.rows - PLOT_MARGIN) {
+        return; 
+    }
+    if (plot2_start_y < PLOT_MARGIN) plot2_start_y = PLOT_MARGIN;
+
+    cv::Rect plot_area2_rect(plot1_start_x, plot2_start_y, PLOT_AREA_WIDTH, PLOT_AREA_HEIGHT);
+    cv::rectangle(frame_to_draw_on, plot_area2_rect, cv::Scalar(50, 50, 50), cv::FILLED);
+    cv::rectangle(frame_to_draw_on, plot_area2_rect, cv::Scalar(200, 200, 200), 1);
+    
+    // 显示 CH3 标题和PID参数
+    workspace.pid_title_text.Format("CH3 PID: P=%.3f I=%.3f D=%.3f", pid_kp_dy, pid_ki_dy, pid_kd_dy);
+    cv::putText(frame_to_draw_on, workspace.pid_title_text.Str(), cv::Point(plot1_start_x, plot2_start_y - 5), 
+                font_face, param_font_scale, param_text_color, param_thickness, cv::LINE_AA);
+
+    // 绘制ch3历史数据
+    if (!overlay.ch3_history.empty()) {
+        DrawHistoryCurve(frame_to_draw_on, overlay.ch3_history, cv::Point(plot1_start_x, plot2_start_y), cv::Scalar(255, 0, 255), workspace.arena);
+        int zero_line_y2 = plot2_start_y + static_cast<int>((1.0 - (0.0 - PID_OUTPUT_MIN) / (PID_OUTPUT_MAX - PID_OUTPUT_MIN)) * (PLOT_AREA_HEIGHT - 1));
+        cv::line(frame_to_draw_on, cv::Point(plot1_start_x, zero_line_y2), cv::Point(plot1_start_x + PLOT_AREA_WIDTH -1 , zero_line_y2), cv::Scalar(128,128,128), 1);
+    }
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+// Preview overlay rasterisation (FPS, channels, pose, tracker box, track
+// patch, PID curves, latency table). Runs on the preview thread only, on a
+// copy of the tracked frame; portable so SimBenchmarks can time it. Scratch
+// Mats, text and point lists come from the caller's FrameWorkspace, so
+// drawing does not allocate once the workspace is warm.
+
+#include <chrono>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "sim_types.h"
+#include "control.h"
+#include "frame_workspace.h"
+
+// Control-thread state the preview overlay needs; copied under g_overlay_state_mutex.
+struct OverlayState {
+    RemoteChannels channels;
+    DronePose pose;
+    TrackingOffset offset;
+    cv::Mat track_patch;
+    cv::Rect tracked_bbox;
+    bool tracker_active = false;
+    bool recovering = false;                        // target lost, re-detection searching
+    cv::Rect acquired_bbox;                         // box the tracker was seeded with, shortly after a start (empty otherwise)
+    float acquisition_score = 0.0f;                 // its saliency score, 0 for the fixed centre box
+    PlotHistory ch1_history;
+    PlotHistory ch3_history;
+    std::vector<TextBuffer> latency_lines;          // g_latency_stats summary, formatted by the preview thread
+    uint64_t generation = 0;                        // bumped by the control thread whenever the published fields change
+};
+
+// FPS counter state, updated by DrawFrameInfo (preview thread only)
+extern std::chrono::steady_clock::time_point last_fps_time_point;
+extern int frame_counter_fps;
+extern double display_fps;
+
+// 绘图区域参数 (可以根据 display_frame 的大小调整)
+const int PLOT_AREA_HEIGHT = 100; // 每条曲线的绘图区域高度
+const int PLOT_AREA_WIDTH = PLOT_HISTORY_LENGTH; // 绘图区域宽度与历史点数一致
+const int PLOT_MARGIN = 10;       // 绘图区域的边距
+
+// The caller resets workspace.arena once per frame.
+void DrawFrameInfo(cv::Mat& frame_to_draw, const OverlayState& overlay, FrameWorkspace& workspace);
+void DrawPIDCurves(cv::Mat& frame_to_draw_on, const OverlayState& overlay, FrameWorkspace& workspace);
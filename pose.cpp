@@ -0,0 +1,100 @@
+#include "pose.h"
+
+#include <cmath> // For std::atan2, std::asin, std::abs, std::copysign
+#include <cstring>
+
+// 函数定义：将四元数转换为欧拉角 (俯仰绕X, 偏航绕Y, 横滚绕Z)
+// 假设输入四元数是 (qw, qx, qy, qz) 其中 qw 是标量部分
+// 输出欧拉角以弧度为单位
+void QuaternionToEulerAngles_YUp_LeftHanded(
+    float qw, float qx, float qy, float qz,
+    float& pitch_out,  // 输出：俯仰角 (绕X轴 - 机头上下)
+    float& yaw_out,    // 输出：偏航角 (绕Y轴 - 机头左右)
+    float& roll_out)   // 输出：横滚角 (绕Z轴 - 左右倾斜)
+{
+    // 这些公式是基于一个常见的右手坐标系下的ZYX旋转顺序（Yaw, Pitch, Roll）推导出来的
+    // 然后我们根据您的左手Y-Up坐标系 (X-Right, Y-Up, Z-Forward) 来解释和映射这些角度。
+    // Yaw (Psi)   - 对应您的 Yaw (绕Y轴)
+    // Pitch (Theta) - 对应您的 Pitch (绕X轴)
+    // Roll (Phi)  - 对应您的 Roll (绕Z轴)
+
+    // 横滚 (Roll) - 绕物体前进方向Z轴的旋转
+    // 在标准右手ZYX中，这通常是绕新X轴的旋转(phi)，但如果我们将四元数直接分解
+    // 并将qz主要关联到绕Z轴的旋转：
+    double sin_roll = 2.0 * (qw * qz + qx * qy);
+    double cos_roll = 1.0 - 2.0 * (qy * qy + qz * qz);
+    roll_out = static_cast<float>(std::atan2(sin_roll, cos_roll));
+
+    // 俯仰 (Pitch) - 绕物体右方X轴的旋转
+    // 在标准右手ZYX中，这通常是绕新Y轴的旋转(theta)。
+    // 如果我们将qx主要关联到绕X轴的旋转：
+    double sin_pitch = 2.0 * (qw * qx - qy * qz); // 注意这里的符号，有些推导是 (qw*qx + qy*qz) 用于roll, (qw*qy - qx*qz) 用于pitch
+                                                // 这个公式组合 (roll用qz, pitch用qx, yaw用qy) 是一种常见的分解方式
+    // 钳制sin_pitch的值在[-1, 1]之间，以避免asin的定义域错误
+    if (sin_pitch > 1.0) sin_pitch = 1.0;
+    if (sin_pitch < -1.0) sin_pitch = -1.0;
+    pitch_out = static_cast<float>(std::asin(sin_pitch));
+    // 注意：当pitch接近+/-90度时，会出现万向节死锁，此时roll和yaw可能不稳定
+    // 上面的asin处理会在pitch达到+/-90度时饱和，但不会显式处理万向节死锁导致的roll/yaw耦合。
+    // 更复杂的实现会在这里调整roll和yaw的计算。
+    // 对于简单的万向节死锁处理：
+    // if (std::abs(sin_pitch) >= 0.99999) { // 接近 +/- 90 度
+    //     roll_out = 0; // 或者 atan2(-2.0f * qy * qz, 1.0f - 2.0f * (qy*qy + qx*qx)) 等特定公式
+    //     yaw_out = static_cast<float>(std::atan2(-2.0f * qx * qz + 2.0f * qw * qy, 1.0f - 2.0f * (qy*qy + qz*qz))); // 示例
+    //     // 这里的具体公式取决于万向节死锁时的约定
+    // } else {
+    //     // 正常计算 roll 和 yaw (如下)
+    // }
+
+
+    // 偏航 (Yaw) - 绕物体上方Y轴的旋转
+    // 在标准右手ZYX中，这通常是绕原始Z轴的旋转(psi)。
+    // 如果我们将qy主要关联到绕Y轴的旋转：
+    double sin_yaw = 2.0 * (qw * qy + qx * qz);
+    double cos_yaw = 1.0 - 2.0 * (qx * qx + qy * qy);
+    yaw_out = static_cast<float>(std::atan2(sin_yaw, cos_yaw));
+
+
+    // --- 关于左手坐标系和旋转方向的调整 ---
+    // 上述公式是基于标准数学推导，通常对应右手坐标系和特定的旋转正方向。
+    // 对于您的左手Y-Up系统：
+    // +X Right, +Y Up, +Z Forward
+    // 正Pitch: 机头向上 (绕+X轴正向旋转)
+    // 正Yaw:   机头向右 (绕+Y轴正向旋转)
+    // 正Roll:  飞机向右倾斜 (绕+Z轴正向旋转)
+
+    // 您需要通过实验来验证这些计算出的 pitch_out, yaw_out, roll_out 的符号
+    // 是否与您在模拟器中观察到的飞机姿态变化一致。
+    // 例如，如果飞机向上抬头，pitch_out 是否为正？
+    // 如果飞机向右滚转，roll_out 是否为正？
+    // 如果飞机向右偏航，yaw_out 是否为正？
+
+    // 如果某个角度的符号相反，您可以在该角度的最后结果上乘以 -1.0f。
+    // 例如:
+    // pitch_out *= -1.0f; // 如果发现计算出的pitch与期望相反
+
+    // 同样，如果轴的映射不正确（例如，计算出的“roll”实际上是“yaw”），
+    // 则需要调整公式中使用的四元数分量 (qx, qy, qz)。
+    // 我当前选择的公式组合是：
+    // roll_out (绕Z) 主要依赖 qz 和 qw (以及 qx*qy 的耦合项)
+    // pitch_out (绕X) 主要依赖 qx 和 qw (以及 qy*qz 的耦合项)
+    // yaw_out (绕Y) 主要依赖 qy 和 qw (以及 qx*qz 的耦合项)
+    // 这是一种常见的分解方式，但并非唯一。
+}
+
+void ParsePosePacket(const char* packet, DronePose& pose_out) {
+    float timestamp_raw;
+    float qx_raw, qy_raw, qz_raw, qw_raw;
+
+    memcpy(&timestamp_raw, packet, sizeof(float));
+    memcpy(&qx_raw, packet + 4, sizeof(float));
+    memcpy(&qy_raw, packet + 8, sizeof(float));
+    memcpy(&qz_raw, packet + 12, sizeof(float));
+    memcpy(&qw_raw, packet + 16, sizeof(float));
+
+    pose_out.timestamp = timestamp_raw;
+    QuaternionToEulerAngles_YUp_LeftHanded(qw_raw, qx_raw, qy_raw, qz_raw, // Note the order w, x, y, z
+                                           pose_out.pitch, // Output pitch (around X)
+                                           pose_out.yaw,   // Output yaw (around Y)
+                                           pose_out.roll); // Output roll (around Z)
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+// Drone pose from the simulator's UDP telemetry: 20-byte packets of
+// float timestamp, qx, qy, qz, qw (little-endian).
+
+#include "sim_types.h"
+
+const int UDP_BUFFER_SIZE = 20; // 20字节数据长度
+
+// 将四元数转换为欧拉角 (弧度)，左手 Y-Up 坐标系
+void QuaternionToEulerAngles_YUp_LeftHanded(
+    float qw, float qx, float qy, float qz,
+    float& pitch_out, float& yaw_out, float& roll_out);
+
+// Decodes one UDP_BUFFER_SIZE-byte packet into pose_out.
+void ParsePosePacket(const char* packet, DronePose& pose_out);
@@ -0,0 +1,70 @@
+#include "rate_timer.h"
+
+#include <chrono>
+#include <thread>
+
+#include "frame_source.h"
+
+#ifdef _WIN32
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+    #include <timeapi.h>
+    #ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+        #define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+    #endif
+#endif
+
+RateTimer::RateTimer(double rate_hz)
+    : m_period_ns(static_cast<int64_t>(1e9 / (rate_hz > 0.0 ? rate_hz : 1.0))) {
+#ifdef _WIN32
+    // Windows 10 1803+; older systems fall back to a plain timer with a 1 ms scheduler tick.
+    m_waitable_timer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+    if (!m_waitable_timer) {
+        m_waitable_timer = CreateWaitableTimerExW(nullptr, nullptr, 0, TIMER_ALL_ACCESS);
+        m_raised_timer_resolution = (timeBeginPeriod(1) == TIMERR_NOERROR);
+    }
+#endif
+}
+
+RateTimer::~RateTimer() {
+#ifdef _WIN32
+    if (m_waitable_timer) CloseHandle(m_waitable_timer);
+    if (m_raised_timer_resolution) timeEndPeriod(1);
+#endif
+}
+
+void RateTimer::SleepFor(int64_t duration_ns) {
+#ifdef _WIN32
+    if (m_waitable_timer) {
+        LARGE_INTEGER due_time;
+        due_time.QuadPart = -(duration_ns / 100); // relative, in 100 ns units
+        if (SetWaitableTimer(m_waitable_timer, &due_time, 0, nullptr, nullptr, FALSE)) {
+            WaitForSingleObject(m_waitable_timer, INFINITE);
+            return;
+        }
+    }
+#endif
+    std::this_thread::sleep_for(std::chrono::nanoseconds(duration_ns));
+}
+
+int64_t RateTimer::WaitNextTick() {
+    int64_t now_ns = MonotonicNowNs();
+    if (m_next_tick_ns == 0) {
+        m_next_tick_ns = now_ns + m_period_ns; // first call only arms the grid
+    } else if (now_ns - m_next_tick_ns >= m_period_ns) {
+        int64_t missed = (now_ns - m_next_tick_ns) / m_period_ns;
+        m_overruns += static_cast<uint64_t>(missed);
+        m_next_tick_ns += missed * m_period_ns;
+    }
+
+    int64_t remaining_ns = m_next_tick_ns - now_ns;
+    if (remaining_ns > SPIN_WINDOW_NS) {
+        SleepFor(remaining_ns - SPIN_WINDOW_NS);
+    }
+    while ((now_ns = MonotonicNowNs()) < m_next_tick_ns) {
+        std::this_thread::yield();
+    }
+
+    m_next_tick_ns += m_period_ns;
+    return now_ns;
+}
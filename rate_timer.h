@@ -0,0 +1,40 @@
+#pragma once
+
+// Fixed-rate tick source for the control loop. Ticks are scheduled on an
+// absolute grid (start + n * period) so jitter in one tick does not shift the
+// ones after it. Waiting is a coarse OS sleep followed by a short spin for the
+// last SPIN_WINDOW_NS; on Windows the sleep uses a high-resolution waitable
+// timer (or timeBeginPeriod(1) where that is unavailable) because the default
+// ~15.6 ms scheduler tick is far coarser than a 2 ms control period.
+//
+// If the loop falls more than a whole period behind, the missed ticks are
+// skipped and counted as overruns instead of being run back to back.
+
+#include <cstdint>
+
+class RateTimer {
+public:
+    static const int64_t SPIN_WINDOW_NS = 200000;
+
+    explicit RateTimer(double rate_hz);
+    ~RateTimer();
+    RateTimer(const RateTimer&) = delete;
+    RateTimer& operator=(const RateTimer&) = delete;
+
+    // Blocks until the next tick and returns its MonotonicNowNs() time.
+    int64_t WaitNextTick();
+
+    int64_t PeriodNs() const { return m_period_ns; }
+    uint64_t Overruns() const { return m_overruns; }
+
+private:
+    void SleepFor(int64_t duration_ns);
+
+    int64_t m_period_ns;
+    int64_t m_next_tick_ns = 0;
+    uint64_t m_overruns = 0;
+#ifdef _WIN32
+    void* m_waitable_timer = nullptr; // HANDLE
+    bool m_raised_timer_resolution = false;
+#endif
+};
@@ -0,0 +1,124 @@
+#pragma once
+
+// On-disk format of a recorded session (--record). Little-endian, fixed-width,
+// packed so the replay engine can read records straight out of a memory map:
+//
+//   SessionFileHeader
+//   { SessionRecordHeader, payload[payload_size] } ...
+//
+// Records are appended in the order they happened (the recorder stamps them
+// under its lock), so a single forward pass reproduces the session. Frames are
+// stored as the DISPLAY_WIDTH-wide BGR image the tracker ran on (a luma tracker,
+// per the file header, ran on its BT.601 luma); replaying the tracker on exactly
+// those pixels is what makes the run deterministic.
+
+#include <cstdint>
+
+#include "sim_types.h"
+
+const char     SESSION_LOG_MAGIC[8] = { 'S', 'I', 'M', 'R', 'E', 'C', '0', '1' };
+const uint32_t SESSION_LOG_VERSION = 4;   // 2: report records carry the control tick dt; 3: and its time; 4: float offsets
+
+enum SessionRecordType : uint32_t {
+    SESSION_RECORD_CHANNELS = 1,    // SessionChannelsRecord: one PollPhysicalJoystick() result
+    SESSION_RECORD_POSE     = 2,    // raw UDP_BUFFER_SIZE-byte pose packet
+    SESSION_RECORD_FRAME    = 3,    // SessionFrameRecord followed by height * width * channels pixel bytes
+    SESSION_RECORD_REPORT   = 4,    // SessionReportRecord: one control tick's output
+    SESSION_RECORD_TRACKER  = 5     // SessionTrackerRecord: tracker in use from the next frame record on
+};
+
+#pragma pack(push, 1)
+
+struct SessionFileHeader {
+    char     magic[8];
+    uint32_t version;
+    uint32_t tracker_channels;      // TrackerSettings::channels the session ran with (1 luma, 3 BGR); 0 = 3 (older logs)
+};
+
+struct SessionRecordHeader {
+    uint32_t type;
+    uint32_t payload_size;
+    int64_t  timestamp_ns;          // MonotonicNowNs() when the record was produced
+};
+
+struct SessionChannelsRecord {
+    int32_t ch1, ch2, ch3, ch4, ch6, ch7, ch8, ch9;
+    uint8_t ch5, ch10;
+};
+
+struct SessionFrameRecord {
+    uint64_t sequence;
+    int64_t  capture_timestamp_ns;
+    int32_t  width;
+    int32_t  height;
+    int32_t  channels;              // 3 (BGR)
+    uint8_t  tracking_enabled;      // flag_track as seen by the tracking thread
+    // tracker result on this frame
+    uint8_t  tracker_started;
+    uint8_t  tracker_active;
+    uint8_t  offset_valid;
+    float    offset_dx;             // display px, fractional (TrackingOffset)
+    float    offset_dy;
+    int32_t  bbox_x, bbox_y, bbox_width, bbox_height;
+};
+
+// Written before the first frame a tracker ran on (start or runtime switch). Logs
+// without one ran KCF.
+struct SessionTrackerRecord {
+    char     name[16];              // TrackerInfo::name, NUL-padded
+    uint32_t channels;              // input format it ran on (1 luma, 3 BGR)
+};
+
+struct SessionReportRecord {
+    uint64_t consumed_sequence;     // frame whose measurement was latched on this tick, 0 = none
+    int64_t  tick_dt_ns;            // time since the previous control tick, as fed to the PID integrator
+    int64_t  tick_ns;               // MonotonicNowNs() of the tick, the time the target estimate was taken at
+    uint8_t  tracker_started;
+    uint8_t  flag_track;
+    uint16_t buttons;
+    uint8_t  left_trigger;
+    uint8_t  right_trigger;
+    int16_t  thumb_lx, thumb_ly, thumb_rx, thumb_ry;
+};
+
+#pragma pack(pop)
+
+static_assert(sizeof(SessionFileHeader) == 16, "session log layout");
+static_assert(sizeof(SessionRecordHeader) == 16, "session log layout");
+static_assert(sizeof(SessionChannelsRecord) == 34, "session log layout");
+static_assert(sizeof(SessionFrameRecord) == 56, "session log layout");
+static_assert(sizeof(SessionTrackerRecord) == 20, "session log layout");
+static_assert(sizeof(SessionReportRecord) == 38, "session log layout");
+
+inline SessionChannelsRecord ToChannelsRecord(const RemoteChannels& channels) {
+    SessionChannelsRecord record;
+    record.ch1 = static_cast<int32_t>(channels.ch1); record.ch2 = static_cast<int32_t>(channels.ch2);
+    record.ch3 = static_cast<int32_t>(channels.ch3); record.ch4 = static_cast<int32_t>(channels.ch4);
+    record.ch6 = static_cast<int32_t>(channels.ch6); record.ch7 = static_cast<int32_t>(channels.ch7);
+    record.ch8 = static_cast<int32_t>(channels.ch8); record.ch9 = static_cast<int32_t>(channels.ch9);
+    record.ch5 = channels.ch5 ? 1 : 0; record.ch10 = channels.ch10 ? 1 : 0;
+    return record;
+}
+
+inline RemoteChannels FromChannelsRecord(const SessionChannelsRecord& record) {
+    RemoteChannels channels;
+    channels.ch1 = record.ch1; channels.ch2 = record.ch2; channels.ch3 = record.ch3; channels.ch4 = record.ch4;
+    channels.ch6 = record.ch6; channels.ch7 = record.ch7; channels.ch8 = record.ch8; channels.ch9 = record.ch9;
+    channels.ch5 = record.ch5 != 0; channels.ch10 = record.ch10 != 0;
+    return channels;
+}
+
+inline void PackPadReport(const VirtualPadReport& report, SessionReportRecord& record) {
+    record.buttons = report.wButtons;
+    record.left_trigger = report.bLeftTrigger;
+    record.right_trigger = report.bRightTrigger;
+    record.thumb_lx = report.sThumbLX; record.thumb_ly = report.sThumbLY;
+    record.thumb_rx = report.sThumbRX; record.thumb_ry = report.sThumbRY;
+}
+
+inline bool SamePadReport(const VirtualPadReport& report, const SessionReportRecord& record) {
+    return report.wButtons == record.buttons && report.bLeftTrigger == record.left_trigger &&
+           report.bRightTrigger == record.right_trigger &&
+           report.sThumbLX == record.thumb_lx && report.sThumbLY == record.thumb_ly &&
+           report.sThumbRX == record.thumb_rx && report.sThumbRY == record.thumb_ry;
+}
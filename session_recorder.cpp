@@ -0,0 +1,188 @@
+#include "session_recorder.h"
+
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+
+#include <opencv2/imgproc.hpp>
+
+#include "frame_source.h"
+
+bool SessionRecorder::Open(const std::string& path) {
+    Close();
+    m_file = fopen(path.c_str(), "wb");
+    if (!m_file) { std::cerr << "SessionRecorder: cannot open '" << path << "' for writing." << std::endl; return false; }
+
+    SessionFileHeader header;
+    memcpy(header.magic, SESSION_LOG_MAGIC, sizeof(header.magic));
+    header.version = SESSION_LOG_VERSION;
+    header.tracker_channels = static_cast<uint32_t>(g_tracker_settings.channels);
+    if (fwrite(&header, sizeof(header), 1, m_file) != 1) {
+        std::cerr << "SessionRecorder: failed to write header to '" << path << "'." << std::endl;
+        fclose(m_file); m_file = nullptr; return false;
+    }
+
+    m_stop = false;
+    m_pending_bytes = 0;
+    m_records_written = 0;
+    m_bytes_written = sizeof(header);
+    m_dropped_frames = 0;
+    m_writer = std::thread(&SessionRecorder::WriterThreadProc, this);
+    m_open.store(true, std::memory_order_release);
+    std::cout << "Recording session to " << path << std::endl;
+    return true;
+}
+
+void SessionRecorder::Close() {
+    if (!m_file) return;
+    m_open.store(false, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cv.notify_one();
+    if (m_writer.joinable()) m_writer.join();
+    fclose(m_file); m_file = nullptr;
+    m_free_buffers.clear();
+    std::cout << "Session recording closed: " << m_records_written << " records, " << (m_bytes_written >> 20) << " MiB";
+    if (m_dropped_frames > 0) std::cout << ", " << m_dropped_frames.load() << " frames dropped (writer too slow)";
+    std::cout << std::endl;
+}
+
+std::vector<uint8_t> SessionRecorder::AcquireBuffer(uint32_t type, size_t payload_size) {
+    std::vector<uint8_t> buffer;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_free_buffers.empty()) { buffer = std::move(m_free_buffers.back()); m_free_buffers.pop_back(); }
+    }
+    buffer.resize(sizeof(SessionRecordHeader) + payload_size); // capacity is kept, so steady state does not allocate
+    SessionRecordHeader header;
+    header.type = type;
+    header.payload_size = static_cast<uint32_t>(payload_size);
+    header.timestamp_ns = 0; // stamped in Submit()
+    memcpy(buffer.data(), &header, sizeof(header));
+    return buffer;
+}
+
+void SessionRecorder::Submit(std::vector<uint8_t>&& record, bool droppable) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (droppable && m_pending_bytes + record.size() > RECORDER_MAX_PENDING_BYTES) {
+            ++m_dropped_frames;
+            m_free_buffers.push_back(std::move(record));
+            return;
+        }
+        // Stamped under the lock so timestamps are monotonic in file order.
+        int64_t timestamp_ns = MonotonicNowNs();
+        memcpy(record.data() + offsetof(SessionRecordHeader, timestamp_ns), &timestamp_ns, sizeof(timestamp_ns));
+        m_pending_bytes += record.size();
+        m_pending.push_back(std::move(record));
+    }
+    m_cv.notify_one();
+}
+
+void SessionRecorder::RecordChannels(const RemoteChannels& channels) {
+    if (!IsOpen()) return;
+    SessionChannelsRecord payload = ToChannelsRecord(channels);
+    std::vector<uint8_t> record = AcquireBuffer(SESSION_RECORD_CHANNELS, sizeof(payload));
+    memcpy(record.data() + sizeof(SessionRecordHeader), &payload, sizeof(payload));
+    Submit(std::move(record), false);
+}
+
+void SessionRecorder::RecordPosePacket(const char* packet, size_t size) {
+    if (!IsOpen()) return;
+    std::vector<uint8_t> record = AcquireBuffer(SESSION_RECORD_POSE, size);
+    memcpy(record.data() + sizeof(SessionRecordHeader), packet, size);
+    Submit(std::move(record), false);
+}
+
+void SessionRecorder::RecordFrame(const cv::Mat& display_frame, uint64_t sequence, int64_t capture_timestamp_ns,
+                                  bool tracking_enabled, const TrackingMeasurement& measurement) {
+    if (!IsOpen() || display_frame.empty()) return;
+    if (display_frame.channels() != 3 && display_frame.channels() != 4) return;
+
+    SessionFrameRecord payload;
+    payload.sequence = sequence;
+    payload.capture_timestamp_ns = capture_timestamp_ns;
+    payload.width = display_frame.cols;
+    payload.height = display_frame.rows;
+    payload.channels = 3;
+    payload.tracking_enabled = tracking_enabled ? 1 : 0;
+    payload.tracker_started = measurement.tracker_started ? 1 : 0;
+    payload.tracker_active = measurement.tracker_active ? 1 : 0;
+    payload.offset_valid = measurement.offset.is_valid ? 1 : 0;
+    payload.offset_dx = measurement.offset.dx;
+    payload.offset_dy = measurement.offset.dy;
+    payload.bbox_x = measurement.tracked_bbox.x;
+    payload.bbox_y = measurement.tracked_bbox.y;
+    payload.bbox_width = measurement.tracked_bbox.width;
+    payload.bbox_height = measurement.tracked_bbox.height;
+
+    size_t pixel_bytes = static_cast<size_t>(payload.width) * payload.height * 3;
+    std::vector<uint8_t> record = AcquireBuffer(SESSION_RECORD_FRAME, sizeof(payload) + pixel_bytes);
+    uint8_t* payload_ptr = record.data() + sizeof(SessionRecordHeader);
+    memcpy(payload_ptr, &payload, sizeof(payload));
+
+    // Convert straight into the record buffer (no intermediate Mat).
+    cv::Mat pixels(payload.height, payload.width, CV_8UC3, payload_ptr + sizeof(payload));
+    if (display_frame.channels() == 4) cv::cvtColor(display_frame, pixels, cv::COLOR_BGRA2BGR);
+    else display_frame.copyTo(pixels);
+
+    Submit(std::move(record), true);
+}
+
+void SessionRecorder::RecordTracker(int tracker_index, int channels) {
+    if (!IsOpen() || tracker_index < 0) return;
+    SessionTrackerRecord payload;
+    memset(&payload, 0, sizeof(payload));
+    strncpy(payload.name, TrackerInfoAt(tracker_index).name, sizeof(payload.name) - 1);
+    payload.channels = static_cast<uint32_t>(channels);
+    std::vector<uint8_t> record = AcquireBuffer(SESSION_RECORD_TRACKER, sizeof(payload));
+    memcpy(record.data() + sizeof(SessionRecordHeader), &payload, sizeof(payload));
+    Submit(std::move(record), false);
+}
+
+void SessionRecorder::RecordReport(uint64_t consumed_sequence, int64_t tick_ns, int64_t tick_dt_ns, bool tracker_started, int flag_track,
+                                   const VirtualPadReport& report) {
+    if (!IsOpen()) return;
+    SessionReportRecord payload;
+    payload.consumed_sequence = consumed_sequence;
+    payload.tick_dt_ns = tick_dt_ns;
+    payload.tick_ns = tick_ns;
+    payload.tracker_started = tracker_started ? 1 : 0;
+    payload.flag_track = static_cast<uint8_t>(flag_track);
+    PackPadReport(report, payload);
+    std::vector<uint8_t> record = AcquireBuffer(SESSION_RECORD_REPORT, sizeof(payload));
+    memcpy(record.data() + sizeof(SessionRecordHeader), &payload, sizeof(payload));
+    Submit(std::move(record), false);
+}
+
+void SessionRecorder::WriterThreadProc() {
+    std::vector<uint8_t> record;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait(lock, [this] { return m_stop || !m_pending.empty(); });
+            if (m_pending.empty()) break; // m_stop and fully drained
+            record = std::move(m_pending.front());
+            m_pending.pop_front();
+        }
+
+        if (fwrite(record.data(), 1, record.size(), m_file) != record.size()) {
+            std::cerr << "SessionRecorder: write failed, recording stopped." << std::endl;
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_pending.clear();
+            m_pending_bytes = 0;
+            m_open.store(false, std::memory_order_release);
+            m_stop = true;
+            continue;
+        }
+        ++m_records_written;
+        m_bytes_written += record.size();
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pending_bytes -= record.size();
+        m_free_buffers.push_back(std::move(record));
+    }
+    fflush(m_file);
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+// Records a live session to a session_log.h file. Record* calls are made from
+// the tracking and control threads; they only serialise into a recycled buffer
+// and queue it, a background writer thread does the file I/O. When the writer
+// falls behind by more than RECORDER_MAX_PENDING_BYTES, frame records are
+// dropped (and counted) rather than stalling the pipeline.
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "session_log.h"
+#include "tracking.h"
+
+const size_t RECORDER_MAX_PENDING_BYTES = 64 * 1024 * 1024;
+
+class SessionRecorder {
+public:
+    SessionRecorder() = default;
+    ~SessionRecorder() { Close(); }
+
+    bool Open(const std::string& path);
+    void Close(); // flushes everything queued so far
+    bool IsOpen() const { return m_open.load(std::memory_order_acquire); }
+
+    void RecordChannels(const RemoteChannels& channels);
+    void RecordPosePacket(const char* packet, size_t size);
+    // display_frame is the BGRA/BGR image the tracker ran on; stored as BGR.
+    void RecordFrame(const cv::Mat& display_frame, uint64_t sequence, int64_t capture_timestamp_ns,
+                     bool tracking_enabled, const TrackingMeasurement& measurement);
+    // Registry entry the next recorded frames are tracked with (tracker_registry.h).
+    void RecordTracker(int tracker_index, int channels);
+    void RecordReport(uint64_t consumed_sequence, int64_t tick_ns, int64_t tick_dt_ns, bool tracker_started, int flag_track,
+                      const VirtualPadReport& report);
+
+    uint64_t DroppedFrames() const { return m_dropped_frames.load(); }
+
+private:
+    std::vector<uint8_t> AcquireBuffer(uint32_t type, size_t payload_size);
+    void Submit(std::vector<uint8_t>&& record, bool droppable);
+    void WriterThreadProc();
+
+    FILE* m_file = nullptr;
+    std::thread m_writer;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::deque<std::vector<uint8_t>> m_pending;
+    std::vector<std::vector<uint8_t>> m_free_buffers;
+    size_t m_pending_bytes = 0;
+    bool m_stop = false;
+    std::atomic<bool> m_open{false};
+    std::atomic<uint64_t> m_dropped_frames{0};
+    uint64_t m_records_written = 0;
+    uint64_t m_bytes_written = 0;
+};
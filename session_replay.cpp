@@ -0,0 +1,306 @@
+#include "session_replay.h"
+
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <thread>
+
+#ifdef _WIN32
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+#include "control.h"
+#include "frame_source.h"
+#include "pose.h"
+#include "session_log.h"
+#include "tracker_registry.h"
+#include "tracking.h"
+
+namespace {
+
+// Read-only mapping of a whole file.
+class MappedFile {
+public:
+    ~MappedFile() { Close(); }
+
+    bool Open(const std::string& path) {
+#ifdef _WIN32
+        m_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (m_file == INVALID_HANDLE_VALUE) return false;
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(m_file, &size) || size.QuadPart == 0) { Close(); return false; }
+        m_size = static_cast<size_t>(size.QuadPart);
+        m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!m_mapping) { Close(); return false; }
+        m_data = static_cast<const uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+        if (!m_data) { Close(); return false; }
+#else
+        m_fd = open(path.c_str(), O_RDONLY);
+        if (m_fd < 0) return false;
+        struct stat st;
+        if (fstat(m_fd, &st) != 0 || st.st_size == 0) { Close(); return false; }
+        m_size = static_cast<size_t>(st.st_size);
+        void* mapped = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_fd, 0);
+        if (mapped == MAP_FAILED) { Close(); return false; }
+        m_data = static_cast<const uint8_t*>(mapped);
+        madvise(mapped, m_size, MADV_SEQUENTIAL);
+#endif
+        return true;
+    }
+
+    void Close() {
+#ifdef _WIN32
+        if (m_data) { UnmapViewOfFile(m_data); m_data = nullptr; }
+        if (m_mapping) { CloseHandle(m_mapping); m_mapping = nullptr; }
+        if (m_file != INVALID_HANDLE_VALUE) { CloseHandle(m_file); m_file = INVALID_HANDLE_VALUE; }
+#else
+        if (m_data) { munmap(const_cast<uint8_t*>(m_data), m_size); m_data = nullptr; }
+        if (m_fd >= 0) { close(m_fd); m_fd = -1; }
+#endif
+        m_size = 0;
+    }
+
+    const uint8_t* Data() const { return m_data; }
+    size_t Size() const { return m_size; }
+
+private:
+#ifdef _WIN32
+    HANDLE m_file = INVALID_HANDLE_VALUE;
+    HANDLE m_mapping = nullptr;
+#else
+    int m_fd = -1;
+#endif
+    const uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+};
+
+// The control thread only ever consumes the latest of a few queued measurements.
+const size_t REPLAY_MEASUREMENT_HISTORY = 8;
+
+bool SameMeasurement(const TrackingMeasurement& measurement, const SessionFrameRecord& recorded) {
+    return measurement.tracker_started == (recorded.tracker_started != 0) &&
+           measurement.tracker_active == (recorded.tracker_active != 0) &&
+           measurement.offset.is_valid == (recorded.offset_valid != 0) &&
+           measurement.offset.dx == recorded.offset_dx && measurement.offset.dy == recorded.offset_dy &&
+           measurement.tracked_bbox == cv::Rect(recorded.bbox_x, recorded.bbox_y, recorded.bbox_width, recorded.bbox_height);
+}
+
+bool OpenSessionLog(const std::string& path, MappedFile& file, SessionFileHeader& file_header) {
+    if (!file.Open(path)) { std::cerr << "ReplaySession: cannot map '" << path << "'." << std::endl; return false; }
+    if (file.Size() < sizeof(file_header)) { std::cerr << "ReplaySession: '" << path << "' is too small." << std::endl; return false; }
+    memcpy(&file_header, file.Data(), sizeof(file_header));
+    if (memcmp(file_header.magic, SESSION_LOG_MAGIC, sizeof(file_header.magic)) != 0 || file_header.version != SESSION_LOG_VERSION) {
+        std::cerr << "ReplaySession: '" << path << "' is not a version " << SESSION_LOG_VERSION << " session log." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+bool ReplaySession(const std::string& path, const ReplayOptions& options, ReplayStats& stats) {
+    stats = ReplayStats();
+    MappedFile file;
+    SessionFileHeader file_header;
+    if (!OpenSessionLog(path, file, file_header)) return false;
+    const uint8_t* data = file.Data();
+    const size_t size = file.Size();
+
+    ResetTracker();
+    ResetControlState();
+    // Frames are stored as BGR either way; the tracker must see them in the format it saw live.
+    g_tracker_settings.channels = file_header.tracker_channels == 1 ? 1 : 3;
+    // Logs name their tracker in SESSION_RECORD_TRACKER records; until the first one (or in older logs) it was KCF.
+    int forced_tracker = -1;
+    if (!options.tracker.empty()) {
+        forced_tracker = FindTracker(options.tracker);
+        if (forced_tracker < 0) {
+            std::cerr << "ReplaySession: unknown tracker '" << options.tracker << "' (expected " << TrackerNameList() << ")." << std::endl;
+            return false;
+        }
+    }
+    SelectTracker(forced_tracker >= 0 ? forced_tracker : FindTracker("kcf"));
+
+    std::deque<TrackingMeasurement> measurements;
+    FrameWorkspace workspace;
+    int64_t first_timestamp_ns = 0;
+    int64_t last_timestamp_ns = 0;
+    const int64_t wall_start_ns = MonotonicNowNs();
+
+    size_t offset = sizeof(file_header);
+    while (offset + sizeof(SessionRecordHeader) <= size) {
+        SessionRecordHeader header;
+        memcpy(&header, data + offset, sizeof(header));
+        offset += sizeof(header);
+        if (header.payload_size > size - offset) {
+            std::cerr << "ReplaySession: truncated record at byte " << offset << ", stopping." << std::endl;
+            break;
+        }
+        const uint8_t* payload = data + offset;
+        offset += header.payload_size;
+
+        if (first_timestamp_ns == 0) first_timestamp_ns = header.timestamp_ns;
+        last_timestamp_ns = header.timestamp_ns;
+        if (options.realtime) {
+            int64_t due_ns = wall_start_ns + (header.timestamp_ns - first_timestamp_ns);
+            int64_t now_ns = MonotonicNowNs();
+            if (due_ns > now_ns) std::this_thread::sleep_for(std::chrono::nanoseconds(due_ns - now_ns));
+        }
+
+        switch (header.type) {
+        case SESSION_RECORD_CHANNELS: {
+            if (header.payload_size != sizeof(SessionChannelsRecord)) break;
+            SessionChannelsRecord record;
+            memcpy(&record, payload, sizeof(record));
+            g_joystickState = FromChannelsRecord(record);
+            is_track_on();
+            ++stats.channel_samples;
+            break;
+        }
+        case SESSION_RECORD_POSE: {
+            if (header.payload_size != UDP_BUFFER_SIZE) break;
+            ParsePosePacket(reinterpret_cast<const char*>(payload), g_current_drone_pose);
+            ++stats.pose_packets;
+            break;
+        }
+        case SESSION_RECORD_FRAME: {
+            if (header.payload_size < sizeof(SessionFrameRecord)) break;
+            SessionFrameRecord record;
+            memcpy(&record, payload, sizeof(record));
+            size_t pixel_bytes = static_cast<size_t>(record.width) * record.height * record.channels;
+            if (record.channels != 3 || header.payload_size != sizeof(record) + pixel_bytes) {
+                std::cerr << "ReplaySession: malformed frame record (seq " << record.sequence << "), skipped." << std::endl;
+                break;
+            }
+            // The tracker only reads its input, so it can run on the mapped pages directly.
+            cv::Mat display_frame(record.height, record.width, CV_8UC3, const_cast<uint8_t*>(payload + sizeof(record)));
+
+            TrackingMeasurement measurement;
+            measurement.sequence = record.sequence;
+            measurement.capture_timestamp_ns = record.capture_timestamp_ns;
+            int64_t tracking_start_ns = MonotonicNowNs();
+            TrackingStep(display_frame, record.tracking_enabled != 0, measurement, workspace);
+            stats.tracking_ns += MonotonicNowNs() - tracking_start_ns;
+
+            if (!SameMeasurement(measurement, record)) {
+                ++stats.tracker_mismatches;
+                if (options.verbose) {
+                    std::cout << "Frame " << record.sequence << ": recorded offset (" << record.offset_dx << "," << record.offset_dy
+                              << (record.offset_valid ? "" : " invalid") << "), replayed (" << measurement.offset.dx << ","
+                              << measurement.offset.dy << (measurement.offset.is_valid ? "" : " invalid") << ")" << std::endl;
+                }
+            }
+            measurements.push_back(measurement);
+            if (measurements.size() > REPLAY_MEASUREMENT_HISTORY) measurements.pop_front();
+            ++stats.frames;
+            break;
+        }
+        case SESSION_RECORD_TRACKER: {
+            if (header.payload_size != sizeof(SessionTrackerRecord) || forced_tracker >= 0) break;
+            SessionTrackerRecord record;
+            memcpy(&record, payload, sizeof(record));
+            std::string name(record.name, strnlen(record.name, sizeof(record.name)));
+            int index = FindTracker(name);
+            if (index < 0) {
+                std::cerr << "ReplaySession: session used tracker '" << name << "', which this build does not have." << std::endl;
+                break;
+            }
+            SelectTracker(index);
+            g_tracker_settings.channels = record.channels == 1 ? 1 : 3;
+            break;
+        }
+        case SESSION_RECORD_REPORT: {
+            if (header.payload_size != sizeof(SessionReportRecord)) break;
+            SessionReportRecord record;
+            memcpy(&record, payload, sizeof(record));
+            // 'T' key toggles are not separate records; the tick's own flag is authoritative.
+            flag_track = record.flag_track;
+
+            if (record.consumed_sequence != 0) {
+                const TrackingMeasurement* consumed = nullptr;
+                for (const TrackingMeasurement& candidate : measurements) {
+                    if (candidate.sequence == record.consumed_sequence) { consumed = &candidate; break; }
+                }
+                if (consumed) {
+                    ApplyTrackingMeasurement(consumed->offset, consumed->tracker_started, consumed->capture_timestamp_ns, consumed->recovering);
+                } else {
+                    ++stats.missing_measurements;
+                }
+            }
+            // Same dt the live control thread integrated with and the same estimate time, so the PID state matches bit for bit.
+            ControlAircraftWithPID(record.tick_dt_ns / 1e9, record.tick_ns);
+
+            VirtualPadReport report = BuildVirtualReport();
+            if (!SamePadReport(report, record)) {
+                ++stats.report_mismatches;
+                if (options.verbose) {
+                    std::cout << "Report after frame " << record.consumed_sequence << ": recorded LX/LY/RX/RY "
+                              << record.thumb_lx << "/" << record.thumb_ly << "/" << record.thumb_rx << "/" << record.thumb_ry
+                              << ", replayed " << report.sThumbLX << "/" << report.sThumbLY << "/" << report.sThumbRX << "/"
+                              << report.sThumbRY << std::endl;
+                }
+            }
+            ++stats.reports;
+            break;
+        }
+        default:
+            break; // unknown record types are skipped so newer logs stay readable
+        }
+    }
+
+    stats.log_duration_ns = last_timestamp_ns - first_timestamp_ns;
+    stats.wall_duration_ns = MonotonicNowNs() - wall_start_ns;
+    ResetTracker();
+    return true;
+}
+
+void PrintReplayStats(const ReplayStats& stats) {
+    double wall_s = stats.wall_duration_ns / 1e9;
+    double log_s = stats.log_duration_ns / 1e9;
+    std::cout << "Replayed " << stats.frames << " frames, " << stats.reports << " control ticks, "
+              << stats.channel_samples << " channel samples, " << stats.pose_packets << " pose packets" << std::endl;
+    std::cout << "  session " << log_s << " s, replay " << wall_s << " s";
+    if (wall_s > 0.0) std::cout << " (" << (stats.frames / wall_s) << " frames/s, " << (log_s / wall_s) << "x realtime)";
+    std::cout << std::endl;
+    if (stats.frames > 0) std::cout << "  tracker: " << (stats.tracking_ns / 1e3 / stats.frames) << " us/frame" << std::endl;
+    std::cout << "  mismatches: tracker " << stats.tracker_mismatches << ", reports " << stats.report_mismatches
+              << ", missing measurements " << stats.missing_measurements << std::endl;
+}
+
+bool LoadSessionFrames(const std::string& path, size_t max_frames, std::vector<SessionFrame>& frames_out) {
+    frames_out.clear();
+    MappedFile file;
+    SessionFileHeader file_header;
+    if (!OpenSessionLog(path, file, file_header)) return false;
+    const uint8_t* data = file.Data();
+    const size_t size = file.Size();
+    size_t offset = sizeof(file_header);
+    while (offset + sizeof(SessionRecordHeader) <= size && (max_frames == 0 || frames_out.size() < max_frames)) {
+        SessionRecordHeader header;
+        memcpy(&header, data + offset, sizeof(header));
+        offset += sizeof(header);
+        if (header.payload_size > size - offset) break;
+        const uint8_t* payload = data + offset;
+        offset += header.payload_size;
+        if (header.type != SESSION_RECORD_FRAME || header.payload_size < sizeof(SessionFrameRecord)) continue;
+
+        SessionFrameRecord record;
+        memcpy(&record, payload, sizeof(record));
+        if (record.channels != 3 || header.payload_size != sizeof(record) + static_cast<size_t>(record.width) * record.height * 3) continue;
+        SessionFrame frame;
+        frame.bgr = cv::Mat(record.height, record.width, CV_8UC3, const_cast<uint8_t*>(payload + sizeof(record))).clone();
+        frame.tracking_enabled = record.tracking_enabled != 0;
+        frame.tracker_started = record.tracker_started != 0;
+        frame.tracker_active = record.tracker_active != 0;
+        frame.tracked_bbox = cv::Rect(record.bbox_x, record.bbox_y, record.bbox_width, record.bbox_height);
+        frames_out.push_back(frame);
+    }
+    return true;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+// Deterministic replay of a recorded session (session_log.h). The log is
+// memory-mapped and walked once in file order; frames are handed to the
+// tracker as cv::Mat headers over the mapping (no copy), and the tracker, PID
+// and pad mapping run exactly as the live tracking/control threads did. Every
+// recorded tracker result and pad report is compared against the replayed one.
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+struct ReplayOptions {
+    bool realtime = false;          // pace records at their recorded timestamps; false = as fast as possible
+    bool verbose = false;           // print every mismatch, not just the counts
+    std::string tracker;            // run this registry entry instead of the recorded one (mismatches are then expected)
+};
+
+struct ReplayStats {
+    uint64_t frames = 0;
+    uint64_t channel_samples = 0;
+    uint64_t pose_packets = 0;
+    uint64_t reports = 0;
+    uint64_t tracker_mismatches = 0;
+    uint64_t report_mismatches = 0;
+    uint64_t missing_measurements = 0;  // report consumed a frame that is not in the log (dropped while recording)
+    int64_t  log_duration_ns = 0;       // last - first record timestamp
+    int64_t  wall_duration_ns = 0;
+    int64_t  tracking_ns = 0;           // time spent in TrackingStep
+};
+
+// Replays 'path' through the tracking and control code. Resets tracker and
+// control state first. Returns false if the file cannot be mapped or is corrupt.
+bool ReplaySession(const std::string& path, const ReplayOptions& options, ReplayStats& stats);
+
+void PrintReplayStats(const ReplayStats& stats);
+
+// A recorded frame and the tracker result the live session had on it, for
+// evaluating trackers offline (SimBenchmarks --session).
+struct SessionFrame {
+    cv::Mat bgr;                    // owns its pixels
+    bool tracking_enabled = false;
+    bool tracker_started = false;
+    bool tracker_active = false;
+    cv::Rect tracked_bbox;
+};
+
+// Reads the frame records of 'path', at most max_frames of them (0 = all).
+bool LoadSessionFrames(const std::string& path, size_t max_frames, std::vector<SessionFrame>& frames_out);
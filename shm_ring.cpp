@@ -0,0 +1,193 @@
+#include "shm_ring.h"
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <random>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const size_t SHM_RING_ROW_ALIGNMENT = 64;
+const size_t SHM_RING_SLOT_ALIGNMENT = 4096;
+
+size_t AlignUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// Identity of one Create(): random, mixed with the clock in case random_device is deterministic.
+uint64_t NewRingId() {
+    std::random_device random;
+    uint64_t id = (static_cast<uint64_t>(random()) << 32) ^ random()
+                  ^ static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+    return id != 0 ? id : 1;
+}
+
+} // namespace
+
+ShmRing::~ShmRing() {
+#ifdef _WIN32
+    if (m_base) UnmapViewOfFile(m_base);
+    if (m_mapping) CloseHandle(static_cast<HANDLE>(m_mapping));
+#else
+    if (m_base) munmap(m_base, m_size);
+    if (m_owner) shm_unlink(m_name.c_str());
+#endif
+}
+
+bool ShmRing::Map(const std::string& name, size_t size, bool create) {
+#ifdef _WIN32
+    m_name = "Local\\" + name;
+    HANDLE mapping = create
+        ? CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, static_cast<DWORD>(static_cast<uint64_t>(size) >> 32),
+                             static_cast<DWORD>(size & 0xFFFFFFFFu), m_name.c_str())
+        : OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, m_name.c_str());
+    if (!mapping) return false;
+    m_mapping = mapping;
+    m_base = static_cast<uint8_t*>(MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size)); // size 0 = the whole section
+    if (!m_base) return false;
+    if (size == 0) {
+        MEMORY_BASIC_INFORMATION info;
+        if (VirtualQuery(m_base, &info, sizeof(info)) == 0) return false;
+        size = info.RegionSize;
+    }
+    m_size = size;
+#else
+    m_name = "/" + name;
+    if (create) shm_unlink(m_name.c_str()); // a stale ring from a crashed producer may have another size
+    int fd = shm_open(m_name.c_str(), create ? (O_CREAT | O_EXCL | O_RDWR) : O_RDWR, 0600);
+    if (fd < 0) return false;
+    m_owner = create;
+    bool sized = true;
+    if (create) {
+        sized = ftruncate(fd, static_cast<off_t>(size)) == 0;
+    } else {
+        struct stat st;
+        sized = fstat(fd, &st) == 0;
+        size = sized ? static_cast<size_t>(st.st_size) : 0;
+    }
+    void* base = (sized && size > 0) ? mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (base == MAP_FAILED) return false;
+    m_base = static_cast<uint8_t*>(base);
+    m_size = size;
+#endif
+    m_header = reinterpret_cast<ShmRingHeader*>(m_base);
+    return true;
+}
+
+std::unique_ptr<ShmRing> ShmRing::Create(const std::string& name, int width, int height, int slot_count) {
+    if (width <= 0 || height <= 0 || slot_count < 2 || slot_count > SHM_RING_MAX_SLOTS) {
+        std::cerr << "ShmRing: invalid geometry " << width << "x" << height << " x " << slot_count << " slots." << std::endl;
+        return nullptr;
+    }
+    size_t pitch = AlignUp(static_cast<size_t>(width) * 4, SHM_RING_ROW_ALIGNMENT);
+    size_t slot_stride = AlignUp(pitch * static_cast<size_t>(height), SHM_RING_SLOT_ALIGNMENT);
+    size_t pixels_offset = AlignUp(sizeof(ShmRingHeader), SHM_RING_SLOT_ALIGNMENT);
+    size_t size = pixels_offset + slot_stride * static_cast<size_t>(slot_count);
+
+    std::unique_ptr<ShmRing> ring(new ShmRing());
+    if (!ring->Map(name, size, true)) {
+        std::cerr << "ShmRing: failed to create shared memory '" << name << "' (" << size << " bytes)." << std::endl;
+        return nullptr;
+    }
+    // Fresh mappings are zero-filled; construct the header in place so the atomics are valid objects.
+    ShmRingHeader* header = new (ring->m_base) ShmRingHeader();
+    header->version = SHM_RING_VERSION;
+    header->ring_id = NewRingId();
+    header->width = static_cast<uint32_t>(width);
+    header->height = static_cast<uint32_t>(height);
+    header->pitch = static_cast<uint32_t>(pitch);
+    header->slot_count = static_cast<uint32_t>(slot_count);
+    header->slot_stride = slot_stride;
+    header->pixels_offset = pixels_offset;
+    header->published_sequence.store(0, std::memory_order_relaxed);
+    header->published_slot.store(0, std::memory_order_relaxed);
+    for (ShmRingSlot& slot : header->slots) {
+        slot.sequence.store(0, std::memory_order_relaxed);
+        slot.generation.store(0, std::memory_order_relaxed);
+        slot.timestamp_ns.store(0, std::memory_order_relaxed);
+        slot.readers.store(0, std::memory_order_relaxed);
+    }
+    header->magic.store(SHM_RING_MAGIC, std::memory_order_release);
+    return ring;
+}
+
+std::unique_ptr<ShmRing> ShmRing::Open(const std::string& name) {
+    std::unique_ptr<ShmRing> ring(new ShmRing());
+    if (!ring->Map(name, 0, false)) return nullptr;
+    if (ring->m_size < sizeof(ShmRingHeader)) return nullptr;
+    const ShmRingHeader* header = ring->m_header;
+    if (header->magic.load(std::memory_order_acquire) != SHM_RING_MAGIC) return nullptr; // producer still initialising
+    if (header->version != SHM_RING_VERSION) {
+        std::cerr << "ShmRing: '" << name << "' has version " << header->version << ", expected " << SHM_RING_VERSION << "." << std::endl;
+        return nullptr;
+    }
+    if (header->slot_count < 2 || header->slot_count > SHM_RING_MAX_SLOTS || header->pitch < header->width * 4
+        || header->slot_stride < static_cast<uint64_t>(header->pitch) * header->height
+        || header->pixels_offset + header->slot_stride * header->slot_count > ring->m_size) {
+        std::cerr << "ShmRing: '" << name << "' has an inconsistent header." << std::endl;
+        return nullptr;
+    }
+    return ring;
+}
+
+int ShmRing::BeginWrite() {
+    int count = SlotCount();
+    int latest = static_cast<int>(m_header->published_slot.load(std::memory_order_relaxed));
+    for (int i = 1; i <= count; ++i) {
+        int candidate = (latest + i) % count;
+        ShmRingSlot& slot = m_header->slots[candidate];
+        if (candidate == latest && m_header->published_sequence.load(std::memory_order_relaxed) != 0) continue;
+        if (slot.readers.load() != 0) continue;
+        uint64_t previous = slot.sequence.exchange(0);
+        if (slot.readers.load() != 0) {         // a reader leased it between the two checks: it keeps the old frame
+            slot.sequence.store(previous);
+            continue;
+        }
+        return candidate;
+    }
+    return -1;
+}
+
+void ShmRing::Publish(int slot, uint64_t sequence, uint64_t generation, int64_t timestamp_ns) {
+    ShmRingSlot& target = m_header->slots[slot];
+    target.generation.store(generation, std::memory_order_relaxed);
+    target.timestamp_ns.store(timestamp_ns, std::memory_order_relaxed);
+    target.sequence.store(sequence, std::memory_order_release);
+    m_header->published_slot.store(static_cast<uint32_t>(slot), std::memory_order_release);
+    m_header->published_sequence.store(sequence, std::memory_order_release);
+}
+
+int ShmRing::AcquireLatest(uint64_t after_sequence) {
+    for (int attempt = 0; attempt < 4; ++attempt) {
+        if (PublishedSequence() <= after_sequence) return -1;
+        int candidate = static_cast<int>(m_header->published_slot.load(std::memory_order_acquire));
+        if (candidate < 0 || candidate >= SlotCount()) return -1;
+        ShmRingSlot& slot = m_header->slots[candidate];
+        slot.readers.fetch_add(1);
+        uint64_t sequence = slot.sequence.load();
+        if (sequence > after_sequence) return candidate;
+        slot.readers.fetch_sub(1);              // being rewritten, or published_slot moved on: look again
+    }
+    return -1;
+}
+
+void ShmRing::Release(int slot) {
+    m_header->slots[slot].readers.fetch_sub(1, std::memory_order_release);
+}
+
+void ShmRing::ClearLeases() {
+    for (ShmRingSlot& slot : m_header->slots) slot.readers.store(0);
+}
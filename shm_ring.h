@@ -0,0 +1,95 @@
+#pragma once
+
+// Shared-memory frame ring between a producer process (the simulator, or
+// SimShmProducer for testing) and the SharedMemory frame source. The mapping
+// is a header followed by slot_count BGRA images; the producer renders into a
+// free slot and publishes it, the consumer wraps the latest slot in a cv::Mat
+// header without copying.
+//
+// Slots are leased rather than locked. A reader bumps slot.readers and then
+// re-checks slot.sequence; a writer zeroes slot.sequence and then re-checks
+// slot.readers (both sequentially consistent), so either the writer sees the
+// lease and picks another slot or the reader sees the slot being rewritten and
+// retries. The producer never waits: with every slot leased it drops the frame.
+// One consumer per ring; a consumer attaching clears leases a dead one left.
+//
+// POSIX: shm_open("/<name>"). Windows: named file mapping "Local\<name>".
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+const uint32_t SHM_RING_MAGIC = 0x53524E47;     // "GNRS"
+const uint32_t SHM_RING_VERSION = 2;
+const int SHM_RING_MAX_SLOTS = 16;
+
+struct alignas(64) ShmRingSlot {
+    std::atomic<uint64_t> sequence;     // producer frame number in the slot; 0 = empty or being written
+    std::atomic<uint64_t> generation;   // producer content generation: equal = identical pixels (0 = unknown)
+    std::atomic<int64_t> timestamp_ns;  // producer's MonotonicNowNs() when the frame was rendered
+    std::atomic<uint32_t> readers;      // consumer leases on the slot's pixels
+};
+
+struct ShmRingHeader {
+    std::atomic<uint32_t> magic;        // written last by the producer, so a set magic means the rest is valid
+    uint32_t version;
+    uint64_t ring_id;                   // new random value every Create(): tells a restarted producer from an idle one
+    uint32_t width;
+    uint32_t height;
+    uint32_t pitch;                     // bytes per row (width * 4, rounded up to 64)
+    uint32_t slot_count;
+    uint64_t slot_stride;               // bytes between slot images
+    uint64_t pixels_offset;             // first slot image, from the start of the mapping
+    std::atomic<uint64_t> published_sequence;   // last published frame (0 = none yet)
+    std::atomic<uint32_t> published_slot;
+    ShmRingSlot slots[SHM_RING_MAX_SLOTS];
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free,
+              "shared-memory ring needs address-free (lock-free) atomics");
+
+class ShmRing {
+public:
+    ~ShmRing();
+
+    // Producer: creates (or replaces) the named ring. Returns nullptr on failure.
+    static std::unique_ptr<ShmRing> Create(const std::string& name, int width, int height, int slot_count);
+    // Consumer: attaches to an existing ring and validates its header. Returns nullptr when
+    // the ring does not exist yet or is not a compatible ring.
+    static std::unique_ptr<ShmRing> Open(const std::string& name);
+
+    int Width() const { return static_cast<int>(m_header->width); }
+    int Height() const { return static_cast<int>(m_header->height); }
+    size_t Pitch() const { return m_header->pitch; }
+    int SlotCount() const { return static_cast<int>(m_header->slot_count); }
+    uint8_t* SlotPixels(int slot) const { return m_base + m_header->pixels_offset + m_header->slot_stride * static_cast<uint64_t>(slot); }
+    const ShmRingSlot& Slot(int slot) const { return m_header->slots[slot]; }
+    uint64_t PublishedSequence() const { return m_header->published_sequence.load(std::memory_order_acquire); }
+    uint64_t RingId() const { return m_header->ring_id; }
+
+    // Producer: a slot no reader holds and that is not the latest frame, marked as being
+    // written; -1 when every other slot is leased.
+    int BeginWrite();
+    void Publish(int slot, uint64_t sequence, uint64_t generation, int64_t timestamp_ns);
+
+    // Consumer: leases the latest published slot if its frame is newer than
+    // 'after_sequence'; -1 otherwise. Every lease must be given back with Release().
+    int AcquireLatest(uint64_t after_sequence);
+    void Release(int slot);
+    void ClearLeases();
+
+private:
+    ShmRing() = default;
+    bool Map(const std::string& name, size_t size, bool create);
+
+    std::string m_name;
+    uint8_t* m_base = nullptr;
+    size_t m_size = 0;
+    ShmRingHeader* m_header = nullptr;
+    bool m_owner = false;               // producer: unlink the name on destruction
+#ifdef _WIN32
+    void* m_mapping = nullptr;          // HANDLE
+#endif
+};
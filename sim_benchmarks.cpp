@@ -0,0 +1,552 @@
+// SimBenchmarks: micro-benchmarks for the per-frame hot paths, on synthetic
+// frames at common monitor resolutions.
+//
+//   SimBenchmarks [--json OUT] [--baseline FILE] [--threshold PCT] [--filter SUBSTR]
+//                 [--resolutions 1080p,1440p,4k] [--min-sample-ms MS] [--samples N]
+//                 [--session LOG] [--session-frames N]
+//
+// --session adds every registered tracker on the frames of a recorded session
+// (JoystickReaderApp --record): update latency, and how closely each follows
+// the track the live run recorded.
+//
+// With --baseline the exit code is the number of benchmarks that regressed by
+// more than --threshold percent (default 10), so CI can gate a release on it.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include <opencv2/tracking.hpp>
+
+#include "benchmark_harness.h"
+#include "control.h"
+#include "downscale.h"
+#include "frame_pyramid.h"
+#include "frame_source.h"
+#include "latency_stats.h"
+#include "overlay.h"
+#include "pose.h"
+#include "session_replay.h"
+#include "tracker_registry.h"
+#include "tracking.h"
+#include "worker_pool.h"
+
+namespace {
+
+struct BenchResolution {
+    std::string label;
+    int width;
+    int height;
+};
+
+const BenchResolution ALL_RESOLUTIONS[] = {
+    { "1080p", 1920, 1080 },
+    { "1440p", 2560, 1440 },
+    { "4k",    3840, 2160 },
+};
+
+const int TRACKER_FRAME_COUNT = 60;     // distinct frames cycled through by the tracker benchmark
+const size_t SESSION_FRAME_LIMIT = 1200; // --session: frames loaded by default (20 s at 60 fps, about 1 MB each)
+const int SCALAR_BATCH = 1024;          // operations per call for the tiny scalar kernels
+const size_t DXGI_PITCH_ALIGNMENT = 256; // staging textures are mapped with 256-byte aligned rows
+
+// Renders 'count' consecutive frames of the synthetic source at the given resolution.
+std::vector<cv::Mat> RenderSyntheticFrames(const BenchResolution& resolution, int count) {
+    FrameSourceConfig config;
+    config.type = FrameSourceType::Synthetic;
+    config.synthetic_width = resolution.width;
+    config.synthetic_height = resolution.height;
+    config.synthetic_fps = 0.0; // unpaced
+    std::unique_ptr<FrameSource> source = CreateSyntheticFrameSource(config);
+    std::vector<cv::Mat> frames;
+    if (!source || !source->Open()) return frames;
+    FrameInfo info;
+    for (int i = 0; i < count; ++i) {
+        cv::Mat frame;
+        if (source->Grab(frame, info, 0, 0)) frames.push_back(frame);
+    }
+    return frames;
+}
+
+void BenchCaptureKernels(BenchmarkRunner& runner, const BenchResolution& resolution, const cv::Mat& bgra) {
+    // Row-by-row copy out of a pitched staging map, as in the DXGI/X11 Grab().
+    size_t row_bytes = static_cast<size_t>(bgra.cols) * 4;
+    size_t pitch = (row_bytes + DXGI_PITCH_ALIGNMENT - 1) / DXGI_PITCH_ALIGNMENT * DXGI_PITCH_ALIGNMENT;
+    std::vector<uint8_t> staging(pitch * bgra.rows);
+    for (int y = 0; y < bgra.rows; ++y) memcpy(staging.data() + y * pitch, bgra.ptr(y), row_bytes);
+    cv::Mat destination(bgra.rows, bgra.cols, CV_8UC4);
+    runner.Run("capture_copy_rows/" + resolution.label, [&] {
+        CopyPitchedRows(staging.data(), pitch, destination, row_bytes, bgra.rows);
+        DoNotOptimize(destination.data[0]);
+    });
+
+    // --capture-roi: only the search window around a 32 display-px target, at native resolution.
+    int window_size = 3 * 32 * bgra.cols / ComputeDisplaySize(bgra.size()).width;
+    cv::Rect window(bgra.cols / 2 - window_size / 2, bgra.rows / 2 - window_size / 2, window_size, window_size);
+    cv::Mat window_destination(window.size(), CV_8UC4);
+    const uint8_t* window_source = staging.data() + static_cast<size_t>(window.y) * pitch + static_cast<size_t>(window.x) * 4;
+    runner.Run("capture_copy_window/" + resolution.label, [&] {
+        CopyPitchedRows(window_source, pitch, window_destination, static_cast<size_t>(window.width) * 4, window.height);
+        DoNotOptimize(window_destination.data[0]);
+    });
+
+    // Incremental paths: each frame changes one region of about 5% of the screen.
+    cv::Rect dirty_rect(bgra.cols / 3, bgra.rows / 3, bgra.cols / 5, bgra.rows / 4);
+    TileChangeTracker tiles;
+    tiles.Reset(bgra.size());
+    uint64_t sequence = 1;
+    tiles.BeginFrame(sequence);
+    tiles.MarkChangedByHash(staging.data(), pitch); // seeds the per-tile hashes
+    runner.Run("tile_hash/" + resolution.label, [&] {
+        tiles.BeginFrame(++sequence);
+        tiles.MarkChangedByHash(staging.data(), pitch);
+    });
+
+    tiles.CopyChanged(staging.data(), pitch, destination, 0);
+    runner.Run("capture_copy_changed_5pct/" + resolution.label, [&] {
+        tiles.BeginFrame(++sequence);
+        tiles.MarkChanged(dirty_rect);
+        size_t copied = tiles.CopyChanged(staging.data(), pitch, destination, sequence - 1);
+        DoNotOptimize(copied);
+    });
+
+    cv::Size display_size = ComputeDisplaySize(bgra.size());
+    cv::Mat display(display_size, CV_8UC4);
+    runner.Run("resize_to_display/" + resolution.label, [&] {
+        cv::resize(bgra, display, display.size());
+    });
+
+    FrameWorkspace workspace;
+    runner.Run("resize_changed_5pct/" + resolution.label, [&] {
+        tiles.BeginFrame(++sequence);
+        tiles.MarkChanged(dirty_rect);
+        workspace.arena.Reset();
+        size_t written = ResizeToDisplay(bgra, tiles.Map(), sequence - 1, display, workspace);
+        DoNotOptimize(written);
+    });
+
+    cv::Mat bgr_full;
+    runner.Run("cvtcolor_bgra2bgr_full/" + resolution.label, [&] {
+        cv::cvtColor(bgra, bgr_full, cv::COLOR_BGRA2BGR);
+    });
+
+    cv::resize(bgra, display, display.size());
+    cv::Mat bgr_display;
+    runner.Run("cvtcolor_bgra2bgr_display/" + resolution.label, [&] {
+        cv::cvtColor(display, bgr_display, cv::COLOR_BGRA2BGR);
+    });
+}
+
+// Capture frame -> tracker input at the display size: the OpenCV chain
+// (cv::resize on BGRA, then cvtColor) against the fused kernel on every ISA
+// this machine supports.
+void BenchDownscaleKernels(BenchmarkRunner& runner, const BenchResolution& resolution, const cv::Mat& bgra) {
+    cv::Size display_size = ComputeDisplaySize(bgra.size());
+    cv::Mat display;
+    cv::Mat chain_bgr;
+    runner.Run("opencv_chain_bgr_bilinear/" + resolution.label, [&] {
+        cv::resize(bgra, display, display_size, 0, 0, cv::INTER_LINEAR);
+        cv::cvtColor(display, chain_bgr, cv::COLOR_BGRA2BGR);
+    });
+    runner.Run("opencv_chain_bgr_area/" + resolution.label, [&] {
+        cv::resize(bgra, display, display_size, 0, 0, cv::INTER_AREA);
+        cv::cvtColor(display, chain_bgr, cv::COLOR_BGRA2BGR);
+    });
+    cv::Mat chain_gray;
+    runner.Run("opencv_chain_gray_bilinear/" + resolution.label, [&] {
+        cv::resize(bgra, display, display_size, 0, 0, cv::INTER_LINEAR);
+        cv::cvtColor(display, chain_gray, cv::COLOR_BGRA2GRAY);
+    });
+
+    cv::Mat bgr(display_size, CV_8UC3);
+    cv::Mat gray(display_size, CV_8UC1);
+    const DownscaleIsa isas[] = { DownscaleIsa::Scalar, DownscaleIsa::Sse41, DownscaleIsa::Avx2 };
+    const DownscaleFilter filters[] = { DownscaleFilter::Bilinear, DownscaleFilter::Area };
+    FusedDownscaler downscaler;
+    for (DownscaleIsa isa : isas) {
+        if (!DownscaleIsaSupported(isa)) continue;
+        downscaler.SetIsa(isa);
+        for (DownscaleFilter filter : filters) {
+            std::string suffix = std::string(DownscaleFilterName(filter)) + "/" + DownscaleIsaName(isa) + "/" + resolution.label;
+            runner.Run("fused_downscale_bgr_" + suffix, [&] { downscaler.Run(bgra, bgr, filter); });
+            runner.Run("fused_downscale_gray_" + suffix, [&] { downscaler.Run(bgra, gray, filter); });
+        }
+    }
+}
+
+// Display frame + tracker input + a quarter-width luma level from one pyramid per
+// frame, every level rebuilt (tile map marks everything changed).
+void BenchPyramid(BenchmarkRunner& runner, const BenchResolution& resolution, const cv::Mat& bgra) {
+    FrameWorkspace workspace;
+    FramePyramid pyramid;
+    FrameTileMap no_tiles;
+    no_tiles.tiles_x = no_tiles.tiles_y = 0;
+    uint64_t sequence = 0;
+    runner.Run("pyramid_display_bgr_gray/" + resolution.label, [&] {
+        workspace.arena.Reset();
+        pyramid.Reset(bgra, no_tiles, ++sequence);
+        const cv::Mat& display = pyramid.LevelForWidth(DISPLAY_WIDTH, PyramidFormat::Bgra, workspace);
+        const cv::Mat& bgr = pyramid.LevelForWidth(DISPLAY_WIDTH, PyramidFormat::Bgr, workspace);
+        const cv::Mat& gray = pyramid.LevelForWidth(DISPLAY_WIDTH / 4, PyramidFormat::Gray, workspace);
+        DoNotOptimize(display.data);
+        DoNotOptimize(bgr.data);
+        DoNotOptimize(gray.data);
+    });
+}
+
+// The fused kernel split into L2-sized row bands over a WorkerPool of 1..N threads
+// (N = hardware threads), then a speedup-vs-one-thread table for this resolution.
+// Workers are left unpinned here so the numbers do not depend on which core the
+// benchmark's own thread happens to run on.
+void BenchParallelDownscale(BenchmarkRunner& runner, const BenchResolution& resolution, const cv::Mat& bgra) {
+    cv::Size display_size = ComputeDisplaySize(bgra.size());
+    const int max_threads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    const char* formats[] = { "bgra", "bgr" };
+    cv::Mat outputs[] = { cv::Mat(display_size, CV_8UC4), cv::Mat(display_size, CV_8UC3) };
+    std::vector<std::string> names[2];
+    FusedDownscaler downscaler;
+    for (int threads = 1; threads <= max_threads; ++threads) {
+        WorkerPool pool(threads);
+        for (int f = 0; f < 2; ++f) {
+            std::string name = std::string("parallel_downscale_") + formats[f] + "_bilinear/t" + std::to_string(threads) + "/" + resolution.label;
+            names[f].push_back(name);
+            runner.Run(name, [&] { downscaler.Run(bgra, outputs[f], DownscaleFilter::Bilinear, pool); });
+        }
+    }
+
+    auto median_of = [&](const std::string& name) {
+        for (const BenchmarkResult& result : runner.Results()) {
+            if (result.name == name) return result.median_ns;
+        }
+        return 0.0;
+    };
+    for (int f = 0; f < 2; ++f) {
+        double single = median_of(names[f][0]);
+        if (single <= 0.0) continue; // filtered out
+        std::cout << "parallel_downscale_" << formats[f] << "/" << resolution.label << " (L2 " << L2CacheBytes() / 1024
+                  << " KB, " << downscaler.BandRows(bgra.size(), display_size, DownscaleFilter::Bilinear, 1) << " rows/band):";
+        for (int threads = 1; threads <= max_threads; ++threads) {
+            double median = median_of(names[f][threads - 1]);
+            if (median > 0.0) std::cout << "  t" << threads << " " << std::fixed << std::setprecision(2) << single / median << "x";
+        }
+        std::cout << std::defaultfloat << std::endl;
+    }
+}
+
+// Name of a tracker benchmark: "<tracker>_update[_luma]/<variant>" (KCF keeps its old names).
+std::string TrackerBenchName(const TrackerInfo& info, int channels, const std::string& variant) {
+    return std::string(info.name) + (channels == 1 ? "_update_luma/" : "_update/") + variant;
+}
+
+// Every registry entry in every input format it takes (3 = BGR, 1 = luma, as TrackerSettings),
+// updating on the synthetic clip.
+void BenchTrackers(BenchmarkRunner& runner, const BenchResolution& resolution, const std::vector<cv::Mat>& frames) {
+    if (frames.empty()) return;
+    // Same preprocessing as the tracking thread: downscale, then the tracker's format.
+    cv::Size display_size = ComputeDisplaySize(frames[0].size());
+    std::vector<cv::Mat> tracker_frames[2]; // [0] BGR, [1] luma, converted on first use
+    cv::Rect initial_bbox(display_size.width / 2 - 16, display_size.height / 2 - 16, 32, 32);
+
+    for (size_t index = 0; index < TrackerCount(); ++index) {
+        const TrackerInfo& info = TrackerInfoAt(index);
+        for (int channels : { 3, 1 }) {
+            if ((channels == 1 && !info.accepts_luma) || (channels == 3 && !info.accepts_bgr)) continue;
+            std::string name = TrackerBenchName(info, channels, resolution.label);
+            if (!runner.Enabled(name)) continue;
+
+            std::vector<cv::Mat>& clip = tracker_frames[channels == 1 ? 1 : 0];
+            if (clip.empty()) {
+                for (const cv::Mat& frame : frames) {
+                    cv::Mat display, converted;
+                    cv::resize(frame, display, display_size);
+                    cv::cvtColor(display, converted, channels == 1 ? cv::COLOR_BGRA2GRAY : cv::COLOR_BGRA2BGR);
+                    clip.push_back(converted);
+                }
+            }
+            std::unique_ptr<TargetTracker> tracker = CreateTracker(index, channels);
+            if (!tracker || !tracker->Init(clip[0], initial_bbox)) continue;
+            cv::Rect bbox = initial_bbox;
+            size_t next_frame = 1;
+            runner.Run(name, [&] {
+                bool ok = tracker->Update(clip[next_frame], bbox);
+                DoNotOptimize(ok);
+                if (++next_frame == clip.size()) {
+                    // Restart the clip from where the tracker was initialised so it never drifts off.
+                    next_frame = 1;
+                    bbox = initial_bbox;
+                    tracker->Init(clip[0], initial_bbox);
+                }
+            });
+        }
+    }
+}
+
+double IntersectionOverUnion(const cv::Rect& a, const cv::Rect& b) {
+    double intersection = (a & b).area();
+    double union_area = static_cast<double>(a.area()) + b.area() - intersection;
+    return union_area > 0.0 ? intersection / union_area : 0.0;
+}
+
+// A stretch of a recorded session where the live tracker ran: started on 'begin', active up to 'end' (exclusive).
+struct SessionTrack {
+    size_t begin;
+    size_t end;
+};
+
+std::vector<SessionTrack> FindSessionTracks(const std::vector<SessionFrame>& frames) {
+    std::vector<SessionTrack> tracks;
+    for (size_t i = 0; i < frames.size(); ++i) {
+        if (!frames[i].tracker_started || frames[i].tracked_bbox.area() <= 0) continue;
+        size_t end = i + 1;
+        while (end < frames.size() && frames[end].tracking_enabled && frames[end].tracker_active && !frames[end].tracker_started) ++end;
+        if (end - i > 1) tracks.push_back({ i, end });
+        i = end - 1;
+    }
+    return tracks;
+}
+
+// Every registry entry on the frames of a recorded session (--session): update
+// latency as "<tracker>_update[_luma]/session" benchmarks, plus agreement with the
+// track the live session recorded. That track is the reference, not ground truth:
+// a tracker that beats the recorded one still loses IoU where the two disagree.
+void BenchTrackersOnSession(BenchmarkRunner& runner, const std::string& path, size_t max_frames) {
+    std::vector<SessionFrame> frames;
+    if (!LoadSessionFrames(path, max_frames, frames)) return;
+    std::vector<SessionTrack> tracks = FindSessionTracks(frames);
+    if (tracks.empty()) { std::cerr << "No tracked stretch in '" << path << "' (" << frames.size() << " frames)." << std::endl; return; }
+    size_t tracked_frames = 0;
+    for (const SessionTrack& track : tracks) tracked_frames += track.end - track.begin - 1;
+    std::cout << "Session " << path << ": " << frames.size() << " frames, " << tracks.size() << " tracked stretch(es), "
+              << tracked_frames << " updates" << std::endl;
+    std::cout << "  tracker          input  median us  mean IoU  centre err px  lost" << std::endl;
+
+    std::vector<cv::Mat> luma;
+    for (size_t index = 0; index < TrackerCount(); ++index) {
+        const TrackerInfo& info = TrackerInfoAt(index);
+        for (int channels : { 3, 1 }) {
+            if ((channels == 1 && !info.accepts_luma) || (channels == 3 && !info.accepts_bgr)) continue;
+            if (channels == 1 && luma.empty()) {
+                luma.resize(frames.size());
+                for (size_t i = 0; i < frames.size(); ++i) cv::cvtColor(frames[i].bgr, luma[i], cv::COLOR_BGR2GRAY);
+            }
+            auto frame_at = [&](size_t i) -> const cv::Mat& { return channels == 1 ? luma[i] : frames[i].bgr; };
+            std::string name = TrackerBenchName(info, channels, "session");
+            if (!runner.Enabled(name)) continue;
+
+            // Accuracy: one pass over every stretch, re-initialised on the recorded start box like the live run.
+            std::vector<double> update_ns;
+            double iou_sum = 0.0, centre_error_sum = 0.0;
+            size_t matched = 0, lost = 0;
+            for (const SessionTrack& track : tracks) {
+                std::unique_ptr<TargetTracker> tracker = CreateTracker(index, channels);
+                if (!tracker || !tracker->Init(frame_at(track.begin), frames[track.begin].tracked_bbox)) { lost += track.end - track.begin - 1; continue; }
+                cv::Rect box = frames[track.begin].tracked_bbox;
+                for (size_t i = track.begin + 1; i < track.end; ++i) {
+                    int64_t start_ns = MonotonicNowNs();
+                    bool ok = tracker->Update(frame_at(i), box);
+                    update_ns.push_back(static_cast<double>(MonotonicNowNs() - start_ns));
+                    if (!ok) { ++lost; continue; }
+                    const cv::Rect& reference = frames[i].tracked_bbox;
+                    cv::Point2d centre(box.x + box.width / 2.0, box.y + box.height / 2.0);
+                    cv::Point2d reference_centre(reference.x + reference.width / 2.0, reference.y + reference.height / 2.0);
+                    iou_sum += IntersectionOverUnion(box, reference);
+                    centre_error_sum += std::hypot(centre.x - reference_centre.x, centre.y - reference_centre.y);
+                    ++matched;
+                }
+            }
+            double median_us = 0.0;
+            if (!update_ns.empty()) {
+                std::nth_element(update_ns.begin(), update_ns.begin() + update_ns.size() / 2, update_ns.end());
+                median_us = update_ns[update_ns.size() / 2] / 1e3;
+            }
+            std::cout << "  " << std::left << std::setw(16) << info.name << " " << std::setw(6) << (channels == 1 ? "luma" : "bgr")
+                      << std::right << std::fixed << std::setprecision(1) << std::setw(10) << median_us
+                      << std::setprecision(3) << std::setw(10) << (matched ? iou_sum / matched : 0.0)
+                      << std::setprecision(1) << std::setw(15) << (matched ? centre_error_sum / matched : 0.0)
+                      << std::setw(5) << std::setprecision(0) << (tracked_frames ? 100.0 * lost / tracked_frames : 0.0) << "%"
+                      << std::defaultfloat << std::endl;
+
+            // Latency for the JSON/baseline: cycle through the longest stretch.
+            const SessionTrack& longest = *std::max_element(tracks.begin(), tracks.end(),
+                [](const SessionTrack& a, const SessionTrack& b) { return a.end - a.begin < b.end - b.begin; });
+            std::unique_ptr<TargetTracker> tracker = CreateTracker(index, channels);
+            const cv::Rect start_box = frames[longest.begin].tracked_bbox;
+            if (!tracker || !tracker->Init(frame_at(longest.begin), start_box)) continue;
+            cv::Rect box = start_box;
+            size_t next_frame = longest.begin + 1;
+            runner.Run(name, [&] {
+                bool ok = tracker->Update(frame_at(next_frame), box);
+                DoNotOptimize(ok);
+                if (++next_frame == longest.end) {
+                    next_frame = longest.begin + 1;
+                    box = start_box;
+                    tracker->Init(frame_at(longest.begin), start_box);
+                }
+            });
+        }
+    }
+}
+
+void BenchOverlay(BenchmarkRunner& runner, const BenchResolution& resolution, const cv::Mat& bgra) {
+    cv::Size display_size = ComputeDisplaySize(bgra.size());
+    cv::Mat display;
+    cv::resize(bgra, display, display_size);
+
+    OverlayState overlay;
+    overlay.channels.ch1 = 120; overlay.channels.ch3 = -340; overlay.channels.ch8 = 1000;
+    overlay.pose.pitch = 0.1f; overlay.pose.roll = -0.05f; overlay.pose.yaw = 1.2f;
+    overlay.offset.dx = 12; overlay.offset.dy = -7; overlay.offset.is_valid = true;
+    overlay.tracker_active = true;
+    overlay.tracked_bbox = cv::Rect(display_size.width / 2 - 4, display_size.height / 2 - 23, 32, 32);
+    overlay.track_patch = display(cv::Rect(display_size.width / 2 - 16, display_size.height / 2 - 16, 32, 32)).clone();
+    for (int i = 0; i < PLOT_HISTORY_LENGTH; ++i) {
+        overlay.ch1_history.push_back(static_cast<long>(800 * std::sin(i * 0.05)));
+        overlay.ch3_history.push_back(static_cast<long>(600 * std::cos(i * 0.07)));
+    }
+    overlay.latency_lines.resize(static_cast<size_t>(LatencyStage::Count));
+    for (int stage = 0; stage < static_cast<int>(LatencyStage::Count); ++stage) {
+        overlay.latency_lines[stage].Assign(g_latency_stats.FormatLine(static_cast<LatencyStage>(stage)).c_str());
+    }
+    flag_track = 1; // DrawFrameInfo only draws the track patch and PID curves while tracking
+    last_fps_time_point = std::chrono::steady_clock::now();
+
+    cv::Mat canvas = display.clone();
+    FrameWorkspace workspace;
+    runner.Run("draw_frame_info/" + resolution.label, [&] {
+        workspace.arena.Reset();
+        DrawFrameInfo(canvas, overlay, workspace); // includes DrawPIDCurves, as in the preview
+    });
+    runner.Run("draw_pid_curves/" + resolution.label, [&] {
+        workspace.arena.Reset();
+        DrawPIDCurves(canvas, overlay, workspace);
+    });
+    flag_track = 0;
+}
+
+void BenchScalarKernels(BenchmarkRunner& runner) {
+    std::mt19937 rng(12345);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::vector<float> quaternions(SCALAR_BATCH * 4);
+    for (int i = 0; i < SCALAR_BATCH; ++i) {
+        float q[4] = { unit(rng), unit(rng), unit(rng), unit(rng) };
+        float norm = std::sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+        for (int k = 0; k < 4; ++k) quaternions[i * 4 + k] = q[k] / norm;
+    }
+    runner.Run("quaternion_to_euler", [&] {
+        float pitch = 0, yaw = 0, roll = 0, sum = 0;
+        for (int i = 0; i < SCALAR_BATCH; ++i) {
+            const float* q = &quaternions[i * 4];
+            QuaternionToEulerAngles_YUp_LeftHanded(q[0], q[1], q[2], q[3], pitch, yaw, roll);
+            sum += pitch + yaw + roll;
+        }
+        DoNotOptimize(sum);
+    }, SCALAR_BATCH);
+
+    std::uniform_int_distribution<long> axis(-1000, 1000);
+    std::vector<RemoteChannels> samples(SCALAR_BATCH);
+    for (RemoteChannels& sample : samples) {
+        sample.ch1 = axis(rng); sample.ch2 = axis(rng); sample.ch3 = axis(rng); sample.ch4 = axis(rng);
+    }
+    for (int mode = 0; mode <= 1; ++mode) {
+        runner.Run(mode == 0 ? "virtual_report_scaling/manual" : "virtual_report_scaling/ai", [&] {
+            flag_track = mode;
+            int sum = 0;
+            for (const RemoteChannels& sample : samples) {
+                g_joystickState = sample;
+                ai_joystickState = sample;
+                VirtualPadReport report = BuildVirtualReport();
+                sum += report.sThumbLX + report.sThumbRY;
+            }
+            DoNotOptimize(sum);
+        }, SCALAR_BATCH);
+    }
+    flag_track = 0;
+}
+
+bool ParseResolutions(const std::string& text, std::vector<BenchResolution>& out) {
+    out.clear();
+    std::stringstream stream(text);
+    std::string label;
+    while (std::getline(stream, label, ',')) {
+        bool found = false;
+        for (const BenchResolution& resolution : ALL_RESOLUTIONS) {
+            if (resolution.label == label) { out.push_back(resolution); found = true; }
+        }
+        if (!found) { std::cerr << "Unknown resolution '" << label << "' (expected 1080p, 1440p or 4k)." << std::endl; return false; }
+    }
+    return !out.empty();
+}
+
+void PrintUsage() {
+    std::cerr << "Usage: SimBenchmarks [--json OUT] [--baseline FILE] [--threshold PCT] [--filter SUBSTR]" << std::endl;
+    std::cerr << "                     [--resolutions 1080p,1440p,4k] [--min-sample-ms MS] [--samples N]" << std::endl;
+    std::cerr << "                     [--session LOG] [--session-frames N]" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    BenchmarkOptions options;
+    std::string json_path = "sim_benchmarks.json";
+    std::string baseline_path;
+    double threshold_percent = 10.0;
+    std::vector<BenchResolution> resolutions(std::begin(ALL_RESOLUTIONS), std::end(ALL_RESOLUTIONS));
+    std::string session_path;
+    size_t session_frames = SESSION_FRAME_LIMIT;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--json" && has_value) json_path = argv[++i];
+        else if (arg == "--baseline" && has_value) baseline_path = argv[++i];
+        else if (arg == "--threshold" && has_value) threshold_percent = std::atof(argv[++i]);
+        else if (arg == "--filter" && has_value) options.filter = argv[++i];
+        else if (arg == "--min-sample-ms" && has_value) options.min_sample_ms = std::atof(argv[++i]);
+        else if (arg == "--samples" && has_value) options.samples = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--session" && has_value) session_path = argv[++i];
+        else if (arg == "--session-frames" && has_value) session_frames = static_cast<size_t>(std::max(0, std::atoi(argv[++i])));
+        else if (arg == "--resolutions" && has_value) { if (!ParseResolutions(argv[++i], resolutions)) return 1; }
+        else { PrintUsage(); return 1; }
+    }
+
+    g_pid_debug_log = false;
+    cv::setNumThreads(1); // single-threaded numbers are comparable across machines and match the pipeline threads
+    BenchmarkRunner runner(options);
+
+    BenchScalarKernels(runner);
+    if (!session_path.empty()) BenchTrackersOnSession(runner, session_path, session_frames);
+    for (const BenchResolution& resolution : resolutions) {
+        std::vector<cv::Mat> frames = RenderSyntheticFrames(resolution, TRACKER_FRAME_COUNT);
+        if (frames.empty()) { std::cerr << "Failed to render synthetic frames at " << resolution.label << "." << std::endl; return 1; }
+        BenchCaptureKernels(runner, resolution, frames[0]);
+        BenchDownscaleKernels(runner, resolution, frames[0]);
+        BenchParallelDownscale(runner, resolution, frames[0]);
+        BenchPyramid(runner, resolution, frames[0]);
+        BenchTrackers(runner, resolution, frames);
+        BenchOverlay(runner, resolution, frames[0]);
+    }
+
+    if (!json_path.empty() && WriteBenchmarkJson(json_path, runner.Results())) {
+        std::cout << "Results written to " << json_path << std::endl;
+    }
+    if (!baseline_path.empty()) {
+        std::vector<BenchmarkResult> baseline;
+        if (!ReadBenchmarkJson(baseline_path, baseline)) return 1;
+        int regressions = CompareWithBaseline(runner.Results(), baseline, threshold_percent);
+        std::cout << regressions << " regression(s)." << std::endl;
+        return regressions;
+    }
+    return 0;
+}
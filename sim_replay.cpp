@@ -0,0 +1,64 @@
+// SimReplay: re-runs a session recorded with `JoystickReaderApp --record PATH`
+// through the tracker, PID and pad mapping, without DXGI, DirectInput or ViGEm.
+//
+//   SimReplay LOG [--realtime] [--repeat N] [--verbose] [--tracker NAME] [--acquire saliency|centre] [--redetect on|off] [--estimator on|off]
+//
+// --tracker runs another registry entry on the recorded frames instead of the
+// one the session used; the tracker mismatch count then shows how far it drifts
+// from the recorded track. --acquire, --redetect and --estimator must match the
+// session's settings (defaults as in the app).
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "control.h"
+#include "session_replay.h"
+#include "target_acquisition.h"
+#include "target_recovery.h"
+
+int main(int argc, char** argv) {
+    std::string log_path;
+    ReplayOptions options;
+    int repeat = 1;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--realtime") {
+            options.realtime = true;
+        } else if (arg == "--verbose") {
+            options.verbose = true;
+        } else if (arg == "--tracker" && i + 1 < argc) {
+            options.tracker = argv[++i];
+        } else if (arg == "--acquire" && i + 1 < argc && (std::string(argv[i + 1]) == "saliency" || std::string(argv[i + 1]) == "centre")) {
+            g_acquisition_settings.enabled = std::string(argv[++i]) == "saliency";
+        } else if (arg == "--redetect" && i + 1 < argc && (std::string(argv[i + 1]) == "on" || std::string(argv[i + 1]) == "off")) {
+            g_recovery_settings.enabled = std::string(argv[++i]) == "on";
+        } else if (arg == "--estimator" && i + 1 < argc && (std::string(argv[i + 1]) == "on" || std::string(argv[i + 1]) == "off")) {
+            g_estimator_settings.enabled = std::string(argv[++i]) == "on";
+        } else if (arg == "--repeat" && i + 1 < argc) {
+            repeat = std::max(1, std::atoi(argv[++i]));
+        } else if (!arg.empty() && arg[0] != '-' && log_path.empty()) {
+            log_path = arg;
+        } else {
+            std::cerr << "Usage: SimReplay LOG [--realtime] [--repeat N] [--verbose] [--tracker NAME] [--acquire saliency|centre] [--redetect on|off] [--estimator on|off]" << std::endl;
+            return 1;
+        }
+    }
+    if (log_path.empty()) {
+        std::cerr << "Usage: SimReplay LOG [--realtime] [--repeat N] [--verbose] [--tracker NAME] [--acquire saliency|centre] [--redetect on|off] [--estimator on|off]" << std::endl;
+        return 1;
+    }
+
+    g_pid_debug_log = false; // the per-measurement PID trace would dominate an as-fast-as-possible run
+
+    bool deterministic = true;
+    for (int run = 0; run < repeat; ++run) {
+        ReplayStats stats;
+        if (!ReplaySession(log_path, options, stats)) return 1;
+        if (repeat > 1) std::cout << "Run " << (run + 1) << "/" << repeat << ":" << std::endl;
+        PrintReplayStats(stats);
+        if (stats.tracker_mismatches != 0 || stats.report_mismatches != 0) deterministic = false;
+    }
+    return deterministic ? 0 : 2;
+}
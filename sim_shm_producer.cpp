@@ -0,0 +1,128 @@
+// SimShmProducer: stands in for the simulator's shared-memory output, so the
+// shm frame source can be exercised without it (e.g. on Linux). Renders the
+// synthetic moving target, or a video file, straight into a named frame ring.
+//
+//   SimShmProducer [--name NAME] [--source synthetic|video] [--video PATH]
+//                  [--size WxH] [--fps HZ] [--slots N] [--frames N]
+//
+//   JoystickReaderApp --shm NAME    consumes it
+
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "frame_source.h"
+#include "shm_ring.h"
+
+namespace {
+
+const int PRODUCER_GRAB_TIMEOUT_MS = 100;
+const int64_t PRODUCER_STATS_INTERVAL_NS = 5000000000LL;
+
+volatile std::sig_atomic_t g_stop_requested = 0;
+
+void RequestStop(int) { g_stop_requested = 1; }
+
+void PrintUsage() {
+    std::cerr << "Usage: SimShmProducer [--name NAME] [--source synthetic|video] [--video PATH]" << std::endl;
+    std::cerr << "                      [--size WxH] [--fps HZ] [--slots N] [--frames N]" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    FrameSourceConfig config;
+    config.type = FrameSourceType::Synthetic;
+    int slot_count = 6;             // consumer holds up to ~3 (capture queue + tracker); the rest keep the producer from dropping
+    long long frame_limit = 0;      // 0 = until Ctrl+C
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--name" && has_value) {
+            config.shm_name = argv[++i];
+        } else if (arg == "--source" && has_value) {
+            if (!ParseFrameSourceType(argv[++i], config.type)
+                || (config.type != FrameSourceType::Synthetic && config.type != FrameSourceType::VideoFile)) {
+                std::cerr << "--source must be synthetic or video." << std::endl;
+                return 1;
+            }
+        } else if (arg == "--video" && has_value) {
+            config.type = FrameSourceType::VideoFile;
+            config.video_path = argv[++i];
+        } else if (arg == "--size" && has_value) {
+            if (sscanf(argv[++i], "%dx%d", &config.synthetic_width, &config.synthetic_height) != 2) {
+                std::cerr << "Expected WIDTHxHEIGHT for --size." << std::endl;
+                return 1;
+            }
+        } else if (arg == "--fps" && has_value) {
+            config.synthetic_fps = std::atof(argv[++i]);
+        } else if (arg == "--slots" && has_value) {
+            slot_count = std::atoi(argv[++i]);
+            if (slot_count < 2 || slot_count > SHM_RING_MAX_SLOTS) {
+                std::cerr << "--slots must be between 2 and " << SHM_RING_MAX_SLOTS << "." << std::endl;
+                return 1;
+            }
+        } else if (arg == "--frames" && has_value) {
+            frame_limit = std::atoll(argv[++i]);
+        } else {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    std::unique_ptr<FrameSource> source = CreateFrameSource(config);
+    if (!source || !source->Open()) return 1;
+    // The ring's geometry is fixed at creation; a video's size is only known once the first frame is decoded.
+    cv::Mat first_frame;
+    FrameInfo info;
+    while (!source->Grab(first_frame, info, PRODUCER_GRAB_TIMEOUT_MS, 0)) {
+        if (config.type == FrameSourceType::VideoFile) { std::cerr << "No frames in '" << config.video_path << "'." << std::endl; return 1; }
+    }
+    cv::Size size = source->FrameSize();
+
+    std::unique_ptr<ShmRing> ring = ShmRing::Create(config.shm_name, size.width, size.height, slot_count);
+    if (!ring) return 1;
+    std::signal(SIGINT, RequestStop);
+    std::signal(SIGTERM, RequestStop);
+    std::cout << "Publishing " << FrameSourceTypeName(config.type) << " frames (" << size.width << "x" << size.height << ") to ring '"
+              << config.shm_name << "' with " << slot_count << " slots. Ctrl+C to stop." << std::endl;
+
+    // Slots keep their pixels between writes, so only the tiles the source changed
+    // since the frame a slot last held get copied into it.
+    std::vector<uint64_t> slot_content(slot_count, 0);
+    uint64_t published = 0;
+    uint64_t dropped = 0;
+    int64_t next_stats_ns = MonotonicNowNs() + PRODUCER_STATS_INTERVAL_NS;
+    while (!g_stop_requested && (frame_limit <= 0 || static_cast<long long>(published) < frame_limit)) {
+        int slot = ring->BeginWrite();
+        if (slot < 0) {
+            // Every other slot is leased: consume the source frame anyway so its pacing holds.
+            if (source->Grab(first_frame, info, PRODUCER_GRAB_TIMEOUT_MS, 0)) ++dropped;
+        } else {
+            cv::Mat target(size.height, size.width, CV_8UC4, ring->SlotPixels(slot), ring->Pitch());
+            if (source->Grab(target, info, PRODUCER_GRAB_TIMEOUT_MS, slot_content[slot])) {
+                if (target.data != ring->SlotPixels(slot)) { // source changed size: the ring cannot follow
+                    std::cerr << "Source frame size changed; stopping." << std::endl;
+                    break;
+                }
+                slot_content[slot] = info.sequence;
+                ring->Publish(slot, info.sequence, info.generation, info.timestamp_ns);
+                ++published;
+            } // else: pixels untouched, the slot just stays empty until the next write
+        }
+
+        int64_t now_ns = MonotonicNowNs();
+        if (now_ns >= next_stats_ns) {
+            std::cout << "published " << published << ", dropped (all slots leased) " << dropped << std::endl;
+            next_stats_ns = now_ns + PRODUCER_STATS_INTERVAL_NS;
+        }
+    }
+    std::cout << "Stopped after " << published << " frames (" << dropped << " dropped)." << std::endl;
+    return 0;
+}
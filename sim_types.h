@@ -0,0 +1,54 @@
+#pragma once
+
+// Plain data shared by the Windows app (main.cpp) and the portable modules
+// (tracking, control, session log / replay). No Windows or ViGEm headers here.
+
+#include <cstdint>
+
+#ifndef M_PI
+    #define M_PI 3.14159265358979323846
+#endif
+
+// --- RemoteChannels struct ---
+struct RemoteChannels {
+    long ch1, ch2, ch3, ch4; bool ch5; long ch6, ch7, ch8, ch9; bool ch10;
+    RemoteChannels() : ch1(0), ch2(0), ch3(0), ch4(0), ch5(false), ch6(0), ch7(0), ch8(0), ch9(0), ch10(false) {}
+};
+
+struct TrackingOffset {
+    // 跟踪目标中心相对画面中心的偏移，单位是显示像素 (DISPLAY_WIDTH 宽的画面)，但带小数：
+    // 跟踪器的亚像素峰值 / 原生分辨率 (--capture-roi) 的精度都保留下来，不取整
+    float dx; // 水平偏移量 (x-direction)
+    float dy; // 垂直偏移量 (y-direction)
+    int width;  // 跟踪框尺寸 (显示像素)，供目标状态估计器估计尺度
+    int height;
+    bool is_valid; // 标记当前偏移量是否有效 (例如，跟踪成功时为true)
+
+    TrackingOffset() : dx(0.0f), dy(0.0f), width(0), height(0), is_valid(false) {} // 默认构造函数
+};
+
+struct DronePose {
+    float timestamp;
+    float pitch; // 俯仰角 (绕X轴旋转，通常)
+    float roll;  // 横滚角 (绕Y轴旋转，通常)
+    float yaw;   // 偏航角 (绕Z轴旋转，通常)
+    // 注意：轴的定义和旋转顺序可能因系统而异，您可能需要根据实际数据调整
+
+    DronePose() : timestamp(0.0f), pitch(0.0f), roll(0.0f), yaw(0.0f) {}
+};
+
+// Portable mirror of ViGEm's XUSB_REPORT (same field order and widths), so the
+// control code and the session log do not need the ViGEm headers.
+struct VirtualPadReport {
+    uint16_t wButtons;
+    uint8_t  bLeftTrigger;
+    uint8_t  bRightTrigger;
+    int16_t  sThumbLX;
+    int16_t  sThumbLY;
+    int16_t  sThumbRX;
+    int16_t  sThumbRY;
+
+    VirtualPadReport() : wButtons(0), bLeftTrigger(0), bRightTrigger(0), sThumbLX(0), sThumbLY(0), sThumbRX(0), sThumbRY(0) {}
+};
+
+const int DISPLAY_WIDTH = 800; // 跟踪/预览使用的缩放宽度
@@ -0,0 +1,170 @@
+#pragma once
+
+// Bounded lock-free single-producer / single-consumer ring used to hand frames
+// and measurements between the capture, tracking, control and preview threads,
+// and LatestMailbox, its overwrite-the-oldest counterpart for hand-overs where
+// the consumer is routinely slower than the producer.
+//
+// The data path (TryPush / PopLatest / TryPop) never takes a lock. The mutex and
+// condition variable only exist so that a consumer can sleep in WaitForData()
+// instead of spinning; the producer touches them after publishing an item.
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+
+template <typename T, size_t Capacity>
+class SpscQueue {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "SpscQueue capacity must be a power of two");
+
+public:
+    SpscQueue() = default;
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    // Producer side. Returns false and drops the *new* item when the consumer is a
+    // full ring behind, so the ring keeps the oldest items. Fine where the consumer
+    // normally keeps up (control, preview); a consumer that is slower than the
+    // producer on every item wants LatestMailbox instead.
+    bool TryPush(T item) {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        const size_t tail = m_tail.load(std::memory_order_acquire);
+        if (head - tail >= Capacity) {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        m_slots[head & kMask] = std::move(item);
+        m_head.store(head + 1, std::memory_order_release);
+
+        // Empty critical section orders the publish against a consumer that is
+        // between checking the predicate and going to sleep (no lost wakeups).
+        { std::lock_guard<std::mutex> lock(m_wait_mutex); }
+        m_wait_cv.notify_one();
+        return true;
+    }
+
+    // Consumer side: pop the oldest item.
+    bool TryPop(T& out) {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        const size_t head = m_head.load(std::memory_order_acquire);
+        if (head == tail) return false;
+        out = std::move(m_slots[tail & kMask]);
+        m_slots[tail & kMask] = T();
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side: take the newest item and discard everything older
+    // ("latest frame wins"). Skipped items are released immediately so pooled
+    // buffers they reference go back to the producer.
+    bool PopLatest(T& out) {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        const size_t head = m_head.load(std::memory_order_acquire);
+        if (head == tail) return false;
+        for (size_t i = tail; i + 1 < head; ++i) {
+            m_slots[i & kMask] = T();
+        }
+        out = std::move(m_slots[(head - 1) & kMask]);
+        m_slots[(head - 1) & kMask] = T();
+        m_skipped.fetch_add(head - tail - 1, std::memory_order_relaxed);
+        m_tail.store(head, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side: block until at least one item is available or the timeout expires.
+    template <typename Rep, typename Period>
+    bool WaitForData(const std::chrono::duration<Rep, Period>& timeout) {
+        if (!Empty()) return true;
+        std::unique_lock<std::mutex> lock(m_wait_mutex);
+        return m_wait_cv.wait_for(lock, timeout, [this] { return !Empty(); });
+    }
+
+    bool Empty() const {
+        return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+    }
+
+    uint64_t DroppedCount() const { return m_dropped.load(std::memory_order_relaxed); }
+    uint64_t SkippedCount() const { return m_skipped.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr size_t kMask = Capacity - 1;
+
+    alignas(64) std::atomic<size_t> m_head{0}; // written by producer only
+    alignas(64) std::atomic<size_t> m_tail{0}; // written by consumer only
+    std::array<T, Capacity> m_slots{};
+
+    std::atomic<uint64_t> m_dropped{0};
+    std::atomic<uint64_t> m_skipped{0};
+
+    std::mutex m_wait_mutex;
+    std::condition_variable m_wait_cv;
+};
+
+// Single-slot "latest wins" hand-over: a triple buffer. The producer fills its
+// back slot and swaps it with the middle one; the consumer swaps its front slot
+// with the middle one when that holds an item it has not taken yet. A push never
+// fails: an item still unconsumed in the middle is evicted (counted as skipped,
+// released right away so pooled buffers go back to the producer), so PopLatest
+// always gets the newest item no matter how far behind the consumer runs.
+template <typename T>
+class LatestMailbox {
+public:
+    LatestMailbox() = default;
+    LatestMailbox(const LatestMailbox&) = delete;
+    LatestMailbox& operator=(const LatestMailbox&) = delete;
+
+    // Producer side. Always succeeds; returns true to match SpscQueue::TryPush.
+    bool TryPush(T item) {
+        m_slots[m_back] = std::move(item);
+        uint8_t previous = m_middle.exchange(static_cast<uint8_t>(m_back | kFresh), std::memory_order_acq_rel);
+        m_back = previous & kIndexMask;
+        if (previous & kFresh) {
+            m_slots[m_back] = T(); // the consumer never saw it
+            m_skipped.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        { std::lock_guard<std::mutex> lock(m_wait_mutex); }
+        m_wait_cv.notify_one();
+        return true;
+    }
+
+    // Consumer side: take the newest item, if one arrived since the last call.
+    bool PopLatest(T& out) {
+        if (Empty()) return false; // only this side clears kFresh, so it is still set below
+        uint8_t previous = m_middle.exchange(m_front, std::memory_order_acq_rel);
+        m_front = previous & kIndexMask;
+        out = std::move(m_slots[m_front]);
+        m_slots[m_front] = T();
+        return true;
+    }
+
+    template <typename Rep, typename Period>
+    bool WaitForData(const std::chrono::duration<Rep, Period>& timeout) {
+        if (!Empty()) return true;
+        std::unique_lock<std::mutex> lock(m_wait_mutex);
+        return m_wait_cv.wait_for(lock, timeout, [this] { return !Empty(); });
+    }
+
+    bool Empty() const { return (m_middle.load(std::memory_order_acquire) & kFresh) == 0; }
+
+    uint64_t DroppedCount() const { return 0; }
+    uint64_t SkippedCount() const { return m_skipped.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr uint8_t kIndexMask = 3;
+    static constexpr uint8_t kFresh = 4;     // middle slot holds an item the consumer has not taken
+
+    std::array<T, 3> m_slots{};
+    alignas(64) uint8_t m_back = 0;          // producer only
+    alignas(64) uint8_t m_front = 1;         // consumer only
+    alignas(64) std::atomic<uint8_t> m_middle{2};
+    std::atomic<uint64_t> m_skipped{0};
+
+    std::mutex m_wait_mutex;
+    std::condition_variable m_wait_cv;
+};
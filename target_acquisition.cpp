@@ -0,0 +1,142 @@
+#include "target_acquisition.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+
+#include <opencv2/imgproc.hpp>
+
+#include "frame_source.h"
+
+AcquisitionSettings g_acquisition_settings;
+
+namespace {
+
+const int CENTRE_BOX_SIDE = 32;             // display px, the fallback (and the old fixed box)
+const int MIN_BOX_SIDE = 10;                // frame px, smaller boxes are not worth tracking
+const int MAP_SIZE = 64;                    // saliency map side; the region is resampled to it
+const double MIN_REGION_STDDEV = 4.0;       // grey levels; flatter regions have nothing to find
+const double SALIENCY_BLUR_SIGMA = 2.5;     // map px
+const double AREA_EXPONENT = 0.15;          // score *= (box area / 8x8 map px)^this
+const double PRIOR_SIGMA_FRACTION = 0.25;   // centre prior sigma / region side
+const double MIN_RING_FRACTION = 0.25;      // ring clipped by the map edge to less than this of the box: skip
+
+// Candidate shapes, display px (side of the square of equal area) and width / height.
+const int BOX_SIDES[] = { 16, 24, 32, 48, 64 };
+const double BOX_ASPECTS[] = { 1.0, 1.5, 1.0 / 1.5 };
+
+cv::Rect CentreBox(const cv::Mat& frame, double display_scale) {
+    int side = std::max(1, cvRound(CENTRE_BOX_SIDE * display_scale));
+    return cv::Rect(frame.cols / 2 - side / 2, frame.rows / 2 - side / 2, side, side) & cv::Rect(0, 0, frame.cols, frame.rows);
+}
+
+// Spectral residual of a grey CV_32F image -> saliency, scaled to a maximum of 1.
+void SpectralResidual(const cv::Mat& grey, cv::Mat& saliency) {
+    cv::Mat spectrum, planes[2], magnitude, phase, log_amplitude, smoothed;
+    cv::dft(grey, spectrum, cv::DFT_COMPLEX_OUTPUT);
+    cv::split(spectrum, planes);
+    cv::cartToPolar(planes[0], planes[1], magnitude, phase);
+    cv::max(magnitude, 1e-6, magnitude);
+    cv::log(magnitude, log_amplitude);
+    cv::blur(log_amplitude, smoothed, cv::Size(3, 3));
+    cv::subtract(log_amplitude, smoothed, log_amplitude);
+    cv::exp(log_amplitude, magnitude);
+    cv::polarToCart(magnitude, phase, planes[0], planes[1]);
+    cv::merge(planes, 2, spectrum);
+    cv::dft(spectrum, spectrum, cv::DFT_INVERSE | cv::DFT_SCALE);
+    cv::split(spectrum, planes);
+    cv::magnitude(planes[0], planes[1], saliency);
+    cv::multiply(saliency, saliency, saliency);
+    cv::GaussianBlur(saliency, saliency, cv::Size(), SALIENCY_BLUR_SIGMA);
+    double max_value = 0.0;
+    cv::minMaxLoc(saliency, nullptr, &max_value);
+    if (max_value > 0.0) saliency.convertTo(saliency, CV_32F, 1.0 / max_value);
+}
+
+// Sum of the integral image's source over [x0, x1) x [y0, y1).
+double BoxSum(const cv::Mat& integral, int x0, int y0, int x1, int y1) {
+    return integral.at<double>(y1, x1) - integral.at<double>(y0, x1) - integral.at<double>(y1, x0) + integral.at<double>(y0, x0);
+}
+
+} // namespace
+
+AcquisitionResult AcquireTarget(const cv::Mat& frame, double display_scale) {
+    AcquisitionResult result;
+    if (frame.empty()) return result;
+    result.box = CentreBox(frame, display_scale);
+    if (std::min(result.box.width, result.box.height) < MIN_BOX_SIDE) result.box = cv::Rect();
+    if (!g_acquisition_settings.enabled) return result;
+
+    int64_t start_ns = MonotonicNowNs();
+    double centre_x = frame.cols / 2.0, centre_y = frame.rows / 2.0;
+    int region_side = cvRound(g_acquisition_settings.region * display_scale);
+    cv::Rect region = cv::Rect(cvRound(centre_x) - region_side / 2, cvRound(centre_y) - region_side / 2, region_side, region_side)
+                      & cv::Rect(0, 0, frame.cols, frame.rows);
+    double map_scale = static_cast<double>(MAP_SIZE) / std::max(region.width, region.height); // map px per frame px
+    cv::Size map_size(cvRound(region.width * map_scale), cvRound(region.height * map_scale));
+    if (map_size.width < MAP_SIZE / 4 || map_size.height < MAP_SIZE / 4) return result;
+
+    cv::Mat grey, small, map;
+    if (frame.channels() == 4) cv::cvtColor(frame(region), grey, cv::COLOR_BGRA2GRAY);
+    else if (frame.channels() == 3) cv::cvtColor(frame(region), grey, cv::COLOR_BGR2GRAY);
+    else grey = frame(region);
+    cv::resize(grey, small, map_size, 0.0, 0.0, cv::INTER_AREA);
+    cv::Scalar mean, stddev;
+    cv::meanStdDev(small, mean, stddev);
+    if (stddev[0] < MIN_REGION_STDDEV) return result;
+    small.convertTo(map, CV_32F);
+    cv::Mat saliency, integral;
+    SpectralResidual(map, saliency);
+    cv::integral(saliency, integral, CV_64F);
+
+    double prior_sigma = g_acquisition_settings.region * PRIOR_SIGMA_FRACTION;     // display px
+    double best_score = 0.0;
+    cv::Rect2d best_box;
+    for (int side : BOX_SIDES) {
+        for (double aspect : BOX_ASPECTS) {
+            double box_width = side * std::sqrt(aspect) * display_scale;            // frame px
+            double box_height = side / std::sqrt(aspect) * display_scale;
+            int w = std::max(2, cvRound(box_width * map_scale));
+            int h = std::max(2, cvRound(box_height * map_scale));
+            if (w > map_size.width || h > map_size.height) continue;
+            double size_weight = std::pow(w * h / 64.0, AREA_EXPONENT);
+            for (int y = 0; y + h <= map_size.height; ++y) {
+                for (int x = 0; x + w <= map_size.width; ++x) {
+                    int ring_x0 = std::max(0, x - w / 2), ring_y0 = std::max(0, y - h / 2);
+                    int ring_x1 = std::min(map_size.width, x + w + w / 2), ring_y1 = std::min(map_size.height, y + h + h / 2);
+                    int ring_area = (ring_x1 - ring_x0) * (ring_y1 - ring_y0) - w * h;
+                    if (ring_area < MIN_RING_FRACTION * w * h) continue;
+                    double inside = BoxSum(integral, x, y, x + w, y + h);
+                    double ring = BoxSum(integral, ring_x0, ring_y0, ring_x1, ring_y1) - inside;
+                    double contrast = inside / (w * h) - ring / ring_area;
+                    // Box centre relative to the crosshair, display px.
+                    double dx = (region.x + (x + w / 2.0) / map_scale - centre_x) / display_scale;
+                    double dy = (region.y + (y + h / 2.0) / map_scale - centre_y) / display_scale;
+                    double score = contrast * std::exp(-(dx * dx + dy * dy) / (2.0 * prior_sigma * prior_sigma)) * size_weight;
+                    if (score <= best_score) continue;
+                    best_score = score;
+                    best_box = cv::Rect2d(region.x + (x + w / 2.0) / map_scale - box_width / 2.0,
+                                          region.y + (y + h / 2.0) / map_scale - box_height / 2.0, box_width, box_height);
+                }
+            }
+        }
+    }
+
+    cv::Rect box = cv::Rect(cvRound(best_box.x), cvRound(best_box.y), cvRound(best_box.width), cvRound(best_box.height))
+                   & cv::Rect(0, 0, frame.cols, frame.rows);
+    double elapsed_ms = (MonotonicNowNs() - start_ns) / 1e6;
+    if (best_score < g_acquisition_settings.min_score || std::min(box.width, box.height) < MIN_BOX_SIDE) {
+        std::cout << "No salient target near the crosshair (best " << best_score << ", " << elapsed_ms
+                  << " ms), using the centre box." << std::endl;
+        return result;
+    }
+    result.box = box;
+    result.score = best_score;
+    result.salient = true;
+    std::cout << "Target acquired: " << box.width << "x" << box.height << " at ("
+              << cvRound((box.x + box.width / 2.0 - centre_x) / display_scale) << ", "
+              << cvRound((box.y + box.height / 2.0 - centre_y) / display_scale) << ") display px from the crosshair, score "
+              << best_score << " (" << elapsed_ms << " ms)." << std::endl;
+    return result;
+}
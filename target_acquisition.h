@@ -0,0 +1,37 @@
+#pragma once
+
+// Picks the box the tracker starts on instead of a fixed 32x32 square under the
+// crosshair. A square region around the crosshair is reduced to a MAP_SIZE grey
+// map and its spectral-residual saliency computed (Hou & Zhang: the log amplitude
+// spectrum minus its local average, transformed back with the original phase,
+// squared and blurred; what is left is whatever does not look like the rest of
+// the region). Candidate boxes of several sizes and aspect ratios are then scored
+// at every map position by centre-surround contrast of the saliency (box mean
+// minus the mean of a ring half a box wide, both from an integral image), with a
+// Gaussian prior on the distance from the crosshair and a mild preference for the
+// larger of two boxes that contain the same object. The best box wins if it
+// scores min_score; otherwise (flat sky, uniform texture) the old centre box is
+// used. Pure image computation on one frame, well under a millisecond, so a live
+// run and its replay start on the same box.
+
+#include <opencv2/core.hpp>
+
+struct AcquisitionSettings {
+    bool enabled = true;        // false: fixed 32x32 box under the crosshair (--acquire centre)
+    int region = 128;           // side of the square searched around the crosshair, display px
+    double min_score = 0.2;     // saliency contrast the best box must reach (noise scores about 0.15)
+};
+
+// Read by the tracking thread when it seeds a tracker (--acquire, --acquire-region, --acquire-score).
+extern AcquisitionSettings g_acquisition_settings;
+
+struct AcquisitionResult {
+    cv::Rect box;               // frame px; empty if the frame is too small for any box
+    double score = 0.0;         // saliency contrast of 'box', 0 for the centre box
+    bool salient = false;       // false: 'box' is the fixed centre box
+};
+
+// Box to start the tracker on in 'frame' (1, 3 or 4 channels), whose centre is the
+// crosshair. 'display_scale' is frame px per display px (1 on the display path),
+// so box sizes and the region mean the same on native pixels.
+AcquisitionResult AcquireTarget(const cv::Mat& frame, double display_scale);
@@ -0,0 +1,55 @@
+#include "target_estimator.h"
+
+#include <algorithm>
+
+EstimatorSettings g_estimator_settings;
+
+namespace {
+
+// Spread of a new track's velocity / acceleration before any measurement says otherwise.
+const double INITIAL_VELOCITY_SIGMA = 1000.0;       // px/s
+const double INITIAL_ACCELERATION_SIGMA = 10000.0;  // px/s^2
+
+} // namespace
+
+void TargetEstimator::Update(double x, double y, double scale, int64_t timestamp_ns) {
+    double r = g_estimator_settings.measurement_sigma * g_estimator_settings.measurement_sigma;
+    double dt = (timestamp_ns - m_time_ns) / 1e9;
+    if (m_has_track && dt <= 0.0) return;
+    if (!m_has_track || dt > g_estimator_settings.max_coast_s) {
+        const double position_variance[3] = { r, INITIAL_VELOCITY_SIGMA * INITIAL_VELOCITY_SIGMA,
+                                              INITIAL_ACCELERATION_SIGMA * INITIAL_ACCELERATION_SIGMA };
+        const double scale_variance[2] = { r, INITIAL_VELOCITY_SIGMA * INITIAL_VELOCITY_SIGMA };
+        m_x.Init(x, position_variance);
+        m_y.Init(y, position_variance);
+        m_scale.Init(scale, scale_variance);
+    } else {
+        m_x.Predict(dt, g_estimator_settings.jerk_density);
+        m_y.Predict(dt, g_estimator_settings.jerk_density);
+        m_scale.Predict(dt, g_estimator_settings.scale_accel_density);
+        m_x.Correct(x, r);
+        m_y.Correct(y, r);
+        m_scale.Correct(scale, r);
+    }
+    m_time_ns = timestamp_ns;
+    m_has_track = true;
+}
+
+bool TargetEstimator::Estimate(int64_t time_ns, TargetEstimate& out) const {
+    if (!m_has_track) return false;
+    double dt = std::max(0.0, (time_ns - m_time_ns) / 1e9);
+    bool holding = dt > g_estimator_settings.max_coast_s;
+    double x[3], y[3], scale[2];
+    m_x.Extrapolate(holding ? 0.0 : dt, x);
+    m_y.Extrapolate(holding ? 0.0 : dt, y);
+    m_scale.Extrapolate(holding ? 0.0 : dt, scale);
+    if (holding) {
+        x[1] = x[2] = 0.0;
+        y[1] = y[2] = 0.0;
+        scale[1] = 0.0;
+    }
+    out.x = x[0]; out.vx = x[1]; out.ax = x[2];
+    out.y = y[0]; out.vy = y[1]; out.ay = y[2];
+    out.scale = scale[0]; out.scale_rate = scale[1];
+    return true;
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+// Kalman estimate of the target between the tracker and the PID. Tracker
+// measurements (box centre offset from the frame centre and box size, display
+// pixels) come in at the tracker's rate, stamped with their frame's capture
+// time; the control thread asks for the state at its own tick time and gets it
+// extrapolated forward, which covers the capture -> track -> control latency and
+// moves the error between measurements. x and y are constant-acceleration
+// models (position, velocity, acceleration; white jerk), the box scale
+// (sqrt(area)) a constant-velocity one. Axes are filtered independently: every
+// measurement is a position only, with the same noise on both axes.
+//
+// Control-thread only; nothing here allocates.
+
+#include <cstdint>
+
+struct EstimatorSettings {
+    bool enabled = true;                    // false: the PID uses the raw offset and a finite-difference derivative
+    double measurement_sigma = 1.0;         // tracker jitter, px
+    double jerk_density = 3.0e7;            // position process noise, px^2/s^5 (manoeuvring target plus camera motion)
+    double scale_accel_density = 1.0e4;     // scale process noise, px^2/s^3
+    double max_coast_s = 0.1;               // extrapolate this long past the last measurement, then hold the last position
+};
+
+// Read on the control thread (--estimator, --estimator-coast).
+extern EstimatorSettings g_estimator_settings;
+
+struct TargetEstimate {
+    double x = 0.0, y = 0.0;                // offset from the frame centre, px
+    double vx = 0.0, vy = 0.0;              // px/s
+    double ax = 0.0, ay = 0.0;              // px/s^2
+    double scale = 0.0;                     // sqrt(box area), px
+    double scale_rate = 0.0;                // px/s
+};
+
+// One kinematic axis: N = 2 (position, velocity) or 3 (+ acceleration), driven by
+// white noise of spectral density q in the next derivative, measured in position.
+template <int N>
+class KinematicFilter {
+public:
+    void Init(double position, const double (&variance)[N]) {
+        for (int i = 0; i < N; ++i) {
+            m_x[i] = i == 0 ? position : 0.0;
+            for (int j = 0; j < N; ++j) m_p[i][j] = i == j ? variance[i] : 0.0;
+        }
+    }
+
+    // x = F x, P = F P F' + Q.
+    void Predict(double dt, double q) {
+        double f[N][N], fp[N][N];
+        Transition(dt, f);
+        double x[N];
+        for (int i = 0; i < N; ++i) {
+            x[i] = 0.0;
+            for (int k = i; k < N; ++k) x[i] += f[i][k] * m_x[k];
+        }
+        for (int i = 0; i < N; ++i) {
+            m_x[i] = x[i];
+            for (int j = 0; j < N; ++j) {
+                fp[i][j] = 0.0;
+                for (int k = i; k < N; ++k) fp[i][j] += f[i][k] * m_p[k][j];
+            }
+        }
+        for (int i = 0; i < N; ++i) {
+            for (int j = 0; j < N; ++j) {
+                double sum = 0.0;
+                for (int k = j; k < N; ++k) sum += fp[i][k] * f[j][k];
+                // Q_ij = q dt^m / ((N-1-i)! (N-1-j)! m), m = 2N-1-i-j (white noise in the N-th derivative).
+                int m = 2 * N - 1 - i - j;
+                m_p[i][j] = sum + q * Power(dt, m) / (Factorial(N - 1 - i) * Factorial(N - 1 - j) * m);
+            }
+        }
+    }
+
+    // Position measurement z with variance r.
+    void Correct(double z, double r) {
+        double s = m_p[0][0] + r;
+        double gain[N], row0[N];
+        for (int i = 0; i < N; ++i) { gain[i] = m_p[i][0] / s; row0[i] = m_p[0][i]; }
+        double innovation = z - m_x[0];
+        for (int i = 0; i < N; ++i) {
+            m_x[i] += gain[i] * innovation;
+            for (int j = 0; j < N; ++j) m_p[i][j] -= gain[i] * row0[j];
+        }
+    }
+
+    // State dt seconds ahead, without touching the filter.
+    void Extrapolate(double dt, double (&out)[N]) const {
+        double f[N][N];
+        Transition(dt, f);
+        for (int i = 0; i < N; ++i) {
+            out[i] = 0.0;
+            for (int k = i; k < N; ++k) out[i] += f[i][k] * m_x[k];
+        }
+    }
+
+private:
+    static double Power(double value, int exponent) { double result = 1.0; while (exponent-- > 0) result *= value; return result; }
+    static double Factorial(int n) { double result = 1.0; while (n > 1) result *= n--; return result; }
+    // F_ij = dt^(j-i) / (j-i)! above the diagonal.
+    static void Transition(double dt, double (&f)[N][N]) {
+        for (int i = 0; i < N; ++i) {
+            for (int j = 0; j < N; ++j) f[i][j] = j < i ? 0.0 : Power(dt, j - i) / Factorial(j - i);
+        }
+    }
+
+    double m_x[N];
+    double m_p[N][N];
+};
+
+class TargetEstimator {
+public:
+    // Drops the track (tracker restarted or stopped).
+    void Reset() { m_has_track = false; }
+
+    // Tracker measurement from the frame captured at timestamp_ns. One older than the last is
+    // ignored; one more than max_coast_s after it restarts the filter from this position (the
+    // motion before a long gap says little about the motion after it).
+    void Update(double x, double y, double scale, int64_t timestamp_ns);
+
+    // State extrapolated to time_ns, up to max_coast_s past the last measurement (a dropped
+    // frame or two). Beyond that the gap means the picture stopped changing (static screen,
+    // unchanged frames the tracking thread skips) while the target is still locked: the
+    // filtered position at the last measurement is held, with zero velocity and acceleration,
+    // instead of a stale extrapolation. Only a tracker loss or stop (Reset()) ends the track.
+    // False without a track.
+    bool Estimate(int64_t time_ns, TargetEstimate& out) const;
+
+    bool HasTrack() const { return m_has_track; }
+
+private:
+    KinematicFilter<3> m_x;
+    KinematicFilter<3> m_y;
+    KinematicFilter<2> m_scale;
+    int64_t m_time_ns = 0;                  // capture time of the last measurement
+    bool m_has_track = false;
+};
@@ -0,0 +1,238 @@
+#include "target_recovery.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+
+#include <opencv2/imgproc.hpp>
+
+RecoverySettings g_recovery_settings;
+
+namespace {
+
+const int TEMPLATE_REFRESH_FRAMES = 10;         // successful frames between template refreshes
+const double TEMPLATE_REFRESH_MIN_SCORE = 0.5;  // a refresh must still match the old template (no drifting onto background)
+const double MIN_TEMPLATE_STDDEV = 4.0;         // flatter patches match anything
+const int MIN_TEMPLATE_SIDE = 8;                // template side at the coarsest search level
+const int MAX_PYRAMID_LEVELS = 4;
+const double WINDOW_START_SCALE = 4.0;          // first search window / box size
+const double WINDOW_GROWTH = 1.5;               // per missed search
+const int MAX_CANDIDATES = 3;                   // coarse peaks refined to full resolution
+const double COARSE_SCORE_SLACK = 0.25;         // coarse peaks may score this far below min_score
+const int REFINE_RADIUS = 2;                    // px around the upsampled peak, per level
+const int CONFIRM_MARGIN_MIN = 8;               // px around the hit searched again on the current frame
+
+void ToGray(const cv::Mat& src, cv::Mat& dst) {
+    if (src.channels() == 4) cv::cvtColor(src, dst, cv::COLOR_BGRA2GRAY);
+    else if (src.channels() == 3) cv::cvtColor(src, dst, cv::COLOR_BGR2GRAY);
+    else src.copyTo(dst);
+}
+
+// Best match of 'templ' inside 'image' (both grey); false if 'image' is too small.
+bool BestMatch(const cv::Mat& image, const cv::Mat& templ, cv::Mat& response, cv::Point& location, double& score) {
+    if (image.cols < templ.cols || image.rows < templ.rows) return false;
+    cv::matchTemplate(image, templ, response, cv::TM_CCOEFF_NORMED);
+    cv::minMaxLoc(response, nullptr, &score, nullptr, &location);
+    return true;
+}
+
+// NCC of two grey patches of the same size (TM_CCOEFF_NORMED at zero offset), computed
+// directly: matchTemplate would set up DFT buffers for a single value.
+double PatchNcc(const cv::Mat& a, const cv::Mat& b) {
+    double sum_a = 0.0, sum_b = 0.0, sum_aa = 0.0, sum_bb = 0.0, sum_ab = 0.0;
+    for (int y = 0; y < a.rows; ++y) {
+        const uint8_t* row_a = a.ptr<uint8_t>(y);
+        const uint8_t* row_b = b.ptr<uint8_t>(y);
+        for (int x = 0; x < a.cols; ++x) {
+            double va = row_a[x], vb = row_b[x];
+            sum_a += va; sum_b += vb;
+            sum_aa += va * va; sum_bb += vb * vb; sum_ab += va * vb;
+        }
+    }
+    double n = static_cast<double>(a.total());
+    double cov = sum_ab - sum_a * sum_b / n;
+    double var = (sum_aa - sum_a * sum_a / n) * (sum_bb - sum_b * sum_b / n);
+    return var > 0.0 ? cov / std::sqrt(var) : 0.0;
+}
+
+} // namespace
+
+TargetRecovery::TargetRecovery() {}
+
+TargetRecovery::~TargetRecovery() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cv.notify_all();
+    if (m_worker.joinable()) m_worker.join();
+}
+
+void TargetRecovery::Observe(const cv::Mat& frame, const cv::Rect& box) {
+    if (m_submitted) m_discard = true;
+    m_last_box = box;
+    m_lost_frames = 0;
+    m_attempt = 0;
+    m_gave_up = false;
+    if (!m_template.empty() && ++m_frames_since_refresh < TEMPLATE_REFRESH_FRAMES) return;
+    if ((box & cv::Rect(0, 0, frame.cols, frame.rows)) != box || std::min(box.width, box.height) < MIN_TEMPLATE_SIDE) return;
+    m_frames_since_refresh = 0;
+
+    ToGray(frame(box), m_candidate);
+    cv::Scalar mean, stddev;
+    cv::meanStdDev(m_candidate, mean, stddev);
+    if (stddev[0] < MIN_TEMPLATE_STDDEV) return;
+    if (!m_template.empty() && m_template.size() == m_candidate.size() && PatchNcc(m_candidate, m_template) < TEMPLATE_REFRESH_MIN_SCORE) return;
+    m_candidate.copyTo(m_template);
+}
+
+bool TargetRecovery::Search(const cv::Mat& frame, cv::Rect& box_out) {
+    if (m_template.empty() || m_gave_up) return false;
+    if (m_lost_frames == 0) std::cout << "Target lost, searching for it." << std::endl;
+    ++m_lost_frames;
+
+    cv::Rect hit;
+    double score = 0.0;
+    if (Collect(hit, score) && Confirm(frame, hit, box_out)) {
+        std::cout << "Target re-detected after " << m_lost_frames << " frames (NCC " << score << ")." << std::endl;
+        m_last_box = box_out;
+        m_lost_frames = 0;
+        m_attempt = 0;
+        return true;
+    }
+    if (m_lost_frames > g_recovery_settings.max_frames) {
+        m_gave_up = true;
+        std::cout << "Target not re-detected in " << g_recovery_settings.max_frames << " frames, giving up." << std::endl;
+        return false;
+    }
+    Submit(frame);
+    return false;
+}
+
+void TargetRecovery::Submit(const cv::Mat& frame) {
+    // Window around the last good position, growing with every miss.
+    double scale = WINDOW_START_SCALE;
+    for (int i = 0; i < m_attempt; ++i) scale *= WINDOW_GROWTH;
+    ++m_attempt;
+    int width = std::max(m_template.cols + 1, cvRound(m_template.cols * scale));
+    int height = std::max(m_template.rows + 1, cvRound(m_template.rows * scale));
+    cv::Point centre(m_last_box.x + m_last_box.width / 2, m_last_box.y + m_last_box.height / 2);
+    cv::Rect window = cv::Rect(centre.x - width / 2, centre.y - height / 2, width, height) & cv::Rect(0, 0, frame.cols, frame.rows);
+    if (window.width < m_template.cols || window.height < m_template.rows) return;
+
+    // The worker is idle here (Collect() ran first), so its job buffers are ours to fill.
+    frame(window).copyTo(m_job_window);
+    m_template.copyTo(m_job_template);
+    m_job_origin = window.tl();
+    if (!m_worker.joinable()) m_worker = std::thread(&TargetRecovery::WorkerLoop, this);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_job_pending = true;
+        m_job_done = false;
+    }
+    m_cv.notify_all();
+    m_submitted = true;
+    m_discard = false;
+}
+
+bool TargetRecovery::Collect(cv::Rect& box_out, double& score_out) {
+    if (!m_submitted) return false;
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cv.wait(lock, [this] { return m_job_done; });
+    }
+    m_submitted = false;
+    if (m_discard || !m_result_found) return false;
+    box_out = m_result_box;
+    score_out = m_result_score;
+    return true;
+}
+
+// The hit is from the previous frame; look again around it on this one.
+bool TargetRecovery::Confirm(const cv::Mat& frame, const cv::Rect& hit, cv::Rect& box_out) {
+    int margin = std::max(CONFIRM_MARGIN_MIN, std::max(hit.width, hit.height) / 2);
+    cv::Rect area = cv::Rect(hit.x - margin, hit.y - margin, hit.width + 2 * margin, hit.height + 2 * margin)
+                    & cv::Rect(0, 0, frame.cols, frame.rows);
+    ToGray(frame(area), m_confirm_gray);
+    cv::Point location;
+    double score = 0.0;
+    if (!BestMatch(m_confirm_gray, m_template, m_score, location, score) || score < g_recovery_settings.min_score) return false;
+    box_out = cv::Rect(area.x + location.x, area.y + location.y, m_template.cols, m_template.rows);
+    return true;
+}
+
+void TargetRecovery::WorkerLoop() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_cv.wait(lock, [this] { return m_job_pending || m_stop; });
+        if (m_stop) return;
+        m_job_pending = false;
+        lock.unlock();
+        RunSearch();
+        lock.lock();
+        m_job_done = true;
+        m_cv.notify_all();
+    }
+}
+
+void TargetRecovery::RunSearch() {
+    m_result_found = false;
+    m_result_score = 0.0;
+    if (m_window_levels.empty()) {
+        m_window_levels.resize(MAX_PYRAMID_LEVELS);
+        m_template_levels.resize(MAX_PYRAMID_LEVELS);
+    }
+    ToGray(m_job_window, m_window_levels[0]);
+    m_job_template.copyTo(m_template_levels[0]);
+
+    // Coarsest level at which the template keeps MIN_TEMPLATE_SIDE px and still fits the window.
+    int top = 0;
+    while (top + 1 < MAX_PYRAMID_LEVELS) {
+        const cv::Mat& window = m_window_levels[top];
+        const cv::Mat& templ = m_template_levels[top];
+        if (std::min(templ.cols, templ.rows) / 2 < MIN_TEMPLATE_SIDE) break;
+        if ((window.cols + 1) / 2 < (templ.cols + 1) / 2 || (window.rows + 1) / 2 < (templ.rows + 1) / 2) break;
+        cv::pyrDown(window, m_window_levels[top + 1]);
+        cv::pyrDown(templ, m_template_levels[top + 1]);
+        ++top;
+    }
+
+    // Coarse peaks, each suppressed (one template around it) before looking for the next.
+    const cv::Mat& top_template = m_template_levels[top];
+    cv::matchTemplate(m_window_levels[top], top_template, m_response, cv::TM_CCOEFF_NORMED);
+    cv::Point candidates[MAX_CANDIDATES];
+    double candidate_scores[MAX_CANDIDATES];
+    int candidate_count = 0;
+    for (int i = 0; i < MAX_CANDIDATES; ++i) {
+        double score = 0.0;
+        cv::Point location;
+        cv::minMaxLoc(m_response, nullptr, &score, nullptr, &location);
+        if (score < g_recovery_settings.min_score - COARSE_SCORE_SLACK) break;
+        candidates[candidate_count] = location;
+        candidate_scores[candidate_count++] = score;
+        cv::Rect suppress = cv::Rect(location.x - top_template.cols / 2, location.y - top_template.rows / 2, top_template.cols, top_template.rows)
+                            & cv::Rect(0, 0, m_response.cols, m_response.rows);
+        m_response(suppress).setTo(-1.0f);
+    }
+
+    // Refine each down the pyramid in a +-REFINE_RADIUS neighbourhood of the upsampled peak.
+    for (int i = 0; i < candidate_count; ++i) {
+        cv::Point location = candidates[i];
+        double score = candidate_scores[i];
+        for (int level = top - 1; level >= 0 && score >= 0.0; --level) {
+            const cv::Mat& window = m_window_levels[level];
+            const cv::Mat& templ = m_template_levels[level];
+            cv::Rect area = cv::Rect(location.x * 2 - REFINE_RADIUS, location.y * 2 - REFINE_RADIUS,
+                                     templ.cols + 2 * REFINE_RADIUS, templ.rows + 2 * REFINE_RADIUS)
+                            & cv::Rect(0, 0, window.cols, window.rows);
+            cv::Point refined;
+            if (!BestMatch(window(area), templ, m_response, refined, score)) score = -1.0;
+            location = area.tl() + refined;
+        }
+        if (score < g_recovery_settings.min_score || score <= m_result_score) continue;
+        m_result_found = true;
+        m_result_score = score;
+        m_result_box = cv::Rect(m_job_origin + location, m_job_template.size());
+    }
+}
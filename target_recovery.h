@@ -0,0 +1,93 @@
+#pragma once
+
+// Re-detection after the tracker loses its target. While the tracker holds the
+// target, TargetRecovery keeps a grey template of it (refreshed from successful
+// frames that still look like the one it has). When Update() fails, every frame
+// a window around the last good position is copied out and searched on a worker
+// thread, the window growing on each miss until it covers the frame:
+//   - window and template are reduced to the coarsest pyramid level (pyrDown) at
+//     which the template is still MIN_TEMPLATE_SIDE px across;
+//   - normalised cross-correlation (cv::matchTemplate, TM_CCOEFF_NORMED: OpenCV
+//     correlates with blockwise DFTs and normalises with integral images) picks
+//     the best few peaks there, and each is refined level by level in a small
+//     neighbourhood down to full resolution.
+// A search submitted on frame N is collected on frame N+1, waiting for it if it
+// is still running (it takes a millisecond or two, well under a frame), so a
+// live run and its replay re-acquire on the same frame. A hit is matched again
+// around its position on the current frame before it is reported.
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+struct RecoverySettings {
+    bool enabled = true;
+    double min_score = 0.6;     // NCC the target must reach on the current frame to count as found
+    int max_frames = 90;        // frames to keep searching after a loss; then it is left to the operator (ch8)
+};
+
+// Read by the tracking thread (--redetect, --redetect-score, --redetect-frames).
+extern RecoverySettings g_recovery_settings;
+
+class TargetRecovery {
+public:
+    TargetRecovery();
+    ~TargetRecovery();          // waits for a search still running
+
+    TargetRecovery(const TargetRecovery&) = delete;
+    TargetRecovery& operator=(const TargetRecovery&) = delete;
+
+    // The tracker holds the target at 'box' on 'frame' (1, 3 or 4 channels). Ends a search
+    // episode and refreshes the template every TEMPLATE_REFRESH_FRAMES calls.
+    void Observe(const cv::Mat& frame, const cv::Rect& box);
+
+    // The tracker lost the target on 'frame'. Returns true with the target's box on 'frame'
+    // once re-detected; otherwise submits the next search and returns false.
+    bool Search(const cv::Mat& frame, cv::Rect& box_out);
+
+    // Lost, with a template to look for, and not given up yet.
+    bool Active() const { return m_lost_frames > 0 && !m_template.empty() && !m_gave_up; }
+
+private:
+    void Submit(const cv::Mat& frame);
+    bool Collect(cv::Rect& box_out, double& score_out);        // waits for the submitted search
+    bool Confirm(const cv::Mat& frame, const cv::Rect& hit, cv::Rect& box_out);
+    void WorkerLoop();
+    void RunSearch();                                           // worker: m_job_* -> m_result_*
+
+    // Tracking thread only.
+    cv::Mat m_template;                 // grey, last good target appearance
+    cv::Mat m_candidate;                // template refresh scratch
+    cv::Mat m_confirm_gray;
+    cv::Mat m_score;
+    cv::Rect m_last_box;                // last position the tracker held
+    int m_frames_since_refresh = 0;
+    int m_lost_frames = 0;              // frames since the loss, 0 while tracking
+    int m_attempt = 0;                  // searches submitted in this episode (window growth)
+    bool m_gave_up = false;
+    bool m_submitted = false;           // a search is out and not collected yet
+    bool m_discard = false;             // ... but the tracker got the target back meanwhile
+
+    // Handed to the worker by Submit(), owned by it until m_job_done.
+    cv::Mat m_job_window;               // window pixels, tracker format
+    cv::Mat m_job_template;
+    cv::Point m_job_origin;             // window position in the frame
+    bool m_result_found = false;
+    cv::Rect m_result_box;              // frame coordinates
+    double m_result_score = 0.0;
+
+    // Worker scratch, kept between searches.
+    std::vector<cv::Mat> m_window_levels;
+    std::vector<cv::Mat> m_template_levels;
+    cv::Mat m_response;
+
+    std::thread m_worker;               // started by the first search
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_job_pending = false;
+    bool m_job_done = false;
+    bool m_stop = false;
+};
@@ -0,0 +1,137 @@
+#include "tracker_registry.h"
+
+#include <iostream>
+
+#include <opencv2/tracking.hpp>
+#include <opencv2/tracking/tracking_legacy.hpp>
+
+#include "correlation_tracker.h"
+
+namespace {
+
+// cv::Tracker behind TargetTracker. OpenCV reports a failed init by throwing;
+// the pipeline only needs "did it start".
+class OpenCvTracker : public TargetTracker {
+public:
+    OpenCvTracker(const char* name, cv::Ptr<cv::Tracker> tracker) : m_name(name), m_tracker(tracker) {}
+
+    bool Init(const cv::Mat& frame, const cv::Rect& box) override {
+        if (!m_tracker) return false;
+        try {
+            m_tracker->init(frame, box);
+            return true;
+        } catch (const cv::Exception& e) {
+            std::cerr << "OpenCV Exception during " << m_name << " init: " << e.what() << std::endl;
+            return false;
+        }
+    }
+
+    bool Update(const cv::Mat& frame, cv::Rect& box) override {
+        try {
+            return m_tracker->update(frame, box);
+        } catch (const cv::Exception& e) {
+            std::cerr << "OpenCV Exception during " << m_name << " update: " << e.what() << std::endl;
+            return false;
+        }
+    }
+
+private:
+    const char* m_name;
+    cv::Ptr<cv::Tracker> m_tracker;
+};
+
+std::unique_ptr<TargetTracker> Wrap(const char* name, cv::Ptr<cv::Tracker> tracker) {
+    if (!tracker) return nullptr;
+    return std::unique_ptr<TargetTracker>(new OpenCvTracker(name, tracker));
+}
+
+std::unique_ptr<TargetTracker> CreateKcf(int channels) {
+    cv::TrackerKCF::Params params;
+    if (channels == 1) {
+        // Colour names need three channels; the grey feature alone is what KCF falls back to on luma.
+        params.desc_pca = cv::TrackerKCF::GRAY;
+        params.desc_npca = 0;
+    }
+    return Wrap("kcf", cv::TrackerKCF::create(params));
+}
+
+std::unique_ptr<TargetTracker> CreateCsrt(int) {
+    return Wrap("csrt", cv::TrackerCSRT::create());
+}
+
+std::unique_ptr<TargetTracker> CreateMosse(int) {
+    // Only the legacy API has MOSSE since OpenCV 4.5.1.
+    return Wrap("mosse", cv::legacy::upgradeTrackingAPI(cv::legacy::TrackerMOSSE::create()));
+}
+
+std::unique_ptr<TargetTracker> CreateMil(int) {
+    return Wrap("mil", cv::TrackerMIL::create());
+}
+
+// In-house trackers read BGR or luma alike (BGR is converted while sampling).
+std::unique_ptr<TargetTracker> CreateFastMosse(int) {
+    return std::unique_ptr<TargetTracker>(new CorrelationTracker(CorrelationKernel::Linear, g_correlation_tracker_params));
+}
+
+std::unique_ptr<TargetTracker> CreateFastKcf(int) {
+    return std::unique_ptr<TargetTracker>(new CorrelationTracker(CorrelationKernel::Gaussian, g_correlation_tracker_params));
+}
+
+// Index 0 is the default (what the app always ran).
+const TrackerInfo TRACKERS[] = {
+    // name          description                                               luma   bgr    scale  cost
+    { "kcf",        "OpenCV KCF (grey + colour names; grey only on luma)",    true,  true,  false, TrackerCost::Low,    CreateKcf },
+    { "csrt",       "OpenCV CSRT (HOG + colour names, spatial reliability)",  false, true,  true,  TrackerCost::High,   CreateCsrt },
+    { "mosse",      "OpenCV MOSSE (grey correlation filter)",                 true,  false, false, TrackerCost::Low,    CreateMosse },
+    { "mil",        "OpenCV MIL (Haar features, multiple-instance learning)", true,  true,  false, TrackerCost::Medium, CreateMil },
+    { "fast_mosse", "In-house MOSSE (grey, fixed FFT patch, no allocation)",  true,  true,  false, TrackerCost::Low,    CreateFastMosse },
+    { "fast_kcf",   "In-house KCF (grey, Gaussian kernel, fixed FFT patch)",  true,  true,  false, TrackerCost::Low,    CreateFastKcf },
+};
+
+} // namespace
+
+const char* TrackerCostName(TrackerCost cost) {
+    switch (cost) {
+        case TrackerCost::Low:    return "low";
+        case TrackerCost::Medium: return "medium";
+        case TrackerCost::High:   return "high";
+    }
+    return "unknown";
+}
+
+size_t TrackerCount() {
+    return sizeof(TRACKERS) / sizeof(TRACKERS[0]);
+}
+
+const TrackerInfo& TrackerInfoAt(size_t index) {
+    return TRACKERS[index < TrackerCount() ? index : 0];
+}
+
+int FindTracker(const std::string& name) {
+    for (size_t i = 0; i < TrackerCount(); ++i) {
+        if (name == TRACKERS[i].name) return static_cast<int>(i);
+    }
+    return -1;
+}
+
+std::string TrackerNameList() {
+    std::string names;
+    for (size_t i = 0; i < TrackerCount(); ++i) {
+        if (i > 0) names += ", ";
+        names += TRACKERS[i].name;
+    }
+    return names;
+}
+
+int ChannelsForTracker(const TrackerInfo& info, int preferred_channels) {
+    if (preferred_channels == 1 && info.accepts_luma) return 1;
+    if (preferred_channels == 3 && info.accepts_bgr) return 3;
+    return info.accepts_bgr ? 3 : 1;
+}
+
+std::unique_ptr<TargetTracker> CreateTracker(size_t index, int channels) {
+    const TrackerInfo& info = TrackerInfoAt(index);
+    std::unique_ptr<TargetTracker> tracker = info.create(channels);
+    if (!tracker) std::cerr << "Failed to create tracker '" << info.name << "'." << std::endl;
+    return tracker;
+}
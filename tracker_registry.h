@@ -0,0 +1,59 @@
+#pragma once
+
+// Every tracker the tracking thread can run, behind one interface. The registry
+// is a fixed table in tracker_registry.cpp: OpenCV's KCF, CSRT, MOSSE and MIL
+// wrapped in an adapter, and in-house trackers implementing TargetTracker
+// directly. Each entry carries what the pipeline needs to pick and feed it:
+// which pixel formats it takes, whether it follows scale changes, and a rough
+// cost class (SimBenchmarks measures the real numbers, see --session there).
+//
+// Trackers are selected by name (--tracker) or at runtime (SelectTracker(), the
+// 'Y' hotkey); see tracking.h for how a switch takes over a running track.
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include <opencv2/core.hpp>
+
+class TargetTracker {
+public:
+    virtual ~TargetTracker() {}
+
+    // 'frame' is CV_8UC1 or CV_8UC3, in a format the entry accepts. False if the
+    // tracker cannot start on this box (too small, degenerate texture, ...).
+    virtual bool Init(const cv::Mat& frame, const cv::Rect& box) = 0;
+    // Same frame size and format as Init(). 'box' is updated only on success.
+    virtual bool Update(const cv::Mat& frame, cv::Rect& box) = 0;
+    // Target centre after the last Init() / successful Update(), in frame pixels, for
+    // trackers that locate it more finely than the integer box. False: use the box centre.
+    virtual bool SubpixelCentre(cv::Point2d& centre) const { (void)centre; return false; }
+};
+
+enum class TrackerCost { Low, Medium, High };    // typical update time on a DISPLAY_WIDTH frame: < 1 ms, a few ms, 10+ ms
+
+const char* TrackerCostName(TrackerCost cost);
+
+struct TrackerInfo {
+    const char* name;               // --tracker value, lower case
+    const char* description;
+    bool accepts_luma;              // 8-bit luma (CV_8UC1)
+    bool accepts_bgr;               // BGR (CV_8UC3)
+    bool supports_scale;            // box size follows the target; otherwise fixed at the init size
+    TrackerCost cost;
+    // channels: 1 or 3, one the entry accepts. Never null for a registered entry.
+    std::unique_ptr<TargetTracker> (*create)(int channels);
+};
+
+size_t TrackerCount();
+const TrackerInfo& TrackerInfoAt(size_t index);
+// Registry index, or -1 for an unknown name.
+int FindTracker(const std::string& name);
+// "kcf, csrt, ..." for usage messages.
+std::string TrackerNameList();
+
+// The configured input format if the tracker takes it, else the one it does take.
+int ChannelsForTracker(const TrackerInfo& info, int preferred_channels);
+
+// Null (with a message on std::cerr) when the backend is unavailable in this build.
+std::unique_ptr<TargetTracker> CreateTracker(size_t index, int channels);
@@ -0,0 +1,550 @@
+#include "tracking.h"
+
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+
+#include <opencv2/imgproc.hpp>
+
+#include "target_acquisition.h"
+#include "target_recovery.h"
+#include "worker_pool.h"
+
+cv::Mat track_frame;
+std::unique_ptr<TargetTracker> tracker;
+cv::Rect tracked_bbox;
+bool tracker_initialized = false;
+cv::Rect tracked_bbox_native;
+TrackerSettings g_tracker_settings;
+
+cv::Size ComputeDisplaySize(const cv::Size& capture_size) {
+    double aspect_ratio = (double)capture_size.width / (double)capture_size.height;
+    int display_height = static_cast<int>(DISPLAY_WIDTH / aspect_ratio);
+    if (display_height <= 0) display_height = DISPLAY_WIDTH * 9 / 16;
+    return cv::Size(DISPLAY_WIDTH, display_height);
+}
+
+namespace {
+
+const int RESIZE_BLOCK_TARGET = 16;         // display px per block edge (rounded up to the alignment)
+const int RESIZE_MAX_ALIGNMENT = 40;        // coarser alignment (odd ratios like 1366 -> 800) -> full resize
+const double RESIZE_FULL_FRACTION = 0.6;    // above this share of changed blocks one full resize is cheaper
+
+const double CAPTURE_WINDOW_SCALE = 3.0;    // KCF samples 2.5x the box; the rest is room for motion between frames
+const int CAPTURE_WINDOW_MIN_SIZE = 64;
+const int ACQUISITION_OVERLAY_FRAMES = 60;  // frames the seed box stays in the overlay after the tracker starts
+
+cv::Size tracker_input_size;                // frame size the tracker was initialised on
+int tracker_channels = 3;                   // pixel format the running tracker was initialised with
+int tracker_index = -1;                     // registry entry of the running tracker
+std::atomic<int> selected_tracker{0};       // registry entry to run (SelectTracker)
+std::unique_ptr<TargetRecovery> recovery;   // re-detection for the running tracker's target
+cv::Rect acquired_bbox;                     // box the running tracker was seeded with, display px
+double acquisition_score = 0.0;             // its saliency score (0 = fixed centre box)
+int acquisition_overlay_frames = 0;         // frames left to report it in TrackingMeasurement
+
+// Window-targeted capture changes the frame size with the window; a box from the
+// old geometry means nothing in the new one, so the tracker starts over.
+void ResetTrackerOnResize(const cv::Size& frame_size) {
+    if (!tracker_initialized || frame_size.area() == 0 || frame_size == tracker_input_size) return;
+    ResetTracker();
+    std::cout << "Frame size changed, tracker reset." << std::endl;
+}
+
+// Colour conversion to the tracker's channel count; CV_8UC(channels) input is passed
+// through untouched. Returns false for formats the tracker cannot take.
+bool ConvertForTracker(const cv::Mat& frame, int channels, cv::Mat& converted, cv::Mat& out) {
+    if (frame.channels() == channels) { out = frame; return true; }
+    int code = -1;
+    if (channels == 1) code = frame.channels() == 4 ? cv::COLOR_BGRA2GRAY : frame.channels() == 3 ? cv::COLOR_BGR2GRAY : -1;
+    else if (channels == 3) code = frame.channels() == 4 ? cv::COLOR_BGRA2BGR : frame.channels() == 1 ? cv::COLOR_GRAY2BGR : -1;
+    if (code < 0) return false;
+    cv::cvtColor(frame, converted, code); // reuses 'converted' once sized
+    out = converted;
+    return true;
+}
+
+// Input format for the selected tracker: the configured one if it takes it.
+int SelectedTrackerChannels() {
+    return ChannelsForTracker(TrackerInfoAt(selected_tracker.load()), g_tracker_settings.channels == 1 ? 1 : 3);
+}
+
+// Creates the selected tracker and starts it on 'box'. Leaves the running tracker
+// alone and returns false if that fails.
+bool StartSelectedTracker(const cv::Mat& frame, const cv::Rect& box, int channels) {
+    int index = selected_tracker.load();
+    // The selection may have moved on since 'channels' was picked; the next frame retries.
+    if (ChannelsForTracker(TrackerInfoAt(index), channels) != channels) return false;
+    std::unique_ptr<TargetTracker> created = CreateTracker(index, channels);
+    if (!created || !created->Init(frame, box)) return false;
+    tracker = std::move(created);
+    tracker_index = index;
+    tracker_channels = channels;
+    return true;
+}
+
+void NoteAcquisition(const cv::Rect& display_box, double score) {
+    acquired_bbox = display_box;
+    acquisition_score = score;
+    acquisition_overlay_frames = ACQUISITION_OVERLAY_FRAMES;
+}
+
+// The seed box and its score ride along with the first frames' measurements for the overlay.
+void ReportAcquisition(TrackingMeasurement& measurement) {
+    bool show = tracker_initialized && acquisition_overlay_frames > 0;
+    if (show) --acquisition_overlay_frames;
+    measurement.acquired_bbox = show ? acquired_bbox : cv::Rect();
+    measurement.acquisition_score = show ? static_cast<float>(acquisition_score) : 0.0f;
+}
+
+// Same kind of tracker as the one running, started on a re-detected box. Not a switch:
+// the selection and the input format stay as they are.
+bool RestartTracker(const cv::Mat& frame, const cv::Rect& box) {
+    std::unique_ptr<TargetTracker> created = CreateTracker(tracker_index, tracker_channels);
+    if (!created || !created->Init(frame, box)) return false;
+    tracker = std::move(created);
+    return true;
+}
+
+// Feeds the tracker's result on 'frame' to re-detection (target_recovery.h). After a
+// loss, returns true once the target is found again: the tracker has been restarted
+// on it and 'box' holds it.
+bool RecoverTarget(const cv::Mat& frame, bool tracked, cv::Rect& box) {
+    if (!g_recovery_settings.enabled) return false;
+    if (!recovery) recovery.reset(new TargetRecovery());
+    if (tracked) {
+        recovery->Observe(frame, box);
+        return false;
+    }
+    cv::Rect found;
+    if (!recovery->Search(frame, found) || !RestartTracker(frame, found)) return false;
+    box = found;
+    return true;
+}
+
+bool TrackerSwitchPending() {
+    return tracker_initialized && tracker_index != selected_tracker.load();
+}
+
+// Target centre in frame pixels: the tracker's sub-pixel estimate if it has one, else the box centre.
+cv::Point2d TargetCentre(const cv::Rect& box) {
+    cv::Point2d centre;
+    if (tracker && tracker->SubpixelCentre(centre)) return centre;
+    return cv::Point2d(box.x + box.width / 2.0, box.y + box.height / 2.0);
+}
+
+// Whole-frame resize. With a downscale pool the fused bilinear kernel runs in bands
+// over it (same sampling as cv::resize, within 1 LSB); otherwise OpenCV as before.
+void FullResize(const cv::Mat& capture, cv::Mat& display, cv::Size dst_size, FrameWorkspace& workspace) {
+    if (workspace.downscale_pool && capture.type() == CV_8UC4 && dst_size.width < capture.cols && dst_size.height < capture.rows) {
+        display.create(dst_size, CV_8UC4);
+        workspace.downscaler.Run(capture, display, DownscaleFilter::Bilinear, *workspace.downscale_pool);
+        return;
+    }
+    cv::resize(capture, display, dst_size);
+}
+
+int GreatestCommonDivisor(int a, int b) {
+    while (b != 0) { int t = a % b; a = b; b = t; }
+    return a;
+}
+
+} // namespace
+
+int TrackerInputChannels() {
+    return tracker_initialized && !TrackerSwitchPending() ? tracker_channels : SelectedTrackerChannels();
+}
+
+void SelectTracker(int index) {
+    if (index >= 0 && static_cast<size_t>(index) < TrackerCount()) selected_tracker.store(index);
+}
+
+int SelectedTracker() {
+    return selected_tracker.load();
+}
+
+int RunningTracker() {
+    return tracker_initialized ? tracker_index : -1;
+}
+
+size_t ResizeToDisplay(const cv::Mat& capture, const FrameTileMap& tiles, uint64_t display_sequence,
+                       cv::Mat& display, FrameWorkspace& workspace) {
+    const cv::Size src_size = capture.size();
+    const cv::Size dst_size = display.size();
+    if (display_sequence == 0 || !tiles.Valid()) {
+        FullResize(capture, display, dst_size, workspace);
+        return static_cast<size_t>(dst_size.area());
+    }
+
+    // Alignment unit: the smallest display step that maps to a whole number of source
+    // pixels (1920 -> 800 is 5 display px per 12 source px). Blocks are whole units.
+    int gcd_x = GreatestCommonDivisor(src_size.width, dst_size.width);
+    int gcd_y = GreatestCommonDivisor(src_size.height, dst_size.height);
+    int align_x = dst_size.width / gcd_x, src_align_x = src_size.width / gcd_x;
+    int align_y = dst_size.height / gcd_y, src_align_y = src_size.height / gcd_y;
+    int units_x = std::max(1, (RESIZE_BLOCK_TARGET + align_x - 1) / align_x);
+    int units_y = std::max(1, (RESIZE_BLOCK_TARGET + align_y - 1) / align_y);
+    int block_w = align_x * units_x, src_block_w = src_align_x * units_x;
+    int block_h = align_y * units_y, src_block_h = src_align_y * units_y;
+    int blocks_x = (dst_size.width + block_w - 1) / block_w;
+    int blocks_y = (dst_size.height + block_h - 1) / block_h;
+    uint8_t* block_changed = workspace.arena.AllocateArray<uint8_t>(static_cast<size_t>(blocks_x) * blocks_y);
+    if (align_x > RESIZE_MAX_ALIGNMENT || align_y > RESIZE_MAX_ALIGNMENT || !block_changed) {
+        FullResize(capture, display, dst_size, workspace);
+        return static_cast<size_t>(dst_size.area());
+    }
+
+    // A block reads its source rect plus one pixel around it (bilinear neighbours).
+    int changed_blocks = 0;
+    for (int by = 0; by < blocks_y; ++by) {
+        for (int bx = 0; bx < blocks_x; ++bx) {
+            cv::Rect source_rect(bx * src_block_w - 1, by * src_block_h - 1, src_block_w + 2, src_block_h + 2);
+            bool changed = tiles.RectChangedSince(source_rect, display_sequence);
+            block_changed[by * blocks_x + bx] = changed ? 1 : 0;
+            changed_blocks += changed ? 1 : 0;
+        }
+    }
+    if (changed_blocks == 0) return 0;
+    if (changed_blocks > RESIZE_FULL_FRACTION * blocks_x * blocks_y) {
+        FullResize(capture, display, dst_size, workspace);
+        return static_cast<size_t>(dst_size.area());
+    }
+
+    workspace.resize_scratch.create(dst_size, display.type()); // no-op once sized
+    size_t written = 0;
+    for (int by = 0; by < blocks_y; ++by) {
+        int bx = 0;
+        while (bx < blocks_x) {
+            if (!block_changed[by * blocks_x + bx]) { ++bx; continue; }
+            int run_start = bx;
+            while (bx < blocks_x && block_changed[by * blocks_x + bx]) ++bx;
+
+            cv::Rect inner(run_start * block_w, by * block_h, 0, 0);
+            inner.width = std::min(bx * block_w, dst_size.width) - inner.x;
+            inner.height = std::min((by + 1) * block_h, dst_size.height) - inner.y;
+            // Resize one alignment unit of margin on each side (clipped at the frame edge, where
+            // a full resize clamps too) so the kept pixels see the same neighbours.
+            int x0 = std::max(0, inner.x - align_x), x1 = std::min(dst_size.width, inner.x + inner.width + align_x);
+            int y0 = std::max(0, inner.y - align_y), y1 = std::min(dst_size.height, inner.y + inner.height + align_y);
+            cv::Rect source_outer(x0 / align_x * src_align_x, y0 / align_y * src_align_y,
+                                  (x1 - x0) / align_x * src_align_x, (y1 - y0) / align_y * src_align_y);
+            cv::Mat scratch = workspace.resize_scratch(cv::Rect(0, 0, x1 - x0, y1 - y0));
+            cv::resize(capture(source_outer), scratch, scratch.size());
+            scratch(cv::Rect(inner.x - x0, inner.y - y0, inner.width, inner.height)).copyTo(display(inner));
+            written += static_cast<size_t>(inner.area());
+        }
+    }
+    return written;
+}
+
+void get_track_frame(const cv::Mat& display_frame, bool tracking_enabled) {
+    // 检查标志位，并且确保 track_frame 当前是空的 (避免重复截取或覆盖)
+    // 同时也要确保 display_frame 不是空的，并且足够大以进行截取
+    if (tracking_enabled && track_frame.empty() && !display_frame.empty()) {
+        int roi_width = 32;
+        int roi_height = 32;
+
+        // 检查 display_frame 是否足够大以截取 32x32 的区域
+        if (display_frame.cols >= roi_width && display_frame.rows >= roi_height) {
+            // 计算中心位置的左上角坐标 (cx, cy)
+            int center_x = display_frame.cols / 2;
+            int center_y = display_frame.rows / 2;
+
+            // 计算ROI (Region of Interest) 的左上角坐标
+            int roi_x = center_x - (roi_width / 2);
+            int roi_y = center_y - (roi_height / 2);
+
+            // 确保ROI的坐标不会超出 display_frame 的边界
+            // (虽然对于中心截取且display_frame足够大的情况，通常不会超出，但加上检查更安全)
+            if (roi_x < 0) roi_x = 0;
+            if (roi_y < 0) roi_y = 0;
+            if (roi_x + roi_width > display_frame.cols) {
+                // 如果ROI超出右边界，可以调整roi_x或roi_width，或者不进行截取
+                // 这里简单处理：如果调整后宽度不足，则不截取
+                roi_width = display_frame.cols - roi_x;
+                if (roi_width < 32) { // 如果调整后宽度不足期望值，可以选择不截取
+                     std::cerr << "Warning: display_frame too small on width after boundary adjustment for track_frame." << std::endl;
+                     return;
+                }
+            }
+            if (roi_y + roi_height > display_frame.rows) {
+                // 如果ROI超出下边界，类似处理
+                roi_height = display_frame.rows - roi_y;
+                 if (roi_height < 32) { // 如果调整后高度不足期望值
+                     std::cerr << "Warning: display_frame too small on height after boundary adjustment for track_frame." << std::endl;
+                     return;
+                }
+            }
+            
+            // 如果调整后的 roi_width 或 roi_height 不是32了，您可能需要重新考虑逻辑
+            // 这里我们假设仍然尝试截取，即使它可能不是严格的32x32了（如果display_frame非常小）
+            // 或者，您可以坚持必须是32x32，如果不是则不截取
+
+            // 定义ROI矩形
+            cv::Rect roi(roi_x, roi_y, roi_width, roi_height);
+
+            // 从 display_frame 截取ROI，并克隆到 track_frame
+            // 使用 clone() 是为了确保 track_frame 拥有自己的数据副本，
+            // 而不是仅仅指向 display_frame 的一部分内存。
+            try {
+                track_frame = display_frame(roi).clone();
+                std::cout << "Track frame (32x32) captured from display_frame center." << std::endl;
+            } catch (const cv::Exception& e) {
+                std::cerr << "OpenCV exception while creating ROI for track_frame: " << e.what() << std::endl;
+                std::cerr << "ROI params: x=" << roi_x << ", y=" << roi_y << ", w=" << roi_width << ", h=" << roi_height << std::endl;
+                std::cerr << "Display_frame size: " << display_frame.cols << "x" << display_frame.rows << std::endl;
+                track_frame.release(); // 确保出错时 track_frame 是空的
+            }
+
+        } else {
+            std::cerr << "Warning: display_frame is smaller than 32x32, cannot capture track_frame." << std::endl;
+            // 确保 track_frame 保持为空
+            track_frame.release();
+        }
+    } else if (tracking_enabled && !track_frame.empty()) {
+        // 如果标志位为1但track_frame已经有内容了，可以选择什么都不做，
+        // 或者根据需求决定是否要更新它。当前逻辑是只有当它是空的时候才截取。
+        // std::cout << "Track frame already exists, not capturing new one." << std::endl;
+    }
+}
+
+void get_track_frame_and_init_tracker(const cv::Mat& current_display_frame_orig, bool tracking_enabled, FrameWorkspace& workspace) { // Renamed param for clarity
+    if (tracking_enabled && !tracker_initialized && !current_display_frame_orig.empty()) {
+        // 转换成跟踪器的输入格式 (BGR 或亮度，见 TrackerSettings::channels)
+        int channels = TrackerInputChannels();
+        cv::Mat frame_for_tracker_input;
+        if (!ConvertForTracker(current_display_frame_orig, channels, workspace.tracker_input, frame_for_tracker_input)) {
+            std::cerr << "Error: display_frame for tracker init has " << current_display_frame_orig.channels()
+                      << " channels. Expected 1, 3 or 4." << std::endl;
+            return;
+        }
+
+        // 在准星附近按显著性挑选初始框 (多尺度，见 target_acquisition.h)；找不到明显目标时退回中心 32x32 框
+        AcquisitionResult acquisition = AcquireTarget(frame_for_tracker_input, 1.0);
+        if (acquisition.box.empty()) {
+            std::cerr << "Display frame too small to select ROI for tracking." << std::endl;
+            return;
+        }
+        cv::Rect initial_bbox = acquisition.box;
+
+        // track_frame (the visual ROI) is taken from the tracker's own input
+        track_frame = frame_for_tracker_input(initial_bbox).clone();
+
+        if (StartSelectedTracker(frame_for_tracker_input, initial_bbox, channels)) {
+            tracked_bbox = initial_bbox;
+            tracker_initialized = true;
+            tracker_input_size = frame_for_tracker_input.size();
+            NoteAcquisition(initial_bbox, acquisition.score);
+            // ai_joystickState.ch3 is seeded by the control thread (TrackingMeasurement::tracker_started)
+            std::cout << "Tracker (" << TrackerInfoAt(tracker_index).name << ") initialized with "
+                      << initial_bbox.width << "x" << initial_bbox.height << " ROI from "
+                      << (channels == 1 ? "luma" : "BGR") << " frame." << std::endl;
+        } else {
+            std::cerr << "Failed to start tracker '" << TrackerInfoAt(selected_tracker.load()).name << "'." << std::endl;
+            track_frame.release();
+            tracker_initialized = false;
+        }
+    }
+}
+
+// 跟踪线程调用：只更新跟踪器并计算偏移量，不在帧上绘制任何东西 (绘制由预览线程完成)
+void update_tracker(const cv::Mat& current_display_frame, bool tracking_enabled, TrackingOffset& offset_out, FrameWorkspace& workspace) {
+    // 先将偏移量标记为无效，除非跟踪成功并计算出新值
+    offset_out.is_valid = false; 
+
+    if (tracking_enabled && tracker_initialized && tracker && !current_display_frame.empty()) {
+        cv::Mat frame_for_tracker_update; // 复用 workspace 缓冲，不每帧分配
+        if (!ConvertForTracker(current_display_frame, tracker_channels, workspace.tracker_input, frame_for_tracker_update)) {
+            std::cerr << "Error: Frame for tracker update has " << current_display_frame.channels()
+                      << " channels. Expected 1, 3 or 4." << std::endl;
+            return;
+        }
+
+        bool success = tracker->Update(frame_for_tracker_update, tracked_bbox);
+        if (RecoverTarget(frame_for_tracker_update, success, tracked_bbox)) success = true; // 丢失后重新检测到目标，跟踪器已在新位置重启
+
+        if (success) {
+            // --- 计算偏移量 ---
+            // 1. 获取图像中心点
+            cv::Point2d frame_center(current_display_frame.cols / 2.0, current_display_frame.rows / 2.0);
+
+            // 2. 获取跟踪目标中心点 (跟踪器支持时为亚像素精度，否则为跟踪框中心)
+            cv::Point2d tracked_box_center = TargetCentre(tracked_bbox);
+
+            // 3. 计算偏移量
+            offset_out.dx = static_cast<float>(tracked_box_center.x - frame_center.x);
+            offset_out.dy = static_cast<float>(tracked_box_center.y - frame_center.y); // 通常 y 向上为负，向下为正。如果需要屏幕坐标系（y向下为正），这个减法顺序是对的。
+                                                                                // 如果您希望 y 向上为正的偏移量，可以是 frame_center.y - tracked_box_center.y
+            offset_out.width = tracked_bbox.width;
+            offset_out.height = tracked_bbox.height;
+            offset_out.is_valid = true;
+            // --- 偏移量计算结束 ---
+        }
+        // 当跟踪失败时，offset_out.is_valid 保持 false ("Tracking Failure" 由预览叠加层显示)
+    } else if (!tracking_enabled && tracker_initialized) {
+        tracker.reset();
+        recovery.reset();
+        tracker_initialized = false;
+        track_frame.release();
+        std::cout << "Tracker stopped and reset." << std::endl;
+        // 当跟踪停止时，也可以将全局偏移量标记为无效
+        offset_out.is_valid = false; 
+    }
+}
+
+// Runtime tracker switch on the display path: the selected tracker takes over on
+// the box the running one holds. If it cannot start there, the old one keeps going
+// and the selection snaps back to it.
+void SwitchTrackerIfRequested(const cv::Mat& display_frame, FrameWorkspace& workspace) {
+    if (!TrackerSwitchPending() || display_frame.empty()) return;
+    int previous = tracker_index;
+    int channels = SelectedTrackerChannels();
+    cv::Mat frame_for_tracker;
+    cv::Rect box = tracked_bbox & cv::Rect(0, 0, display_frame.cols, display_frame.rows);
+    if (box.area() > 0 && ConvertForTracker(display_frame, channels, workspace.tracker_input, frame_for_tracker)
+        && StartSelectedTracker(frame_for_tracker, box, channels)) {
+        track_frame = frame_for_tracker(box).clone();
+        std::cout << "Switched tracker: " << TrackerInfoAt(previous).name << " -> " << TrackerInfoAt(tracker_index).name << std::endl;
+    } else {
+        std::cerr << "Could not switch to tracker '" << TrackerInfoAt(selected_tracker.load()).name << "', keeping "
+                  << TrackerInfoAt(previous).name << "." << std::endl;
+        selected_tracker.store(previous);
+    }
+}
+
+void TrackingStep(const cv::Mat& display_frame, bool tracking_enabled, TrackingMeasurement& measurement, FrameWorkspace& workspace) {
+    ResetTrackerOnResize(display_frame.size());
+    bool was_initialized = tracker_initialized;
+    measurement.offset = TrackingOffset();
+    if (tracking_enabled) {
+        if (!tracker_initialized) { // 如果跟踪启动且跟踪器未初始化
+            get_track_frame_and_init_tracker(display_frame, tracking_enabled, workspace); // 使用当前的显示帧初始化
+        } else {
+            SwitchTrackerIfRequested(display_frame, workspace); // 运行中切换跟踪器 ('Y' 键)
+        }
+        update_tracker(display_frame, tracking_enabled, measurement.offset, workspace); // 更新跟踪器 (不绘制)
+    } else if (tracker_initialized) { // 如果跟踪关闭但跟踪器仍处于初始化状态
+        update_tracker(display_frame, tracking_enabled, measurement.offset, workspace); // 调用一次以重置跟踪器
+    }
+    measurement.tracker_started = !was_initialized && tracker_initialized;
+    measurement.tracker_active = tracking_enabled && tracker_initialized;
+    measurement.recovering = TrackerRecovering();
+    measurement.tracked_bbox = tracked_bbox;
+    measurement.tracker = RunningTracker();
+    ReportAcquisition(measurement);
+}
+
+bool TrackerRecovering() {
+    return tracker_initialized && recovery && recovery->Active();
+}
+
+void ResetTracker() {
+    tracker.reset();
+    recovery.reset();
+    tracker_initialized = false;
+    tracked_bbox = cv::Rect();
+    tracked_bbox_native = cv::Rect();
+    track_frame.release();
+    acquisition_overlay_frames = 0;
+}
+
+static cv::Rect ScaleRect(const cv::Rect& rect, double scale_x, double scale_y) {
+    return cv::Rect(cvRound(rect.x * scale_x), cvRound(rect.y * scale_y),
+                    cvRound(rect.width * scale_x), cvRound(rect.height * scale_y));
+}
+
+void TrackingStepNative(const cv::Mat& bgra, const cv::Rect& region, const cv::Size& frame_size, bool tracking_enabled,
+                        TrackingMeasurement& measurement, FrameWorkspace& workspace) {
+    ResetTrackerOnResize(frame_size);
+    bool was_initialized = tracker_initialized;
+    measurement.offset = TrackingOffset();
+    cv::Size display_size = ComputeDisplaySize(frame_size);
+    double to_display_x = static_cast<double>(display_size.width) / frame_size.width;
+    double to_display_y = static_cast<double>(display_size.height) / frame_size.height;
+    cv::Rect frame_rect(0, 0, frame_size.width, frame_size.height);
+
+    if (!tracking_enabled) {
+        if (tracker_initialized) {
+            ResetTracker();
+            std::cout << "Tracker stopped and reset." << std::endl;
+        }
+    } else if (!bgra.empty()) {
+        // Paste this frame's pixels into the canvas at their monitor position (converted to the tracker's format).
+        bool switching = TrackerSwitchPending();
+        int channels = switching ? SelectedTrackerChannels() : TrackerInputChannels();
+        int canvas_type = channels == 1 ? CV_8UC1 : CV_8UC3;
+        if (workspace.native_canvas.size() != frame_size || workspace.native_canvas.type() != canvas_type) workspace.native_canvas.create(frame_size, canvas_type);
+        cv::Rect covered = region & frame_rect;
+        cv::Mat canvas_part = workspace.native_canvas(covered);
+        cv::cvtColor(bgra(cv::Rect(covered.tl() - region.tl(), covered.size())), canvas_part, channels == 1 ? cv::COLOR_BGRA2GRAY : cv::COLOR_BGRA2BGR);
+
+        if (switching) {
+            // Same takeover as the display path; the search window is captured around the box, so it is covered.
+            int previous = tracker_index;
+            if ((tracked_bbox_native & covered) == tracked_bbox_native && tracked_bbox_native.area() > 0
+                && StartSelectedTracker(workspace.native_canvas, tracked_bbox_native, channels)) {
+                track_frame = workspace.native_canvas(tracked_bbox_native).clone();
+                std::cout << "Switched tracker: " << TrackerInfoAt(previous).name << " -> " << TrackerInfoAt(tracker_index).name << std::endl;
+            } else {
+                // The canvas is already in the new format; the old tracker cannot read it, so start over.
+                std::cerr << "Could not switch to tracker '" << TrackerInfoAt(selected_tracker.load()).name << "' on this frame, re-seeding." << std::endl;
+                ResetTracker();
+            }
+        }
+
+        if (!tracker_initialized) {
+            // Same acquisition as the display path, on monitor pixels (sizes still in display px). Only
+            // a frame that covers the search region can seed the tracker (always a full frame in practice:
+            // ComputeCaptureWindow asks for one while no tracker runs).
+            AcquisitionResult acquisition;
+            if (covered == frame_rect) acquisition = AcquireTarget(workspace.native_canvas, 1.0 / to_display_x);
+            cv::Rect initial_bbox = acquisition.box;
+            if (initial_bbox.area() > 0) {
+                track_frame = workspace.native_canvas(initial_bbox).clone();
+                if (StartSelectedTracker(workspace.native_canvas, initial_bbox, channels)) {
+                    tracked_bbox_native = initial_bbox;
+                    tracker_initialized = true;
+                    tracker_input_size = frame_size;
+                    NoteAcquisition(ScaleRect(initial_bbox, to_display_x, to_display_y), acquisition.score);
+                    std::cout << "Tracker (" << TrackerInfoAt(tracker_index).name << ") initialized on native pixels ("
+                              << initial_bbox.width << "x" << initial_bbox.height << ")." << std::endl;
+                } else {
+                    std::cerr << "Failed to start tracker '" << TrackerInfoAt(selected_tracker.load()).name << "'." << std::endl;
+                    ResetTracker();
+                }
+            }
+        }
+
+        bool tracked = tracker_initialized && tracker->Update(workspace.native_canvas, tracked_bbox_native);
+        if (tracker_initialized && RecoverTarget(workspace.native_canvas, tracked, tracked_bbox_native)) tracked = true;
+        if (tracked) {
+            // 与显示帧路径相同的约定：跟踪目标中心相对画面中心的偏移，换算成显示像素 (不取整，保留原生像素精度)
+            cv::Point2d centre = TargetCentre(tracked_bbox_native);
+            measurement.offset.dx = static_cast<float>((centre.x - frame_size.width / 2.0) * to_display_x);
+            measurement.offset.dy = static_cast<float>((centre.y - frame_size.height / 2.0) * to_display_y);
+            measurement.offset.width = cvRound(tracked_bbox_native.width * to_display_x);
+            measurement.offset.height = cvRound(tracked_bbox_native.height * to_display_y);
+            measurement.offset.is_valid = true;
+        }
+        if (tracker_initialized) tracked_bbox = ScaleRect(tracked_bbox_native, to_display_x, to_display_y);
+    }
+    measurement.tracker_started = !was_initialized && tracker_initialized;
+    measurement.tracker_active = tracking_enabled && tracker_initialized;
+    measurement.recovering = TrackerRecovering();
+    measurement.tracked_bbox = tracked_bbox;
+    measurement.tracker = RunningTracker();
+    ReportAcquisition(measurement);
+}
+
+cv::Rect ComputeCaptureWindow(const cv::Size& frame_size) {
+    // Re-detection searches ever larger windows; stale canvas pixels would hide the target.
+    if (!tracker_initialized || tracked_bbox_native.area() <= 0 || TrackerRecovering()) return cv::Rect();
+    int width = std::min(frame_size.width, std::max(CAPTURE_WINDOW_MIN_SIZE, cvRound(tracked_bbox_native.width * CAPTURE_WINDOW_SCALE)));
+    int height = std::min(frame_size.height, std::max(CAPTURE_WINDOW_MIN_SIZE, cvRound(tracked_bbox_native.height * CAPTURE_WINDOW_SCALE)));
+    int centre_x = tracked_bbox_native.x + tracked_bbox_native.width / 2;
+    int centre_y = tracked_bbox_native.y + tracked_bbox_native.height / 2;
+    // Shift rather than clip at the screen edge, so the window (and the capture buffers) keep one size.
+    int x = std::max(0, std::min(centre_x - width / 2, frame_size.width - width));
+    int y = std::max(0, std::min(centre_y - height / 2, frame_size.height - height));
+    return cv::Rect(x, y, width, height);
+}
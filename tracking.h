@@ -0,0 +1,101 @@
+#pragma once
+
+// Target tracker (a tracker_registry.h entry, KCF by default) running on the
+// DISPLAY_WIDTH-wide frame. Owned by the tracking thread in the app and by the
+// replay engine in SimReplay; nothing here reads the control globals, the caller
+// passes tracking_enabled in.
+
+#include <cstdint>
+#include <memory>
+
+#include <opencv2/core.hpp>
+
+#include "sim_types.h"
+#include "frame_workspace.h"
+#include "frame_tiles.h"
+#include "tracker_registry.h"
+
+struct TrackingMeasurement {
+    TrackingOffset offset;
+    bool tracker_started = false;                   // tracker was (re)initialised on this frame
+    bool tracker_active = false;                    // tracker initialised and updated on this frame
+    bool recovering = false;                        // target lost, re-detection still searching (control holds its PID state)
+    cv::Rect tracked_bbox;
+    cv::Rect acquired_bbox;                         // box the tracker was seeded with (display px), for the first frames after a start; empty otherwise
+    float acquisition_score = 0.0f;                 // its saliency score (0 = fixed centre box, see target_acquisition.h)
+    int tracker = -1;                               // registry index of the tracker that ran (-1 = none running)
+    uint64_t sequence = 0;
+    int64_t capture_timestamp_ns = 0;               // frame acquire time (latency accounting)
+    int64_t tracked_timestamp_ns = 0;               // when TrackingStep finished
+};
+
+// Tracker configuration. 'channels' is the pixel format the tracker prefers to run on
+// (a registry entry that does not take it gets the other one):
+//   3 - BGR; KCF uses its grey + colour-names features.
+//   1 - 8-bit luma (BT.601, as cv::COLOR_BGR2GRAY); KCF uses the grey feature only,
+//       so conversion bandwidth and FFT work drop to about a third.
+// Read when a tracker is created; the running tracker keeps its own format.
+struct TrackerSettings {
+    int channels = 3;
+};
+extern TrackerSettings g_tracker_settings;
+
+// Channel count of the running tracker, or of the next one if none is running or a
+// switch is pending.
+// Frames for TrackingStep() may be BGRA, BGR or luma; matching this skips the conversion.
+int TrackerInputChannels();
+
+// Registry index of the tracker to run. Safe from any thread (--tracker, the 'Y'
+// hotkey, a replayed session). A running tracker of another kind is replaced on
+// the tracking thread's next frame by the new one, initialised on the box the old
+// one held, so switching keeps the target.
+void SelectTracker(int index);
+int SelectedTracker();
+int RunningTracker();                     // registry index, -1 when no tracker is running
+
+extern cv::Mat track_frame;               // ROI the tracker was initialised with
+extern std::unique_ptr<TargetTracker> tracker;   // 当前跟踪器 (tracker_registry.h)
+extern cv::Rect tracked_bbox;             // 存储跟踪到的边界框
+extern bool tracker_initialized;
+extern cv::Rect tracked_bbox_native;      // --capture-roi: tracker box in monitor pixels
+
+void get_track_frame(const cv::Mat& display_frame, bool tracking_enabled);
+// workspace.tracker_input holds the conversion to the tracker's format so it is not reallocated every frame.
+void get_track_frame_and_init_tracker(const cv::Mat& current_display_frame, bool tracking_enabled, FrameWorkspace& workspace);
+void update_tracker(const cv::Mat& current_display_frame, bool tracking_enabled, TrackingOffset& offset_out, FrameWorkspace& workspace);
+
+// Size of the frame the tracker runs on for a given capture size (DISPLAY_WIDTH wide, same aspect).
+cv::Size ComputeDisplaySize(const cv::Size& capture_size);
+
+// Downscales 'capture' into 'display' (already allocated at the display size).
+// 'display_sequence' is the capture frame whose downscale 'display' currently
+// holds (0 = unknown); only display blocks whose source tiles changed since
+// then are recomputed. Block edges land on whole source pixels, so the result
+// matches a full cv::resize to within 1 LSB (fixed-point rounding of the
+// interpolation weights). Returns the number of display pixels written.
+size_t ResizeToDisplay(const cv::Mat& capture, const FrameTileMap& tiles, uint64_t display_sequence,
+                       cv::Mat& display, FrameWorkspace& workspace);
+
+// One tracker step per frame: initialises, updates or resets the tracker
+// depending on tracking_enabled and fills measurement (sequence is left alone).
+void TrackingStep(const cv::Mat& display_frame, bool tracking_enabled, TrackingMeasurement& measurement, FrameWorkspace& workspace);
+
+// The running tracker lost its target and re-detection (target_recovery.h) is still
+// searching for it; the tracker restarts on the target if it is found.
+bool TrackerRecovering();
+
+void ResetTracker();
+
+// --- Tracker-ROI capture mode (--capture-roi) ---
+// The tracker runs on native monitor pixels instead of the downscaled frame.
+// Every frame, full or just a search window, is converted into a monitor-sized
+// canvas at its own position (workspace.native_canvas), so the tracker keeps working in
+// monitor coordinates whatever was captured. 'region' is the part of the frame
+// 'bgra' covers. The offset and tracked_bbox are reported in display pixels like
+// TrackingStep(), so the control gains do not change.
+void TrackingStepNative(const cv::Mat& bgra, const cv::Rect& region, const cv::Size& frame_size, bool tracking_enabled,
+                        TrackingMeasurement& measurement, FrameWorkspace& workspace);
+
+// Padded search window (monitor pixels) to capture around the tracked target,
+// or an empty rect when the native tracker is not running.
+cv::Rect ComputeCaptureWindow(const cv::Size& frame_size);
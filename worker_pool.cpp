@@ -0,0 +1,142 @@
+#include "worker_pool.h"
+
+#include <cstdlib>
+#include <iostream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const size_t DEFAULT_L2_CACHE_BYTES = 1024 * 1024;
+
+bool PinCurrentThread(int core) {
+#ifdef _WIN32
+    if (core < 0 || core >= 64) return false;
+    return SetThreadAffinityMask(GetCurrentThread(), static_cast<DWORD_PTR>(1) << core) != 0;
+#elif defined(__linux__)
+    if (core < 0 || core >= CPU_SETSIZE) return false;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(core, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)core;
+    return false;
+#endif
+}
+
+} // namespace
+
+WorkerPool::WorkerPool(int thread_count, const std::vector<int>& cores) {
+    for (int i = 0; i + 1 < thread_count; ++i) {
+        int core = cores.empty() ? -1 : cores[static_cast<size_t>(i) % cores.size()];
+        m_workers.emplace_back(&WorkerPool::WorkerLoop, this, i + 1, core);
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_start_cv.notify_all();
+    for (std::thread& worker : m_workers) worker.join();
+}
+
+void WorkerPool::Run(int task_count, TaskFn fn, void* context) {
+    if (task_count <= 0) return;
+    if (m_workers.empty() || task_count == 1) {
+        for (int task = 0; task < task_count; ++task) fn(context, task, 0);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_fn = fn;
+        m_context = context;
+        m_task_count = task_count;
+        m_next_task.store(0, std::memory_order_relaxed);
+        m_pending_workers = m_workers.size();
+        ++m_job_generation;
+    }
+    m_start_cv.notify_all();
+    RunTasks(0);
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done_cv.wait(lock, [this] { return m_pending_workers == 0; });
+}
+
+void WorkerPool::RunTasks(int worker) {
+    for (int task = m_next_task.fetch_add(1, std::memory_order_relaxed); task < m_task_count;
+         task = m_next_task.fetch_add(1, std::memory_order_relaxed)) {
+        m_fn(m_context, task, worker);
+    }
+}
+
+void WorkerPool::WorkerLoop(int worker, int core) {
+    if (core >= 0 && !PinCurrentThread(core)) {
+        std::cerr << "WorkerPool: could not pin worker " << worker << " to core " << core << "." << std::endl;
+    }
+    uint64_t seen_generation = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_start_cv.wait(lock, [&] { return m_stop || m_job_generation != seen_generation; });
+            if (m_stop) return;
+            seen_generation = m_job_generation;
+        }
+        RunTasks(worker);
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (--m_pending_workers == 0) m_done_cv.notify_one();
+        }
+    }
+}
+
+size_t L2CacheBytes() {
+    static const size_t cached = [] {
+#ifdef _WIN32
+        DWORD length = 0;
+        GetLogicalProcessorInformation(nullptr, &length);
+        std::vector<SYSTEM_LOGICAL_PROCESSOR_INFORMATION> info(length / sizeof(SYSTEM_LOGICAL_PROCESSOR_INFORMATION));
+        if (!info.empty() && GetLogicalProcessorInformation(info.data(), &length)) {
+            for (const SYSTEM_LOGICAL_PROCESSOR_INFORMATION& entry : info) {
+                if (entry.Relationship == RelationCache && entry.Cache.Level == 2 && entry.Cache.Size > 0) return static_cast<size_t>(entry.Cache.Size);
+            }
+        }
+#elif defined(_SC_LEVEL2_CACHE_SIZE)
+        long size = sysconf(_SC_LEVEL2_CACHE_SIZE);
+        if (size > 0) return static_cast<size_t>(size);
+#endif
+        return DEFAULT_L2_CACHE_BYTES;
+    }();
+    return cached;
+}
+
+bool ParseCoreList(const std::string& text, std::vector<int>& cores_out) {
+    cores_out.clear();
+    size_t position = 0;
+    while (position < text.size()) {
+        size_t comma = text.find(',', position);
+        std::string item = text.substr(position, comma == std::string::npos ? std::string::npos : comma - position);
+        position = comma == std::string::npos ? text.size() : comma + 1;
+        char* end = nullptr;
+        long first = std::strtol(item.c_str(), &end, 10);
+        long last = first;
+        if (end == item.c_str() || first < 0) return false;
+        if (*end == '-') {
+            const char* range_end = end + 1;
+            last = std::strtol(range_end, &end, 10);
+            if (end == range_end || last < first) return false;
+        }
+        if (*end != '\0') return false;
+        for (long core = first; core <= last; ++core) cores_out.push_back(static_cast<int>(core));
+    }
+    return !cores_out.empty();
+}
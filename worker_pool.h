@@ -0,0 +1,69 @@
+#pragma once
+
+// Fixed pool of worker threads for data-parallel frame kernels (tiled 4K
+// downscale). The pool is ours rather than OpenCV's so the thread count and
+// placement are explicit: it never grows past what was configured, and its
+// threads can be pinned to cores away from the tracking and control threads.
+//
+// ParallelFor() blocks the calling thread, which runs tasks as well, until every
+// task is done. Tasks are handed out dynamically from a shared counter, so uneven
+// tiles balance themselves. Nothing is allocated per call.
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class WorkerPool {
+public:
+    // thread_count includes the calling thread, so thread_count - 1 workers are
+    // started. The k-th started worker is pinned to cores[k % cores.size()]
+    // (logical CPU indices); an empty list leaves placement to the OS. The calling
+    // thread keeps whatever affinity it has.
+    explicit WorkerPool(int thread_count, const std::vector<int>& cores = std::vector<int>());
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    // Threads that run tasks, the caller included.
+    int Size() const { return static_cast<int>(m_workers.size()) + 1; }
+
+    // Calls fn(task, worker) for every task in [0, task_count); 'worker' is in
+    // [0, Size()), 0 being the calling thread, so per-worker scratch needs no locking.
+    // Not reentrant: one ParallelFor at a time per pool.
+    template <typename Fn>
+    void ParallelFor(int task_count, Fn& fn) {
+        Run(task_count, [](void* context, int task, int worker) { (*static_cast<Fn*>(context))(task, worker); }, &fn);
+    }
+
+private:
+    typedef void (*TaskFn)(void* context, int task, int worker);
+
+    void Run(int task_count, TaskFn fn, void* context);
+    void RunTasks(int worker);
+    void WorkerLoop(int worker, int core);
+
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_start_cv;
+    std::condition_variable m_done_cv;
+    uint64_t m_job_generation = 0;      // bumped per ParallelFor (guarded by m_mutex)
+    size_t m_pending_workers = 0;       // workers still inside the current job
+    bool m_stop = false;
+
+    TaskFn m_fn = nullptr;
+    void* m_context = nullptr;
+    int m_task_count = 0;
+    std::atomic<int> m_next_task{0};
+};
+
+// Per-core L2 data cache size in bytes (1 MiB if the OS does not say).
+size_t L2CacheBytes();
+
+// "2,3,6-7" -> {2, 3, 6, 7}. False on malformed input.
+bool ParseCoreList(const std::string& text, std::vector<int>& cores_out);